@@ -0,0 +1,255 @@
+#include "lexer.h"
+#include "tokenizer.h"
+#include "parse.h"
+#include "ast.h"
+#include "type.h"
+#include "context.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Every allocation in the process goes through these, so each stage can report how much it allocates
+namespace{
+std::atomic<std::size_t> allocation_count{0};
+std::atomic<std::size_t> allocated_bytes{0};
+}//namespace
+void* operator new(std::size_t size){
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if(void* p = std::malloc(size == 0 ? 1 : size)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+void operator delete[](void* p) noexcept{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept{
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept{
+    std::free(p);
+}
+
+namespace{
+//Discards everything written to it, keeping only a byte count
+class CountingBuffer : public std::streambuf{
+    std::size_t count = 0;
+protected:
+    int_type overflow(int_type c) override{
+        count++;
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override{
+        count += n;
+        return n;
+    }
+public:
+    std::size_t bytes() const{
+        return count;
+    }
+};
+
+//A translation unit with the given number of functions
+//Uses macros, structs, pointers, arrays, loops and calls so each stage has real work to do
+std::string synthetic_program(int functions){
+    auto ss = std::stringstream{};
+    ss << "#define SCALE 3\n";
+    ss << "#define MASK 63\n";
+    ss << "struct point{int x; int y; long weight;};\n";
+    ss << "int table[64];\n";
+    for(int i = 0; i < functions; i++){
+        ss << "int f" << i << "(int n, struct point* p){\n";
+        ss << "    int total = " << i << ";\n";
+        ss << "    int values[8];\n";
+        ss << "    for(int i = 0; i < 8; i++){\n";
+        ss << "        values[i] = (i * SCALE + n) ^ (total << 2);\n";
+        ss << "        total += values[i] % 7;\n";
+        ss << "    }\n";
+        ss << "    if((*p).x > (*p).y && n != 0){\n";
+        ss << "        (*p).weight = (*p).weight + total * 2;\n";
+        ss << "    }else{\n";
+        ss << "        (*p).y -= 1;\n";
+        ss << "    }\n";
+        ss << "    while(n > 0){\n";
+        ss << "        n = n / 2;\n";
+        ss << "        table[n & MASK] += n;\n";
+        ss << "    }\n";
+        if(i > 0){
+            ss << "    total += f" << i - 1 << "(n - 1, p);\n";
+        }
+        ss << "    return total;\n";
+        ss << "}\n";
+    }
+    ss << "int main(){\n";
+    ss << "    struct point p;\n";
+    ss << "    p.x = 1;\n";
+    ss << "    p.y = 2;\n";
+    ss << "    p.weight = 0;\n";
+    ss << "    return f" << functions - 1 << "(10, &p) & 0;\n";
+    ss << "}\n";
+    return ss.str();
+}
+
+std::vector<token::Token> lex_all(const std::string& source){
+    auto input = std::istringstream(source);
+    auto l = lexer::Lexer(input);
+    auto tokens = std::vector<token::Token>{};
+    while(l.peek_token().type != token::TokenType::END){
+        tokens.push_back(l.get_token());
+    }
+    return tokens;
+}
+std::unique_ptr<ast::Program> parse_all(const std::vector<token::Token>& tokens){
+    auto stream = lexer::TokenStream(tokens);
+    return parse::construct_ast(stream);
+}
+
+struct Measurement{
+    double seconds = 0;
+    std::size_t tokens = 0;
+    std::size_t ir_bytes = 0;
+    std::size_t allocations = 0;
+    std::size_t allocated_bytes = 0;
+};
+
+//Times only the body of stage, which reports the tokens and IR bytes it handled
+//Setup done before calling this (lexing for the parser, parsing for analysis) is not counted
+template<typename Stage>
+Measurement measure(Stage&& stage){
+    auto result = Measurement{};
+    auto allocations_before = allocation_count.load();
+    auto bytes_before = allocated_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    stage(result);
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.allocations = allocation_count.load() - allocations_before;
+    result.allocated_bytes = allocated_bytes.load() - bytes_before;
+    return result;
+}
+
+Measurement run_stage(const std::string& stage, const std::string& source){
+    if(stage == "tokenizer"){
+        return measure([&](Measurement& m){
+            auto input = std::istringstream(source);
+            auto t = lexer::Tokenizer(input);
+            while(t.get_token().type != token::TokenType::END){
+                m.tokens++;
+            }
+        });
+    }
+    if(stage == "lexer"){
+        return measure([&](Measurement& m){
+            m.tokens = lex_all(source).size();
+        });
+    }
+    auto tokens = lex_all(source);
+    if(stage == "parse"){
+        return measure([&](Measurement& m){
+            auto program = parse_all(tokens);
+            m.tokens = tokens.size();
+        });
+    }
+    auto program = parse_all(tokens);
+    if(stage == "analyze"){
+        return measure([&](Measurement& m){
+            program->analyze();
+            m.tokens = tokens.size();
+        });
+    }
+    program->analyze();
+    assert(stage == "codegen");
+    return measure([&](Measurement& m){
+        auto buffer = CountingBuffer();
+        auto output = std::ostream(&buffer);
+        auto c = context::Context();
+        program->codegen(output, c);
+        output.flush();
+        m.tokens = tokens.size();
+        m.ir_bytes = buffer.bytes();
+    });
+}
+
+void print_result(const std::string& stage, int functions, std::size_t lines, std::size_t source_bytes, 
+    int repetitions, const Measurement& m){
+    std::cout << "{\"stage\":\"" << stage << "\""
+        << ",\"functions\":" << functions
+        << ",\"lines\":" << lines
+        << ",\"source_bytes\":" << source_bytes
+        << ",\"repetitions\":" << repetitions
+        << ",\"seconds\":" << m.seconds
+        << ",\"tokens\":" << m.tokens
+        << ",\"tokens_per_second\":" << m.tokens / m.seconds
+        << ",\"lines_per_second\":" << lines / m.seconds
+        << ",\"ir_bytes\":" << m.ir_bytes
+        << ",\"ir_bytes_per_second\":" << m.ir_bytes / m.seconds
+        << ",\"allocations\":" << m.allocations
+        << ",\"allocated_bytes\":" << m.allocated_bytes
+        << "}" << std::endl;
+}
+
+std::vector<int> parse_sizes(const std::string& list){
+    auto sizes = std::vector<int>{};
+    auto ss = std::stringstream(list);
+    auto item = std::string();
+    while(std::getline(ss, item, ',')){
+        sizes.push_back(std::stoi(item));
+    }
+    return sizes;
+}
+}//namespace
+
+//Prints one JSON object per line for each stage and input size
+//Times are the fastest of the repetitions; allocation counts are per run
+int main(int argc, char* argv[]){
+    const auto all_stages = std::vector<std::string>{"tokenizer", "lexer", "parse", "analyze", "codegen"};
+    auto stages = all_stages;
+    auto sizes = std::vector<int>{10, 100, 1000};
+    int repetitions = 5;
+    for(int i = 1; i < argc; i++){
+        auto arg = std::string(argv[i]);
+        if(arg.rfind("--stage=", 0) == 0){
+            stages = {arg.substr(std::string("--stage=").size())};
+            if(std::find(all_stages.begin(), all_stages.end(), stages.front()) == all_stages.end()){
+                std::cerr << "unknown stage "<<stages.front()<<std::endl;
+                return 1;
+            }
+        }else if(arg.rfind("--sizes=", 0) == 0){
+            sizes = parse_sizes(arg.substr(std::string("--sizes=").size()));
+        }else if(arg.rfind("--repetitions=", 0) == 0){
+            repetitions = std::stoi(arg.substr(std::string("--repetitions=").size()));
+        }else{
+            std::cerr << "usage: stage_bench.out [--stage=tokenizer|lexer|parse|analyze|codegen] [--sizes=n,...] [--repetitions=n]"<<std::endl;
+            return 1;
+        }
+    }
+    for(int functions : sizes){
+        auto source = synthetic_program(functions);
+        auto lines = static_cast<std::size_t>(std::count(source.begin(), source.end(), '\n'));
+        for(const auto& stage : stages){
+            auto best = run_stage(stage, source);
+            for(int r = 1; r < repetitions; r++){
+                auto m = run_stage(stage, source);
+                if(m.seconds < best.seconds){
+                    best = m;
+                }
+            }
+            print_result(stage, functions, lines, source.size(), repetitions, best);
+        }
+    }
+}
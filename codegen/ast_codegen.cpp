@@ -1,7 +1,11 @@
 #include "ast.h"
 #include "sem_error.h"
 #include "type.h"
+#include "operators.h"
+#include "time_trace.h"
 #include "codegen/codegen_utility.h"
+#include <algorithm>
+#include <optional>
 #include <string>
 #include <cassert>
 namespace ast{
@@ -10,80 +14,64 @@ template <class... Ts> struct overloaded : Ts...{using Ts::operator()...;};
 template<class...Ts> overloaded(Ts ...) -> overloaded<Ts...>;
 namespace{
 template <typename T>
-T lookup_tag(type::CType t){
+T lookup_tag(type::CType t, const type::TypeContext& types){
     try{
-        return type::get<T>(type::CType::get_tag(type::get<T>(t).tag));
+        return type::get<T>(types.get_tag(type::get<T>(t)));
     }catch(std::exception& e){
         throw std::runtime_error("During code generation, could not find struct with name "+type::get<T>(t).tag);
     }
 }
 
-value::Value* get_lval(const ast::AST* node, std::ostream& output, context::Context& c);
-const auto assignment_op = std::map<token::TokenType,token::TokenType>{{
-    {token::TokenType::PlusAssign, token::TokenType::Plus},
-    {token::TokenType::MinusAssign, token::TokenType::Minus},
-    {token::TokenType::MultAssign, token::TokenType::Star},
-    {token::TokenType::DivAssign, token::TokenType::Div},
-    {token::TokenType::ModAssign, token::TokenType::Mod},
-    {token::TokenType::LSAssign, token::TokenType::LShift},
-    {token::TokenType::RSAssign, token::TokenType::RShift},
-    {token::TokenType::BAAssign, token::TokenType::Amp},
-    {token::TokenType::BOAssign, token::TokenType::BitwiseOr},
-    {token::TokenType::BXAssign, token::TokenType::BitwiseXor},
-}};
-value::Value* compute_array_ptr(const ast::ArrayAccess* node, std::ostream& output, context::Context& c){
+value::Value* get_lval(const ast::AST* node, context::Context& c);
+value::Value* compute_array_ptr(const ast::ArrayAccess* node, context::Context& c){
     auto index_stack = std::vector<value::Value*>{};
-    index_stack.push_back(node->index->codegen(output, c));
+    index_stack.push_back(node->index->codegen(c));
     while(auto p = dynamic_cast<ast::ArrayAccess*>(node->arg.get())){
-        index_stack.push_back(p->index->codegen(output, c));
+        index_stack.push_back(p->index->codegen(c));
         node = p;
     }
     //Old code from before adding struct initializer codegen
-    //auto innermost_operand = node->arg->codegen(output, c);
-    auto innermost_operand = get_lval(node->arg.get(), output, c);
+    //auto innermost_operand = node->arg->codegen(c);
+    auto innermost_operand = get_lval(node->arg.get(), c);
     assert(type::is_type<type::PointerType>(innermost_operand->get_type()) && "Tried to perform array access on non-pointer");
-    auto array_type = type::ir_type(type::get<type::PointerType>(innermost_operand->get_type()).pointed_type());
+    auto array_type = type::get<type::PointerType>(innermost_operand->get_type()).pointed_type();
 
-    auto addr = c.new_temp(type::PointerType(node->type));
-    codegen_utility::print_whitespace(c.depth(), output);
-    output << addr->get_value() <<" = getelementptr inbounds "+array_type+", ptr "<<innermost_operand->get_value()<<", i64 0";
+    auto indices = std::vector<value::Value>{c.make_literal("0", type::IType::LLong)};
     while(index_stack.size() > 0){
-        output <<", "<<type::ir_type(index_stack.back()->get_type())<<" "<<index_stack.back()->get_value();
+        indices.push_back(*index_stack.back());
         index_stack.pop_back();
     }
-    output <<std::endl;
-    return addr;
+    return codegen_utility::make_element_ptr(type::PointerType(node->type), "getelementptr inbounds", array_type, 
+        innermost_operand, indices, c);
 }
-value::Value* compute_struct_lval_ptr(const ast::MemberAccess* node, std::ostream& output, context::Context& c){
-    auto arg = get_lval(node->arg.get(), output, c);
-    auto s_type = lookup_tag<type::StructType>(node->arg->type);
+value::Value* compute_struct_lval_ptr(const ast::MemberAccess* node, context::Context& c){
+    auto arg = get_lval(node->arg.get(), c);
+    auto s_type = lookup_tag<type::StructType>(node->arg->type, c.types());
 
-    auto addr = c.new_temp(type::PointerType(node->type));
-    codegen_utility::print_whitespace(c.depth(), output);
-    output << addr->get_value() <<" = getelementptr "<<type::ir_type(node->arg->type)<<", ptr ";
-    output << arg->get_value()<<", i64 0, i32 "<<s_type.indices.at(node->index)<<std::endl;
-    return addr;
+    auto indices = std::vector<value::Value>{c.make_literal("0", type::IType::LLong), 
+        c.make_literal(std::to_string(s_type.indices.at(node->index)), type::IType::Int)};
+    return codegen_utility::make_element_ptr(type::PointerType(node->type), "getelementptr", node->arg->type, arg, indices, c);
 }
-value::Value* get_lval(const ast::AST* node, std::ostream& output, context::Context& c){
+value::Value* get_lval(const ast::AST* node, context::Context& c){
     if(const auto ast_variable = dynamic_cast<const ast::Variable*>(node)){
-        return c.get_value(ast_variable->variable_name);
+        return c.get_value(ast_variable->symbol_id);
     }
     if(const auto p = dynamic_cast<const ast::UnaryOp*>(node)){
         if(p->tok.type == token::TokenType::Star){
-            return p->arg->codegen(output, c);
+            return p->arg->codegen(c);
         }
     }
     if(const auto p = dynamic_cast<const ast::ArrayAccess*>(node)){
-        return compute_array_ptr(p,output, c);
+        return compute_array_ptr(p, c);
     }
     if(const auto p = dynamic_cast<const ast::MemberAccess*>(node)){
         if(type::is_type<type::StructType>(p->arg->type)){
-            return compute_struct_lval_ptr(p,output, c);
+            return compute_struct_lval_ptr(p, c);
         }else{
             assert(type::is_type<type::UnionType>(p->arg->type));
-            auto u_type = lookup_tag<type::UnionType>(p->arg->type);
-            auto union_ptr = get_lval(p->arg.get(), output, c);
-            auto element_ptr = codegen_utility::convert(type::PointerType(u_type.members.at(u_type.indices.at(p->index))), union_ptr, output, c);
+            auto u_type = lookup_tag<type::UnionType>(p->arg->type, c.types());
+            auto union_ptr = get_lval(p->arg.get(), c);
+            auto element_ptr = codegen_utility::convert(type::PointerType(u_type.members.at(u_type.indices.at(p->index))), union_ptr, c);
             return element_ptr;
         }
     }
@@ -91,186 +79,222 @@ value::Value* get_lval(const ast::AST* node, std::ostream& output, context::Cont
     return nullptr;
 }
 
-value::Value* assignment_codegen(const ast::BinaryOp* node, std::ostream& output, context::Context& c){
-    auto right_register = node->right->codegen(output, c);
-    right_register = codegen_utility::convert(node->new_right_type, std::move(right_register), output, c);
-    auto var_value = get_lval(node->left.get(), output, c);
+value::Value* assignment_codegen(const ast::BinaryOp* node, context::Context& c){
+    auto right_register = node->right->codegen(c);
+    right_register = codegen_utility::convert(node->new_right_type, std::move(right_register), c);
+    auto var_value = get_lval(node->left.get(), c);
 
     value::Value* result = nullptr;
-    if(assignment_op.find(node->tok.type) != assignment_op.end()){
-        auto loaded_value = codegen_utility::make_load(var_value, output, c);
-        loaded_value = codegen_utility::convert(node->new_left_type,loaded_value, output, c);
-        auto op_type = assignment_op.at(node->tok.type);
-        result = codegen_utility::bin_op_codegen(loaded_value, right_register, op_type, node->type, output, c);
+    const auto& op = operators::binary_operator(node->tok.type);
+    if(op.is_compound_assignment()){
+        auto loaded_value = codegen_utility::make_load(var_value, c);
+        loaded_value = codegen_utility::convert(node->new_left_type,loaded_value, c);
+        result = codegen_utility::bin_op_codegen(loaded_value, right_register, op.compound_base, node->type, c);
     }else{
         assert(node->tok.type == token::TokenType::Assign && "Unknown assignment op");
-        result = codegen_utility::convert(node->type, right_register, output, c);
+        result = codegen_utility::convert(node->type, right_register, c);
     }
     assert(type::is_type<type::PointerType>(var_value->get_type()));
-    result = codegen_utility::convert(type::get<type::PointerType>(var_value->get_type()).pointed_type(), result, output, c);
-    codegen_utility::make_store(result, var_value, output, c);
+    result = codegen_utility::convert(type::get<type::PointerType>(var_value->get_type()).pointed_type(), result, c);
+    codegen_utility::make_store(result, var_value, c);
     return result;
 }
-value::Value* short_circuit_codegen(const ast::BinaryOp* node, std::ostream& output, context::Context& c){
+value::Value* short_circuit_codegen(const ast::BinaryOp* node, context::Context& c){
     int instruction_number = c.new_local_name(); 
-    std::string no_sc_label = "logical_op_no_sc."+std::to_string(instruction_number);
-    std::string end_label = "logical_op_end."+std::to_string(instruction_number);
+    auto no_sc_label = basicblock::Label(basicblock::LabelKind::LogicalNoSc, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::LogicalEnd, instruction_number);
 
-    auto left_register = node->left->codegen(output, c);
-    left_register = codegen_utility::convert(type::IType::Bool,left_register, output, c);
+    auto left_register = node->left->codegen(c);
+    left_register = codegen_utility::convert(type::IType::Bool,left_register, c);
 
-    auto new_tmp = codegen_utility::make_tmp_alloca(type::IType::Bool, output, c);
-    codegen_utility::make_store(left_register, new_tmp, output, c);
+    auto new_tmp = codegen_utility::make_tmp_alloca(type::IType::Bool, c);
+    codegen_utility::make_store(left_register, new_tmp, c);
 
     switch(node->tok.type){
         case token::TokenType::And:
-            c.change_block(no_sc_label, output, 
-                std::make_unique<basicblock::Cond_BR>(left_register, no_sc_label,end_label));
+            c.change_block(no_sc_label, 
+                std::make_unique<basicblock::Cond_BR>(*left_register, no_sc_label,end_label));
             break;
         case token::TokenType::Or:
-            c.change_block(no_sc_label, output, 
-                std::make_unique<basicblock::Cond_BR>(left_register, end_label,no_sc_label));
+            c.change_block(no_sc_label, 
+                std::make_unique<basicblock::Cond_BR>(*left_register, end_label,no_sc_label));
             break;
         default:
             assert(false && "Unknown binary assignment op during codegen");
     }
-    auto right_register = node->right->codegen(output, c);
-    right_register = codegen_utility::convert(type::IType::Bool,right_register, output, c);
+    auto right_register = node->right->codegen(c);
+    right_register = codegen_utility::convert(type::IType::Bool,right_register, c);
     value::Value* no_sc_result = nullptr;
     switch(node->tok.type){
         case token::TokenType::And:
-            no_sc_result = codegen_utility::make_command(type::from_str("_Bool"),"and",left_register,right_register,output,c);
+            no_sc_result = codegen_utility::make_command(type::basic_ctype(type::IType::Bool),"and",left_register,right_register, c);
             break;
         case token::TokenType::Or:
-            no_sc_result = codegen_utility::make_command(type::from_str("_Bool"),"or",left_register,right_register,output,c);
+            no_sc_result = codegen_utility::make_command(type::basic_ctype(type::IType::Bool),"or",left_register,right_register, c);
             break;
         default:
             assert(false && "Unknown binary assignment op during codegen");
     }
-    codegen_utility::make_store(no_sc_result, new_tmp, output, c);
-    c.change_block(end_label,output,std::make_unique<basicblock::UCond_BR>(end_label));
+    codegen_utility::make_store(no_sc_result, new_tmp, c);
+    c.change_block(end_label, std::make_unique<basicblock::UCond_BR>(end_label));
 
-    auto result = codegen_utility::make_load(new_tmp, output, c);
-    result = codegen_utility::convert(node->type, result, output, c);
+    auto result = codegen_utility::make_load(new_tmp, c);
+    result = codegen_utility::convert(node->type, result, c);
     return result;
 }
-value::Value* other_bin_op_codegen(const ast::BinaryOp* node, std::ostream& output, context::Context& c){
-    auto left_register = node->left->codegen(output, c);
-    left_register = codegen_utility::convert(node->new_left_type, std::move(left_register), output, c);
-    auto right_register = node->right->codegen(output, c);
-    right_register = codegen_utility::convert(node->new_right_type, std::move(right_register), output, c);
-    return codegen_utility::bin_op_codegen(left_register, right_register, node->tok.type, node->type, output, c);
-}
-void global_func_type_codegen(const std::string& name, const type::FuncType& t, std::ostream& output){
-    output << "declare "<<type::ir_type(t.return_type())<<" "<<name<<"(";
-    if(t.has_prototype()){
-        auto pt_list = t.param_types();
-        if(pt_list.size() > 0){
-            for(int i=0; i<pt_list.size()-1; i++){
-                output<< ir_type(pt_list.at(i))<<" noundef,";
-            }
-            output<< ir_type(pt_list.back())<<" noundef";
-            if(t.is_variadic()){
-                output<<",...";
-            }
+value::Value* other_bin_op_codegen(const ast::BinaryOp* node, context::Context& c){
+    auto left_register = node->left->codegen(c);
+    left_register = codegen_utility::convert(node->new_left_type, std::move(left_register), c);
+    auto right_register = node->right->codegen(c);
+    right_register = codegen_utility::convert(node->new_right_type, std::move(right_register), c);
+    return codegen_utility::bin_op_codegen(left_register, right_register, node->tok.type, node->type, c);
+}
+//The value one step above or below val, for increment and decrement
+value::Value* step_codegen(type::CType t, value::Value* val, bool increment, context::Context& c){
+    if(type::is_type<type::BasicType>(t)){
+        const char* command = std::visit(type::overloaded{
+                    [increment](type::IType){return increment ? "add" : "sub";},
+                    [increment](type::FType){return increment ? "fadd" : "fsub";},
+                    }, type::get<type::BasicType>(t));
+        auto one = c.make_literal(std::visit(type::overloaded{
+                    [](type::IType){return "1";},
+                    [](type::FType){return "1.0";},
+                    }, type::get<type::BasicType>(t)), t);
+        return codegen_utility::make_command(t, command, val, &one, c);
+    }
+    auto pointee = type::get<type::PointerType>(val->get_type()).pointed_type();
+    auto indices = std::vector<value::Value>{c.make_literal("0", type::IType::LLong),
+        c.make_literal(increment ? "1" : "-1", type::IType::Int)};
+    return codegen_utility::make_element_ptr(t, "getelementptr inbounds", type::ArrayType(pointee, std::nullopt),
+        val, indices, c);
+}
+//Aggregates of zeros become zeroinitializer, and arrays of chars become strings
+ir::Constant compact_constant(ir::Constant constant, bool char_elements){
+    if(std::all_of(constant.elements.begin(), constant.elements.end(), [](const ir::Constant& e){return ir::is_zero(e);})){
+        return ir::Constant::zero();
+    }
+    if(!char_elements){
+        return constant;
+    }
+    auto bytes = std::string();
+    bytes.reserve(constant.elements.size());
+    for(const auto& e : constant.elements){
+        if(e.kind != ir::Constant::Kind::Integer && e.kind != ir::Constant::Kind::Zero){
+            return constant;
         }
-    }else{
-        output<<"...";
+        bytes.push_back(static_cast<char>(e.integer));
     }
-    output<<")"<<std::endl;
+    return ir::Constant::of_string(std::move(bytes));
 }
-void global_decl_codegen(value::Value* value, std::ostream& output, context::Context& c, value::Value* def = nullptr){
+void global_decl_codegen(value::Value* value, context::Context& c, ir::Constant def = ir::Constant::zero()){
     assert(type::is_type<type::PointerType>(value->get_type()) && "Variable types must be stored as pointers");
     auto t = type::get<type::PointerType>(value->get_type()).pointed_type();
     if(type::is_type<type::FuncType>(t)){
-        global_func_type_codegen(value->get_value(), type::get<type::FuncType>(t), output);
+        c.module().globals.emplace_back(ir::FunctionDeclaration{*value});
     }else{
-        output << value->get_value() <<" = dso_local global "<<type::ir_type(t)<<" ";
-        if(def){
-            output << def->get_value() << std::endl;
-        }else{
-            output << codegen_utility::default_value(t)<<std::endl;
-        }
+        c.module().globals.emplace_back(ir::GlobalVariable{*value, std::move(def)});
     }
 }
-void string_codegen(value::Value* value, std::string literal, std::ostream& output, context::Context& c){
-    auto t = type::get<type::PointerType>(value->get_type()).pointed_type();
-    output << value->get_value() <<" = private unnamed_addr constant "<<type::ir_type(t);
-    output << type::ir_literal(literal) <<std::endl;
+//A union initialized through a member smaller than its largest is stored, as clang does, as a literal struct
+//of that member followed by enough bytes to fill the union, or nullopt if its first member is its largest
+std::optional<type::CType> padded_union_type(const type::CType& t, const context::Context& c){
+    auto union_type = lookup_tag<type::UnionType>(t, c.types());
+    if(union_type.members.empty() || type::ir_type(union_type.members.front()) == type::ir_type(union_type.largest)){
+        return std::nullopt;
+    }
+    const auto& member = union_type.members.front();
+    auto padding = type::size(t, c.types()) - type::size(member, c.types());
+    return type::StructType(union_type.tag, {member, type::ArrayType(type::IType::Char, padding)}, {});
 }
-
 } //namespace
 
-value::Value* AmbiguousBlock::codegen(std::ostream& output, context::Context& c) const{
+value::Value* AmbiguousBlock::codegen(context::Context& c) const{
     assert(parsed_item && "Cannot generate code for ambiguous block item before resolving ambiguity");
-    return parsed_item->codegen(output, c);
+    return parsed_item->codegen(c);
 }
 
 
-std::string InitializerList::compute_constant(type::CType type) const{
+ir::Constant InitializerList::initializer_constant(type::CType type) const{
     if(type::is_type<type::ArrayType>(type)){
         auto array_type = type::get<type::ArrayType>(type);
-        std::string literal = "[ ";
         auto element_type = array_type.pointed_type();
         assert(array_type.size() > 0 && "Cannot have array of size 0");
-        for(int i=0; i< array_type.size()-1; i++){
-            literal += type::ir_type(element_type) + " ";
+        auto elements = std::vector<ir::Constant>();
+        elements.reserve(array_type.size());
+        for(int i=0; i< array_type.size(); i++){
             if(i<this->initializers.size()){
-                literal += this->initializers.at(i)->compute_constant(element_type);
+                elements.push_back(this->initializers.at(i)->initializer_constant(element_type));
             }else{
-                literal += codegen_utility::default_value(element_type);
+                elements.push_back(ir::Constant::zero());
             }
-            literal += ", ";
         }
-        literal += type::ir_type(element_type) + " ";
-        if(array_type.size() <= this->initializers.size()){
-            literal += this->initializers.at(array_type.size() - 1)->compute_constant(element_type);
-        }else{
-            literal += codegen_utility::default_value(element_type);
-        }
-        literal += "]";
-        return literal;
+        return compact_constant(ir::Constant::aggregate(std::move(elements)), type::ir_type(element_type) == "i8");
     }else if(type::is_type<type::StructType>(type)){
         auto struct_type = type::get<type::StructType>(type);
         assert(struct_type.is_complete() && "Must have complete struct type to generate initializer");
-        std::string literal = "{ ";
-        auto size = struct_type.members.size();
-        if(size > 0){
-            for(int i=0; i< size-1; i++){
-                auto member_type = struct_type.members.at(i);
-                literal += type::ir_type(member_type) + " ";
-                if(i<this->initializers.size()){
-                    literal += this->initializers.at(i)->compute_constant(member_type);
-                }else{
-                    literal += codegen_utility::default_value(member_type);
-                }
-                literal += ", ";
-            }
-            literal += type::ir_type(struct_type.members.back()) + " ";
-            if(size <= this->initializers.size()){
-                literal += this->initializers.at(size- 1)->compute_constant(struct_type.members.back());
+        auto elements = std::vector<ir::Constant>();
+        elements.reserve(struct_type.members.size());
+        for(int i=0; i< struct_type.members.size(); i++){
+            auto member_type = struct_type.members.at(i);
+            if(i<this->initializers.size()){
+                elements.push_back(this->initializers.at(i)->initializer_constant(member_type));
             }else{
-                literal += codegen_utility::default_value(struct_type.members.back());
+                elements.push_back(ir::Constant::zero());
             }
         }
-        literal += "}";
-        return literal;
+        return compact_constant(ir::Constant::aggregate(std::move(elements)), false);
     }else{
         if(type::is_type<type::UnionType>(type)){
             auto union_type = type::get<type::UnionType>(type);
-            if(union_type.members.size() > 0){
-                return "{" +this->initializers.front()->compute_constant(type) +"}";
+            //Only a global's own type is looked up by tag, so a union in an array or struct does not give its members
+            if(!union_type.largest_computed && this->initializers.size() > 0){
+                throw std::runtime_error("Cannot initialize union "+union_type.tag+" inside an array or struct");
+            }
+            if(union_type.members.size() > 0 && this->initializers.size() > 0){
+                //The first member is initialized, but the union is stored as its largest member
+                auto member = this->initializers.front()->initializer_constant(union_type.members.front());
+                if(ir::is_zero(member)){
+                    return ir::Constant::zero();
+                }
+                if(type::ir_type(union_type.members.front()) != type::ir_type(union_type.largest)){
+                    //Followed by zeroed padding, so it has to be stored as the literal struct from padded_union_type
+                    return ir::Constant::aggregate({std::move(member), ir::Constant::zero()});
+                }
+                return ir::Constant::aggregate({std::move(member)});
             }else{
-                return codegen_utility::default_value(type);
+                return ir::Constant::zero();
             }
         }
         if(this->initializers.size() == 0){
-            return codegen_utility::default_value(type);
+            return ir::Constant::zero();
         }else{
-            return this->initializers.front()->compute_constant(type);
+            return this->initializers.front()->initializer_constant(type);
         }
     }
 }
+ir::Constant Expr::initializer_constant(type::CType type) const{
+    if(!type::is_type<type::BasicType>(type)){
+        assert(false && "Cannot have non-basic constant type in codegen yet");
+    }
+    //Converted as ir_literal converts them, so floats are rounded once to their own precision
+    const bool is_float = type::is_type<type::FType>(type);
+    const bool is_single = is_float && type::get<type::FType>(type) == type::FType::Float;
+    return std::visit(overloaded{
+        [](std::monostate){return ir::Constant::zero();},
+        [&](long long int i){
+            if(is_single){
+                return ir::Constant::of_float(static_cast<float>(i));
+            }
+            return is_float ? ir::Constant::of_float(static_cast<double>(i)) : ir::Constant::of_integer(i);
+        },
+        [&](long double d){
+            if(is_single){
+                return ir::Constant::of_float(static_cast<float>(d));
+            }
+            return is_float ? ir::Constant::of_float(static_cast<double>(d)) : ir::Constant::of_integer(static_cast<long long>(d));
+        },
+    }, this->constant_value);
+}
 std::string Expr::compute_constant(type::CType type) const{
     if(!type::is_type<type::BasicType>(type)){
         assert(false && "Cannot have non-basic constant type in codegen yet");
@@ -278,269 +302,268 @@ std::string Expr::compute_constant(type::CType type) const{
     return std::visit(overloaded{
         [](std::monostate)->std::string{return std::string{};},
         [&](long long int i)->std::string{
-            if(type::is_type<type::FType>(type)){
-                return std::to_string(static_cast<long double>(i));
-            }else{
-                return std::to_string(i);
-            }
+            return type::ir_literal(i, type::get<type::BasicType>(type));
         },
         [&](long double d)->std::string{
-            if(type::is_type<type::FType>(type)){
-                return type::ir_literal(std::to_string(d), type::get<type::BasicType>(type));
-            }else{
-                return std::to_string(d);
-            }
+            return type::ir_literal(d, type::get<type::BasicType>(type));
         },
     }, this->constant_value);
 }
 
-value::Value* Program::codegen(std::ostream& output, context::Context& c)const {
-    output<<R"(target triple = "x86_64-unknown-linux-gnu")"<<std::endl;
-
-    type::CType::tag_ir_types(output);
+void Program::codegen(std::ostream& output, context::Context& c)const {
+    codegen(c);
+    auto span = time_trace::Scope("Print IR");
+    auto writer = ir_writer::Writer(output);
+    ir::print(c.module(), writer);
+    writer.flush();
+}
+value::Value* Program::codegen(context::Context& c)const {
+    auto arena = types.arena_scope();
+    c.set_types(types);
+    //Function bodies may be generated in parallel, so layouts are filled in before they are shared
+    types.compute_layouts();
     for(const auto& decl : decls){
-        decl->codegen(output, c);
+        decl->codegen(c);
     }
+    c.generate_functions();
     auto undefined_symbols = c.undefined_globals();
     for(const auto& value : undefined_symbols){
-        global_decl_codegen(value, output, c);
+        global_decl_codegen(value, c);
     }
     auto strings = c.undefined_strings();
     for(const auto& pair : strings){
-        string_codegen(pair.first, pair.second, output, c);
+        c.module().globals.emplace_back(ir::StringConstant{*pair.first, pair.second});
     }
     return nullptr;
 }
-value::Value* GotoStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* GotoStmt::codegen(context::Context& c)const {
     int instruction_number = c.new_local_name(); 
-    std::string ir_label = ident_tok.value+".label";
-    c.change_block("aftergoto."+std::to_string(instruction_number),output, 
+    auto ir_label = basicblock::Label::user(c.intern_name(ident_tok.value));
+    c.change_block(basicblock::Label(basicblock::LabelKind::AfterGoto, instruction_number), 
         std::make_unique<basicblock::UCond_BR>(ir_label));
     return nullptr;
 }
-value::Value* LabeledStmt::codegen(std::ostream& output, context::Context& c)const {
-    std::string ir_label = ident_tok.value+".label";
-    c.change_block(ir_label, output, nullptr);
-    stmt->codegen(output, c);
+value::Value* LabeledStmt::codegen(context::Context& c)const {
+    auto ir_label = basicblock::Label::user(c.intern_name(ident_tok.value));
+    c.change_block(ir_label, nullptr);
+    stmt->codegen(c);
     return nullptr;
 }
-value::Value* NullStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* NullStmt::codegen(context::Context& c)const {
     //Do nothing
     return nullptr;
 }
-value::Value* Conditional::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Conditional::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(!std::holds_alternative<std::monostate>(this->constant_value)){
         return c.add_literal(this->compute_constant(this->type), this->type);
     }
-    auto condition = cond->codegen(output, c);
-    condition = codegen_utility::convert(type::IType::Bool,condition, output, c);
-    auto new_tmp = codegen_utility::make_tmp_alloca(this->type, output, c);
+    auto condition = cond->codegen(c);
+    condition = codegen_utility::convert(type::IType::Bool,condition, c);
+    auto new_tmp = codegen_utility::make_tmp_alloca(this->type, c);
 
     int instruction_number = c.new_local_name(); 
-    std::string true_label = "condtrue."+std::to_string(instruction_number);
-    std::string false_label = "condfalse." + std::to_string(instruction_number);
-    std::string end_label = "condend."+std::to_string(instruction_number);
-    c.change_block(true_label, output, 
-        std::make_unique<basicblock::Cond_BR>(condition, true_label,false_label));
-    auto t_value = true_expr->codegen(output, c);
-    codegen_utility::make_store(t_value,new_tmp, output, c);
+    auto true_label = basicblock::Label(basicblock::LabelKind::CondTrue, instruction_number);
+    auto false_label = basicblock::Label(basicblock::LabelKind::CondFalse, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::CondEnd, instruction_number);
+    c.change_block(true_label, 
+        std::make_unique<basicblock::Cond_BR>(*condition, true_label,false_label));
+    auto t_value = true_expr->codegen(c);
+    codegen_utility::make_store(t_value,new_tmp, c);
 
-    c.change_block(false_label, output,std::make_unique<basicblock::UCond_BR>(end_label));  
-    auto f_value = false_expr->codegen(output, c);
-    codegen_utility::make_store(f_value,new_tmp, output, c);
+    c.change_block(false_label, std::make_unique<basicblock::UCond_BR>(end_label));  
+    auto f_value = false_expr->codegen(c);
+    codegen_utility::make_store(f_value,new_tmp, c);
 
-    c.change_block(end_label,output,std::make_unique<basicblock::UCond_BR>(end_label));
-    return codegen_utility::make_load(new_tmp, output, c);
+    c.change_block(end_label, std::make_unique<basicblock::UCond_BR>(end_label));
+    return codegen_utility::make_load(new_tmp, c);
 }
 
-value::Value* IfStmt::codegen(std::ostream& output, context::Context& c)const {
-    auto condition = if_condition->codegen(output, c);
-    condition = codegen_utility::convert(type::IType::Bool,condition, output, c);
+value::Value* IfStmt::codegen(context::Context& c)const {
+    auto condition = if_condition->codegen(c);
+    condition = codegen_utility::convert(type::IType::Bool,condition, c);
     int instruction_number = c.new_local_name(); 
-    std::string true_label = "iftrue."+std::to_string(instruction_number);
-    std::string end_label = "ifend."+std::to_string(instruction_number);
-    std::string false_label;
+    auto true_label = basicblock::Label(basicblock::LabelKind::IfTrue, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::IfEnd, instruction_number);
+    auto false_label = end_label;
     if(this->else_body.has_value()){
-        false_label = "iffalse."+std::to_string(instruction_number);
-    }else{
-        false_label = "ifend."+std::to_string(instruction_number);
+        false_label = basicblock::Label(basicblock::LabelKind::IfFalse, instruction_number);
     }
-    c.change_block(true_label, output, 
-        std::make_unique<basicblock::Cond_BR>(condition, true_label,false_label));
+    c.change_block(true_label, 
+        std::make_unique<basicblock::Cond_BR>(*condition, true_label,false_label));
 
-    if_body->codegen(output, c);
+    if_body->codegen(c);
 
     if(this->else_body.has_value()){
-        c.change_block(false_label, output,std::make_unique<basicblock::UCond_BR>(end_label));
-        else_body.value()->codegen(output, c);
+        c.change_block(false_label, std::make_unique<basicblock::UCond_BR>(end_label));
+        else_body.value()->codegen(c);
     }
-    c.change_block(end_label,output,std::make_unique<basicblock::UCond_BR>(end_label));
+    c.change_block(end_label, std::make_unique<basicblock::UCond_BR>(end_label));
     return nullptr;
 }
-value::Value* CompoundStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* CompoundStmt::codegen(context::Context& c)const {
     c.enter_scope();
     for(const auto& stmt : stmt_body){
-        stmt->codegen(output, c);
+        auto temps = c.temp_mark();
+        stmt->codegen(c);
+        c.release_temps(temps);
     }
     c.exit_scope();
     return nullptr;
 }
-value::Value* FunctionDef::codegen(std::ostream& output, context::Context& c)const {
+value::Value* FunctionDef::codegen(context::Context& c)const {
+    if(!function_body){
+        //Lazily parsed static function which is never referenced
+        return nullptr;
+    }
     auto f_type = type::get<type::FuncType>(this->type);
     assert(!type::is_type<type::FuncType>(f_type.return_type()) && "Cannot return function types");
     if(this->tok.value == "main"){
         assert(f_type.return_type() == type::CType(type::IType::Int));
     }
-    auto func_value = c.add_global(this->name, this->type, true);
-    AST::print_whitespace(c.depth(), output);
-    output << "define dso_local "<<type::ir_type(f_type.return_type())<<" "<<func_value->get_value();
-
-    auto param_types = std::vector<type::CType>{};
-    for(const auto& p : params){
-        param_types.push_back(p->type);
-    }
-    c.enter_function(this->name, f_type.return_type(), param_types, output); 
-    for(int i = 0; i < params.size(); i++){
-        auto memory_var = params.at(i)->codegen(output, c);
-        auto passed_val = c.prev_temp(params.size()-1-i);
-        assert(passed_val != nullptr && "Could not find temp variable for passed value");
-        codegen_utility::make_store(passed_val,memory_var, output, c);
-    }
-    function_body->codegen(output, c);
-    c.exit_function(output);
+    auto func_value = c.add_global(this->name, this->type, this->symbol_id, true);
+    //The body only depends on the globals declared before it, so it can be generated in a context of its own
+    c.add_function([this, func_value, f_type](context::Context& c){
+        auto span = time_trace::Scope("Codegen function", this->name, this->tok.loc);
+        auto param_types = std::vector<type::CType>{};
+        for(const auto& p : params){
+            param_types.push_back(p->type);
+        }
+        c.enter_function(this->name, *func_value, f_type.return_type(), param_types);
+        for(int i = 0; i < params.size(); i++){
+            auto memory_var = params.at(i)->codegen(c);
+            auto passed_val = c.prev_temp(params.size()-1-i);
+            assert(passed_val != nullptr && "Could not find temp variable for passed value");
+            codegen_utility::make_store(passed_val,memory_var, c);
+        }
+        function_body->codegen(c);
+        c.exit_function();
+    });
     //Ultimately return value with
     //full function signature type
     //Once we add function argument/function types
     return nullptr;
 }
 
-value::Value* ReturnStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* ReturnStmt::codegen(context::Context& c)const {
     value::Value* return_value = nullptr;
     if(return_expr.has_value()){
-        return_value = return_expr.value()->codegen(output, c);
-        return_value = codegen_utility::convert(c.return_type(),std::move(return_value), output, c);
+        return_value = return_expr.value()->codegen(c);
+        return_value = codegen_utility::convert(c.return_type(),std::move(return_value), c);
     }
     int instruction_number = c.new_local_name(); 
-    c.change_block("afterret."+std::to_string(instruction_number),output, 
+    c.change_block(basicblock::Label(basicblock::LabelKind::AfterRet, instruction_number), 
         std::make_unique<basicblock::RET>(return_value));
     return nullptr;
 }
 
-value::Value* Variable::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Variable::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(!std::holds_alternative<std::monostate>(this->constant_value)){
         return c.add_literal(this->compute_constant(this->type), this->type);
     }
-    auto var_value = c.get_value(variable_name);
+    auto var_value = c.get_value(symbol_id);
     assert(type::is_type<type::PointerType>(var_value->get_type()) && "Variable not stored as pointer to the actual variable value");
     if(type::is_type<type::ArrayType>(type::get<type::PointerType>(var_value->get_type()).pointed_type())){
         return var_value;
     }
-    return codegen_utility::make_load(var_value,output,c);
+    return codegen_utility::make_load(var_value, c);
 }
 
-value::Value* DoStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* DoStmt::codegen(context::Context& c)const {
     int instruction_number = c.new_local_name(); 
-    std::string control_label = "docontrol."+std::to_string(instruction_number);
-    std::string body_label = "dobody."+std::to_string(instruction_number);
-    std::string end_label = "doend."+std::to_string(instruction_number);
+    auto control_label = basicblock::Label(basicblock::LabelKind::DoControl, instruction_number);
+    auto body_label = basicblock::Label(basicblock::LabelKind::DoBody, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::DoEnd, instruction_number);
     c.continue_targets.push_back(control_label);
     c.break_targets.push_back(end_label);
 
-    c.change_block(body_label,output,nullptr);
-    body->codegen(output, c);
-    c.change_block(control_label,output,nullptr);
-    auto control_value = codegen_utility::convert(type::from_str("_Bool"),control_expr->codegen(output, c),output, c);
-    c.change_block(end_label,output,std::make_unique<basicblock::Cond_BR>(control_value, body_label,end_label));
+    c.change_block(body_label, nullptr);
+    body->codegen(c);
+    c.change_block(control_label, nullptr);
+    auto control_value = codegen_utility::convert(type::basic_ctype(type::IType::Bool),control_expr->codegen(c), c);
+    c.change_block(end_label, std::make_unique<basicblock::Cond_BR>(*control_value, body_label,end_label));
     c.continue_targets.pop_back();
     c.break_targets.pop_back();
     return nullptr;
 }
-value::Value* CaseStmt::codegen(std::ostream& output, context::Context& c)const {
-    std::string case_val = std::to_string(std::get<long long int>(this->label->constant_value));
-    std::string case_label = "case."+std::to_string(c.switch_numbers.back())+"."+case_val;
-    c.change_block(case_label, output, nullptr);
-    stmt->codegen(output, c);
+value::Value* CaseStmt::codegen(context::Context& c)const {
+    auto case_label = basicblock::Label::switch_case(c.switch_numbers.back(), std::get<long long int>(this->label->constant_value));
+    c.change_block(case_label, nullptr);
+    stmt->codegen(c);
     return nullptr;
 }
-value::Value* DefaultStmt::codegen(std::ostream& output, context::Context& c)const {
-    std::string case_label = "case."+std::to_string(c.switch_numbers.back())+".default";
-    c.change_block(case_label, output, nullptr);
-    stmt->codegen(output, c);
+value::Value* DefaultStmt::codegen(context::Context& c)const {
+    auto case_label = basicblock::Label(basicblock::LabelKind::CaseDefault, c.switch_numbers.back());
+    c.change_block(case_label, nullptr);
+    stmt->codegen(c);
     return nullptr;
 }
-value::Value* SwitchStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* SwitchStmt::codegen(context::Context& c)const {
     assert(case_table && "Switch statement not analyzed");
-    auto control_value = codegen_utility::convert(control_type, control_expr->codegen(output, c), output, c);
+    auto control_value = codegen_utility::convert(control_type, control_expr->codegen(c), c);
     const auto instruction_number = c.new_local_name(); 
-    std::string end_label = "switchend."+std::to_string(instruction_number);
-    std::string case_label_head = "case."+std::to_string(instruction_number)+".";
-    std::string default_label = "switchend."+std::to_string(instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::SwitchEnd, instruction_number);
+    auto default_label = basicblock::Label(basicblock::LabelKind::SwitchEnd, instruction_number);
     c.switch_numbers.push_back(instruction_number);
     c.break_targets.push_back(end_label);
     if(case_table->find(std::nullopt) != case_table->end()){
-        default_label = "case."+std::to_string(instruction_number)+".default";
+        default_label = basicblock::Label(basicblock::LabelKind::CaseDefault, instruction_number);
     }
 
-    AST::print_whitespace(c.depth(), output);
-    output << "switch "<<type::ir_type(control_type)<<" "<<control_value->get_value()<<", label %";
-    output<<default_label<<" [ "<<std::endl;
+    auto cases = std::vector<std::pair<long long, basicblock::Label>>{};
     for(const auto& case_val : *case_table){
         if(case_val.has_value()){
-            AST::print_whitespace(c.depth()+5, output);
-            output << type::ir_type(control_type)<<" "<<case_val.value()<<", label %";
-            output << case_label_head <<case_val.value()<<std::endl;
+            cases.emplace_back(case_val.value(), basicblock::Label::switch_case(instruction_number, case_val.value()));
         }
     }
-    AST::print_whitespace(c.depth(), output);
-    output<<" ] "<<std::endl;
-    output<<"afterswitchcontrol."+std::to_string(instruction_number)<<":"<<std::endl;
+    c.change_block(basicblock::Label(basicblock::LabelKind::SwitchControl, instruction_number), 
+        std::make_unique<basicblock::Switch>(*control_value, default_label, std::move(cases)));
 
-    switch_body->codegen(output, c);
-    c.change_block(end_label, output, nullptr);
+    switch_body->codegen(c);
+    c.change_block(end_label, nullptr);
     c.break_targets.pop_back();
     c.switch_numbers.pop_back();
     //To do
     return nullptr;
 }
-value::Value* WhileStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* WhileStmt::codegen(context::Context& c)const {
     int instruction_number = c.new_local_name(); 
-    std::string control_label = "whilecontrol."+std::to_string(instruction_number);
-    std::string body_label = "whilebody."+std::to_string(instruction_number);
-    std::string end_label = "whileend."+std::to_string(instruction_number);
+    auto control_label = basicblock::Label(basicblock::LabelKind::WhileControl, instruction_number);
+    auto body_label = basicblock::Label(basicblock::LabelKind::WhileBody, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::WhileEnd, instruction_number);
     c.continue_targets.push_back(control_label);
     c.break_targets.push_back(end_label);
 
-    c.change_block(control_label,output,nullptr);
-    auto control_value = codegen_utility::convert(type::from_str("_Bool"),control_expr->codegen(output, c),output, c);
-    c.change_block(body_label,output,std::make_unique<basicblock::Cond_BR>(control_value, body_label,end_label));
-    body->codegen(output, c);
-    c.change_block(end_label,output,std::make_unique<basicblock::UCond_BR>(control_label));
+    c.change_block(control_label, nullptr);
+    auto control_value = codegen_utility::convert(type::basic_ctype(type::IType::Bool),control_expr->codegen(c), c);
+    c.change_block(body_label, std::make_unique<basicblock::Cond_BR>(*control_value, body_label,end_label));
+    body->codegen(c);
+    c.change_block(end_label, std::make_unique<basicblock::UCond_BR>(control_label));
     c.continue_targets.pop_back();
     c.break_targets.pop_back();
     return nullptr;
 }
-value::Value* BreakStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* BreakStmt::codegen(context::Context& c)const {
     int instruction_number = c.new_local_name(); 
-    c.change_block("afterbreak."+std::to_string(instruction_number),output, 
+    c.change_block(basicblock::Label(basicblock::LabelKind::AfterBreak, instruction_number), 
         std::make_unique<basicblock::UCond_BR>(c.break_targets.back()));
     return nullptr;
 }
-value::Value* ContinueStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* ContinueStmt::codegen(context::Context& c)const {
     int instruction_number = c.new_local_name(); 
-    c.change_block("aftercont."+std::to_string(instruction_number),output, 
+    c.change_block(basicblock::Label(basicblock::LabelKind::AfterCont, instruction_number), 
         std::make_unique<basicblock::UCond_BR>(c.continue_targets.back()));
     return nullptr;
 }
-value::Value* ForStmt::codegen(std::ostream& output, context::Context& c)const {
+value::Value* ForStmt::codegen(context::Context& c)const {
     //Initialize
     c.enter_scope();
     int instruction_number = c.new_local_name(); 
-    std::string control_label = "forcontrol."+std::to_string(instruction_number);
-    std::string body_label = "forbody."+std::to_string(instruction_number);
-    std::string post_label = "forpost."+std::to_string(instruction_number);
-    std::string end_label = "forend."+std::to_string(instruction_number);
+    auto control_label = basicblock::Label(basicblock::LabelKind::ForControl, instruction_number);
+    auto body_label = basicblock::Label(basicblock::LabelKind::ForBody, instruction_number);
+    auto post_label = basicblock::Label(basicblock::LabelKind::ForPost, instruction_number);
+    auto end_label = basicblock::Label(basicblock::LabelKind::ForEnd, instruction_number);
     c.continue_targets.push_back(post_label);
     c.break_targets.push_back(end_label);
 
@@ -548,20 +571,20 @@ value::Value* ForStmt::codegen(std::ostream& output, context::Context& c)const {
     std::visit(overloaded{
         [&](std::monostate) -> void{},
         [&](const auto& ast_node) -> void{
-            ast_node->codegen(output, c);
+            ast_node->codegen(c);
             },
     },this->init_clause);
 
-    c.change_block(control_label,output,nullptr);
-    auto control_value = codegen_utility::convert(type::from_str("_Bool"),control_expr->codegen(output, c),output, c);
-    c.change_block(body_label,output,std::make_unique<basicblock::Cond_BR>(control_value, body_label,end_label));
+    c.change_block(control_label, nullptr);
+    auto control_value = codegen_utility::convert(type::basic_ctype(type::IType::Bool),control_expr->codegen(c), c);
+    c.change_block(body_label, std::make_unique<basicblock::Cond_BR>(*control_value, body_label,end_label));
 
-    this->body->codegen(output, c);
-    c.change_block(post_label,output,nullptr);
+    this->body->codegen(c);
+    c.change_block(post_label, nullptr);
     if(this->post_expr.has_value()){
-        this->post_expr.value()->codegen(output, c);
+        this->post_expr.value()->codegen(c);
     }
-    c.change_block(end_label,output,std::make_unique<basicblock::UCond_BR>(control_label));
+    c.change_block(end_label, std::make_unique<basicblock::UCond_BR>(control_label));
 
     //Clean up
     c.continue_targets.pop_back();
@@ -569,259 +592,209 @@ value::Value* ForStmt::codegen(std::ostream& output, context::Context& c)const {
     c.exit_scope();
     return nullptr;
 }
-value::Value* DeclList::codegen(std::ostream& output, context::Context& c)const {
+value::Value* DeclList::codegen(context::Context& c)const {
     for(const auto& decl : decls){
-        decl->codegen(output, c);
+        decl->codegen(c);
     }
     return nullptr;
 }
-value::Value* FunctionDecl::codegen(std::ostream& output, context::Context& c)const {
-    c.add_global(this->name, this->type);
+value::Value* FunctionDecl::codegen(context::Context& c)const {
+    c.add_global(this->name, this->type, this->symbol_id);
     return nullptr;
 }
-void Expr::initializer_codegen(value::Value* variable, std::ostream& output, context::Context& c) const{
-    auto val = this->codegen(output, c);
+void Expr::initializer_codegen(value::Value* variable, context::Context& c) const{
+    auto val = this->codegen(c);
     auto var_type = type::get<type::PointerType>(variable->get_type()).pointed_type();
-    codegen_utility::make_store(codegen_utility::convert(var_type, val, output, c),variable, output, c);
+    codegen_utility::make_store(codegen_utility::convert(var_type, val, c),variable, c);
 }
-void InitializerList::initializer_codegen(value::Value* variable, std::ostream& output, context::Context& c) const{
+void InitializerList::initializer_codegen(value::Value* variable, context::Context& c) const{
     auto var_type = type::get<type::PointerType>(variable->get_type()).pointed_type();
     if(type::is_type<type::ArrayType>(var_type)){
         auto array_type = type::get<type::ArrayType>(var_type);
         assert(array_type.is_complete() && "Cannot have incomplete array types during codegen");
         for(int i=0; i<array_type.size(); i++){
-            auto element_ptr = c.new_temp(type::PointerType(array_type.pointed_type()));
-            codegen_utility::print_whitespace(c.depth(), output);
-            output << element_ptr->get_value() <<" = getelementptr inbounds "+type::ir_type(var_type)+", ptr ";
-            output <<variable->get_value()<<", i64 0, i32 "<<i<<std::endl;
+            auto indices = std::vector<value::Value>{c.make_literal("0", type::IType::LLong), 
+                c.make_literal(std::to_string(i), type::IType::Int)};
+            auto element_ptr = codegen_utility::make_element_ptr(type::PointerType(array_type.pointed_type()), 
+                "getelementptr inbounds", var_type, variable, indices, c);
             if(i<initializers.size()){
-                initializers.at(i)->initializer_codegen(element_ptr, output, c);
+                initializers.at(i)->initializer_codegen(element_ptr, c);
             }else{
-                auto default_val = value::Value(codegen_utility::default_value(array_type.pointed_type()), array_type.pointed_type());
-                codegen_utility::make_store(&default_val,element_ptr, output, c);
+                auto default_val = c.make_literal(codegen_utility::default_value(array_type.pointed_type()), array_type.pointed_type());
+                codegen_utility::make_store(&default_val,element_ptr, c);
             }
         }
     }else if(type::is_type<type::StructType>(var_type)){
-        auto struct_type = lookup_tag<type::StructType>(var_type);
+        auto struct_type = lookup_tag<type::StructType>(var_type, c.types());
         int size = struct_type.members.size();
         for(int i=0; i<size; i++){
             auto member_type = struct_type.members.at(i);
-            auto element_ptr = c.new_temp(type::PointerType(member_type));
-            codegen_utility::print_whitespace(c.depth(), output);
-            output << element_ptr->get_value() <<" = getelementptr "+type::ir_type(var_type)+", ptr ";
-            output <<variable->get_value()<<", i64 0, i32 "<<i<<std::endl;
+            auto indices = std::vector<value::Value>{c.make_literal("0", type::IType::LLong), 
+                c.make_literal(std::to_string(i), type::IType::Int)};
+            auto element_ptr = codegen_utility::make_element_ptr(type::PointerType(member_type), "getelementptr", 
+                var_type, variable, indices, c);
             if(i<initializers.size()){
-                initializers.at(i)->initializer_codegen(element_ptr, output, c);
+                initializers.at(i)->initializer_codegen(element_ptr, c);
             }else{
-                auto default_val = value::Value(codegen_utility::default_value(member_type), member_type);
-                codegen_utility::make_store(&default_val,element_ptr, output, c);
+                auto default_val = c.make_literal(codegen_utility::default_value(member_type), member_type);
+                codegen_utility::make_store(&default_val,element_ptr, c);
             }
         }
     }else if(type::is_type<type::UnionType>(var_type)){
-        auto union_type = lookup_tag<type::UnionType>(var_type);
+        auto union_type = lookup_tag<type::UnionType>(var_type, c.types());
         auto member_type = union_type.members.front();
-        auto element_ptr = codegen_utility::convert(type::PointerType(member_type), variable, output, c);
+        auto element_ptr = codegen_utility::convert(type::PointerType(member_type), variable, c);
         //No need to get element pointer since we just type pun with everything at the same location
         if(initializers.size() > 0){
-            initializers.front()->initializer_codegen(element_ptr, output, c);
+            initializers.front()->initializer_codegen(element_ptr, c);
         }else{
-            auto default_val = value::Value(codegen_utility::default_value(member_type), member_type);
-            codegen_utility::make_store(&default_val,element_ptr, output, c);
+            auto default_val = c.make_literal(codegen_utility::default_value(member_type), member_type);
+            codegen_utility::make_store(&default_val,element_ptr, c);
         }
     }else{
         //Scalars
         assert(initializers.size() > 0 && "Tried to assign empty initializer list to scalar");
-        initializers.front()->initializer_codegen(variable, output, c);
+        initializers.front()->initializer_codegen(variable, c);
     }
 }
-value::Value* EnumVarDecl::codegen(std::ostream& output, context::Context& c)const {
+value::Value* EnumVarDecl::codegen(context::Context& c)const {
     assert(false && "Should never be called");
     return nullptr;
 }
-value::Value* TypeDecl::codegen(std::ostream& output, context::Context& c)const {
+value::Value* TypeDecl::codegen(context::Context& c)const {
     assert(false && "Should never be called");
     return nullptr;
 }
-value::Value* VarDecl::codegen(std::ostream& output, context::Context& c)const {
+value::Value* VarDecl::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(c.in_function()){
-        auto variable = c.add_local(name, type);
-        AST::print_whitespace(c.depth(), output);
-        output << variable->get_value() <<" = alloca "<<type::ir_type(type) <<std::endl;
+        auto variable = c.add_local(name, type, this->symbol_id);
+        c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Alloca, nullptr, *variable, type, {}));
         if(this->assignment.has_value()){
             if(auto str = dynamic_cast<ast::StrLiteral*>(this->assignment.value().get())){
                 auto literal = c.add_literal(type::ir_literal(str->literal), this->type);
-                codegen_utility::make_store(literal,variable, output, c);
+                codegen_utility::make_store(literal,variable, c);
             }else{
-                this->assignment.value()->initializer_codegen(variable, output, c);
+                this->assignment.value()->initializer_codegen(variable, c);
             }
         }
         return variable;
     }else{
-            auto value = c.add_global(this->name, this->type, assignment.has_value());
+            auto value = c.add_global(this->name, this->type, this->symbol_id, assignment.has_value());
         if(this->assignment.has_value()){
             if(auto str = dynamic_cast<ast::StrLiteral*>(this->assignment.value().get())){
-                auto def_value = value::Value(type::ir_literal(str->literal),this->type);
-                global_decl_codegen(value, output, c, &def_value);
+                global_decl_codegen(value, c, ir::Constant::of_string(str->literal));
             }else{
                 auto t = this->type;
                 if(type::is_type<type::StructType>(this->type)){
-                    t = lookup_tag<type::StructType>(this->type);
+                    t = lookup_tag<type::StructType>(this->type, c.types());
                 }
                 if(type::is_type<type::UnionType>(this->type)){
-                    t = lookup_tag<type::UnionType>(this->type);
+                    t = lookup_tag<type::UnionType>(this->type, c.types());
+                }
+                //Kept as a tree and only written out when the module is printed
+                auto initializer = this->assignment.value()->initializer_constant(t);
+                if(type::is_type<type::UnionType>(t) && initializer.kind == ir::Constant::Kind::Aggregate
+                    && initializer.elements.size() > 1){
+                    auto padded = padded_union_type(this->type, c);
+                    assert(padded && "Only a union whose first member is smaller than its largest is padded");
+                    c.module().globals.emplace_back(ir::GlobalVariable{*value, std::move(initializer), std::move(padded),
+                        type::align(this->type, c.types())});
+                }else{
+                    global_decl_codegen(value, c, std::move(initializer));
                 }
-                auto def = c.add_literal(this->assignment.value()->compute_constant(t),this->type);
-                global_decl_codegen(value, output, c, def);
             }
         }
         return value;
     }
 }
 
-value::Value* StrLiteral::codegen(std::ostream& output, context::Context& c)const {
+value::Value* StrLiteral::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     //To be generated later
     return c.add_string(this->literal, this->type);
 }
-value::Value* Sizeof::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Sizeof::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
-    return c.add_literal(std::to_string(type::size(arg->type)), this->type);
+    return c.add_literal(std::to_string(type::size(arg->type, c.types())), this->type);
 }
-value::Value* Alignof::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Alignof::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
-    return c.add_literal(std::to_string(type::align(arg->type)), this->type);
+    return c.add_literal(std::to_string(type::align(arg->type, c.types())), this->type);
 }
-value::Value* Constant::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Constant::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     return c.add_literal(type::ir_literal(this->literal,type::get<type::BasicType>(this->type)), this->type);
 }
-value::Value* FuncCall::codegen(std::ostream& output, context::Context& c)const {
+value::Value* FuncCall::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
-    auto function = this->func->codegen(output, c);
+    auto function = this->func->codegen(c);
 
     auto arg_values = std::vector<value::Value*>{};
     for(auto& expr : this->args){
-        arg_values.push_back(expr->codegen(output, c));
-    }
-    value::Value* return_val = nullptr;
-    print_whitespace(c.depth(), output);
-    if(this->type != type::CType(type::VoidType())){
-        return_val = c.new_temp(this->type);
-        output << return_val->get_value() <<" = ";
-    }
-    output << "call "<<type::ir_type(this->type);
-    output <<" "<<function->get_value()<<"(";
-    if(arg_values.size() > 0){
-        for(int i=0; i<arg_values.size() - 1; i++){
-            output<<type::ir_type(arg_values.at(i)->get_type())<<" noundef "<<arg_values.at(i)->get_value()<<", ";
-        }
-        output<<type::ir_type(arg_values.back()->get_type())<<" noundef "<<arg_values.back()->get_value();
+        arg_values.push_back(expr->codegen(c));
     }
-    output<<")"<<std::endl;
-    return return_val;
+    return codegen_utility::make_call(this->type, function, arg_values, c);
 }
 
-value::Value* ArrayAccess::codegen(std::ostream& output, context::Context& c)const {
+value::Value* ArrayAccess::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
-    auto addr = compute_array_ptr(this, output, c);
-    return codegen_utility::make_load(addr,output,c);
+    auto addr = compute_array_ptr(this, c);
+    return codegen_utility::make_load(addr, c);
 }
-value::Value* MemberAccess::codegen(std::ostream& output, context::Context& c)const {
+value::Value* MemberAccess::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(type::is_type<type::StructType>(this->arg->type)){
-        auto arg = this->arg->codegen(output, c);
-
-        auto addr = c.new_temp(this->type);
-        codegen_utility::print_whitespace(c.depth(), output);
-        output << addr->get_value() <<" = extractvalue "<<type::ir_type(this->arg->type)<<" ";
-        auto s_type = lookup_tag<type::StructType>(this->arg->type);
-        output << arg->get_value()<<", "<<s_type.indices.at(this->index)<<std::endl;
-        return addr;
+        auto arg = this->arg->codegen(c);
+
+        auto s_type = lookup_tag<type::StructType>(this->arg->type, c.types());
+        return codegen_utility::make_extract_value(this->type, arg, s_type.indices.at(this->index), c);
     }else{
         assert(type::is_type<type::UnionType>(this->arg->type));
-        auto u_type = lookup_tag<type::UnionType>(this->arg->type);
+        auto u_type = lookup_tag<type::UnionType>(this->arg->type, c.types());
         auto member_type = u_type.members.at(u_type.indices.at(this->index));
         if(is_lval(this->arg.get())){
-            auto arg_ptr = get_lval(this->arg.get(), output, c);
-            auto element_ptr = codegen_utility::convert(type::PointerType(member_type), arg_ptr, output, c);
-            return codegen_utility::make_load(element_ptr,output,c);
+            auto arg_ptr = get_lval(this->arg.get(), c);
+            auto element_ptr = codegen_utility::convert(type::PointerType(member_type), arg_ptr, c);
+            return codegen_utility::make_load(element_ptr, c);
         }else{
-            auto arg = this->arg->codegen(output, c);
+            auto arg = this->arg->codegen(c);
             //If not an l-val, we don't have a pointer; if we're taking the 0th element, that's okay
             if(u_type.indices.at(this->index) == 0){
-                auto addr = c.new_temp(this->type);
-                codegen_utility::print_whitespace(c.depth(), output);
-                output << addr->get_value() <<" = extractvalue "<<type::ir_type(this->arg->type)<<" ";
-                output << arg->get_value()<<", 0"<<std::endl;
-                return addr;
+                return codegen_utility::make_extract_value(this->type, arg, 0, c);
             }else{
             //Otherwise we need to create a copy of the union where we do have a pointer
             //Note that bitcast doesn't work since it can only be used with first class types
-                auto var = codegen_utility::make_tmp_alloca(this->arg->type, output, c);
-                codegen_utility::make_store(arg, var, output, c);
-                var = codegen_utility::convert(type::PointerType(member_type), var, output, c);
-                return codegen_utility::make_load(var, output, c);
+                auto var = codegen_utility::make_tmp_alloca(this->arg->type, c);
+                codegen_utility::make_store(arg, var, c);
+                var = codegen_utility::convert(type::PointerType(member_type), var, c);
+                return codegen_utility::make_load(var, c);
             }
         }
     }
 }
-value::Value* Postfix::codegen(std::ostream& output, context::Context& c)const {
+value::Value* Postfix::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
-    auto operand = arg->codegen(output, c);
+    auto operand = arg->codegen(c);
     switch(tok.type){
         case token::TokenType::Plusplus:
         {
-            auto var_reg = get_lval(arg.get(), output, c);
-            auto ret_val = codegen_utility::make_load(var_reg, output, c);
+            auto var_reg = get_lval(arg.get(), c);
+            auto ret_val = codegen_utility::make_load(var_reg, c);
             auto initial_type = ret_val->get_type();
-            ret_val = codegen_utility::convert(this->type, ret_val, output, c);
-            codegen_utility::print_whitespace(c.depth(), output);
-            auto new_var = c.new_temp(this->type);
-            if(type::is_type<type::BasicType>(this->type)){
-                std::string command = std::visit(type::overloaded{
-                            [](type::IType){return "add";},
-                            [](type::FType){return "fadd";},
-                            }, type::get<type::BasicType>(this->type));
-
-                output << new_var->get_value()<<" = "<<command<<" "<<type::ir_type(this->type)<<" "<<ret_val->get_value();
-                output <<std::visit(type::overloaded{
-                            [](type::IType){return ", 1";},
-                            [](type::FType){return ", 1.0";},
-                            }, type::get<type::BasicType>(this->type)) <<std::endl;
-            }else{
-                output << new_var->get_value() <<" = getelementptr inbounds [0 x ";
-                output <<type::ir_type(type::get<type::PointerType>(ret_val->get_type()).pointed_type());
-                output <<"], ptr "<<ret_val->get_value()<<", i64 0, i32 1"<<std::endl;
-            }
-            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, output, c),var_reg, output, c);
+            ret_val = codegen_utility::convert(this->type, ret_val, c);
+            auto new_var = step_codegen(this->type, ret_val, true, c);
+            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, c),var_reg, c);
             return ret_val;
         }
         case token::TokenType::Minusminus:
         {
-            auto var_reg = get_lval(arg.get(), output, c);
-            auto ret_val = codegen_utility::make_load(var_reg, output, c);
+            auto var_reg = get_lval(arg.get(), c);
+            auto ret_val = codegen_utility::make_load(var_reg, c);
             auto initial_type = ret_val->get_type();
-            ret_val = codegen_utility::convert(this->type, ret_val, output, c);
-            codegen_utility::print_whitespace(c.depth(), output);
-            auto new_var = c.new_temp(this->type);
-            if(type::is_type<type::BasicType>(this->type)){
-                std::string command = std::visit(type::overloaded{
-                            [](type::IType){return "sub";},
-                            [](type::FType){return "fsub";},
-                            }, type::get<type::BasicType>(this->type));
-
-                output << new_var->get_value()<<" = "<<command<<" "<<type::ir_type(this->type)<<" "<<ret_val->get_value();
-                output <<std::visit(type::overloaded{
-                            [](type::IType){return ", 1";},
-                            [](type::FType){return ", 1.0";},
-                            }, type::get<type::BasicType>(this->type)) <<std::endl;
-            }else{
-                output << new_var->get_value() <<" = getelementptr inbounds [0 x ";
-                output <<type::ir_type(type::get<type::PointerType>(ret_val->get_type()).pointed_type());
-                output <<"], ptr "<<ret_val->get_value()<<", i64 0, i32 -1"<<std::endl;
-            }
-            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, output, c),var_reg, output, c);
+            ret_val = codegen_utility::convert(this->type, ret_val, c);
+            auto new_var = step_codegen(this->type, ret_val, false, c);
+            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, c),var_reg, c);
             return ret_val;
         }
         default:
@@ -829,131 +802,89 @@ value::Value* Postfix::codegen(std::ostream& output, context::Context& c)const {
     }
     __builtin_unreachable();
 }
-value::Value* UnaryOp::codegen(std::ostream& output, context::Context& c)const {
+value::Value* UnaryOp::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(!std::holds_alternative<std::monostate>(this->constant_value)){
         return c.add_literal(this->compute_constant(this->type), this->type);
     }
-    std::string t = type::ir_type(this->type);
+    auto t = type::ir_type(this->type);
     switch(tok.type){
         case token::TokenType::Plusplus:
         {
-            auto var_reg = get_lval(arg.get(), output, c);
-            auto ret_val = codegen_utility::make_load(var_reg, output, c);
+            auto var_reg = get_lval(arg.get(), c);
+            auto ret_val = codegen_utility::make_load(var_reg, c);
             auto initial_type = ret_val->get_type();
-            ret_val = codegen_utility::convert(this->type, ret_val, output, c);
-            codegen_utility::print_whitespace(c.depth(), output);
-            auto new_var = c.new_temp(this->type);
-            if(type::is_type<type::BasicType>(this->type)){
-                std::string command = std::visit(type::overloaded{
-                            [](type::IType){return "add";},
-                            [](type::FType){return "fadd";},
-                            }, type::get<type::BasicType>(this->type));
-
-                output << new_var->get_value()<<" = "<<command<<" "<<type::ir_type(this->type)<<" "<<ret_val->get_value();
-                output <<std::visit(type::overloaded{
-                            [](type::IType){return ", 1";},
-                            [](type::FType){return ", 1.0";},
-                            }, type::get<type::BasicType>(this->type)) <<std::endl;
-            }else{
-                output << new_var->get_value() <<" = getelementptr inbounds [0 x ";
-                output <<type::ir_type(type::get<type::PointerType>(ret_val->get_type()).pointed_type());
-                output <<"], ptr "<<ret_val->get_value()<<", i64 0, i32 1"<<std::endl;
-            }
-            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, output, c),var_reg, output, c);
+            ret_val = codegen_utility::convert(this->type, ret_val, c);
+            auto new_var = step_codegen(this->type, ret_val, true, c);
+            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, c),var_reg, c);
             return new_var;
         }
         case token::TokenType::Minusminus:
         {
-            auto var_reg = get_lval(arg.get(), output, c);
-            auto ret_val = codegen_utility::make_load(var_reg, output, c);
+            auto var_reg = get_lval(arg.get(), c);
+            auto ret_val = codegen_utility::make_load(var_reg, c);
             auto initial_type = ret_val->get_type();
-            ret_val = codegen_utility::convert(this->type, ret_val, output, c);
-            codegen_utility::print_whitespace(c.depth(), output);
-            auto new_var = c.new_temp(this->type);
-            if(type::is_type<type::BasicType>(this->type)){
-                std::string command = std::visit(type::overloaded{
-                            [](type::IType){return "sub";},
-                            [](type::FType){return "fsub";},
-                            }, type::get<type::BasicType>(this->type));
-
-                output << new_var->get_value()<<" = "<<command<<" "<<type::ir_type(this->type)<<" "<<ret_val->get_value();
-                output <<std::visit(type::overloaded{
-                            [](type::IType){return ", 1";},
-                            [](type::FType){return ", 1.0";},
-                            }, type::get<type::BasicType>(this->type)) <<std::endl;
-            }else{
-                output << new_var->get_value() <<" = getelementptr inbounds [0 x ";
-                output <<type::ir_type(type::get<type::PointerType>(ret_val->get_type()).pointed_type());
-                output <<"], ptr "<<ret_val->get_value()<<", i64 0, i32 -1"<<std::endl;
-            }
-            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, output, c),var_reg, output, c);
+            ret_val = codegen_utility::convert(this->type, ret_val, c);
+            auto new_var = step_codegen(this->type, ret_val, false, c);
+            codegen_utility::make_store(codegen_utility::convert(initial_type, new_var, c),var_reg, c);
             return new_var;
         }
         case token::TokenType::Plus:
-            return codegen_utility::convert(this->type, arg->codegen(output,c), output, c);
+            return codegen_utility::convert(this->type, arg->codegen(c), c);
         case token::TokenType::Minus:
         {
-            auto operand = arg->codegen(output, c);
-            operand =  codegen_utility::convert(this->type, std::move(operand), output, c);
+            auto operand = arg->codegen(c);
+            operand =  codegen_utility::convert(this->type, std::move(operand), c);
             //sub or fsub
             assert(type::is_type<type::BasicType>(operand->get_type()) && "Can only perform unary - on basic type");
             auto operand_type = type::get<type::BasicType>(operand->get_type());
-            std::string command = std::visit(type::overloaded{
+            const char* command = std::visit(type::overloaded{
                 [](type::IType){return "sub";},
                 [](type::FType){return "fsub";},
                 }, operand_type);
-            
-            AST::print_whitespace(c.depth(), output);
-            auto new_temp = c.new_temp(this->type);
-            output << new_temp->get_value()<<" = "<<command<<" "<<t<<std::visit(type::overloaded{
-                [](type::IType){return " 0, ";},
-                [](type::FType){return " 0.0, ";},
-                }, operand_type) <<operand->get_value() <<std::endl;
-            return new_temp;
+            auto zero = c.make_literal(std::visit(type::overloaded{
+                [](type::IType){return "0";},
+                [](type::FType){return "0.0";},
+                }, operand_type), this->type);
+            return codegen_utility::make_command(this->type, command, &zero, operand, c);
         }
         case token::TokenType::BitwiseNot:
         {
-            auto operand = arg->codegen(output, c);
-            operand =  codegen_utility::convert(this->type, std::move(operand), output, c);
-            AST::print_whitespace(c.depth(), output);
-            auto new_temp = c.new_temp(this->type);
-            output << new_temp->get_value()<<" = xor "<<t<<" -1, " <<operand->get_value() <<std::endl;
-            return new_temp;
+            auto operand = arg->codegen(c);
+            operand =  codegen_utility::convert(this->type, std::move(operand), c);
+            auto minus_one = c.make_literal("-1", this->type);
+            return codegen_utility::make_command(this->type, "xor", &minus_one, operand, c);
         }
         case token::TokenType::Not:
         {
-            auto operand = arg->codegen(output, c);
+            auto operand = arg->codegen(c);
             if(type::is_type<type::PointerType>(operand->get_type())||type::is_type<type::ArrayType>(operand->get_type())){
-                operand = codegen_utility::convert(type::IType::LLong, operand, output, c);
+                operand = codegen_utility::convert(type::IType::LLong, operand, c);
             }
             assert(t == "i32");
             assert(type::is_type<type::BasicType>(operand->get_type()) && "Non-basic types for unary not should have been converted");
             auto operand_type = type::get<type::BasicType>(operand->get_type());
             //icmp or fcmp
-            std::string command = std::visit(type::overloaded{
+            const char* command = std::visit(type::overloaded{
                 [](type::IType){return "icmp eq";},
                 [](type::FType){return "fcmp oeq";},
                 }, operand_type);
+            auto zero = c.make_literal(std::visit(type::overloaded{
+                [](type::IType){return "0";},
+                [](type::FType){return "0.0";},
+                }, operand_type), operand->get_type());
+            auto intermediate_bool = codegen_utility::make_command(type::IType::Bool, command, &zero, operand, c);
 
-            AST::print_whitespace(c.depth(), output);
-            auto intermediate_bool = c.new_temp(type::IType::Bool);
-            output << intermediate_bool->get_value() <<" = "<<command<<" "<<type::ir_type(operand->get_type());
-            output << std::visit(type::overloaded{
-                [](type::IType){return " 0, ";},
-                [](type::FType){return " 0.0, ";},
-                }, operand_type) << operand->get_value() <<std::endl;
-
-            return codegen_utility::convert(this->type, intermediate_bool, output, c);
+            return codegen_utility::convert(this->type, intermediate_bool, c);
         }
         case token::TokenType::Amp:
         {
-            return get_lval(arg.get(), output, c);
+            return get_lval(arg.get(), c);
         }
         case token::TokenType::Star:
         {
-            auto operand = arg->codegen(output, c);
-            return codegen_utility::make_load(operand, output, c);
+            auto operand = arg->codegen(c);
+            return codegen_utility::make_load(operand, c);
         }
         default:
             assert(false && "Operator Not Implemented");
@@ -962,47 +893,21 @@ value::Value* UnaryOp::codegen(std::ostream& output, context::Context& c)const {
 }
 
 
-value::Value* BinaryOp::codegen(std::ostream& output, context::Context& c)const {
+value::Value* BinaryOp::codegen(context::Context& c)const {
     assert(this->analyzed && "This AST node has not had analysis run on it");
     if(!std::holds_alternative<std::monostate>(this->constant_value)){
         return c.add_literal(this->compute_constant(this->type), this->type);
     }
-    switch(tok.type){
-        case token::TokenType::PlusAssign:
-        case token::TokenType::MinusAssign:
-        case token::TokenType::DivAssign:
-        case token::TokenType::MultAssign:
-        case token::TokenType::ModAssign:
-        case token::TokenType::BAAssign:
-        case token::TokenType::BOAssign:
-        case token::TokenType::BXAssign:
-        case token::TokenType::LSAssign:
-        case token::TokenType::RSAssign:
-        case token::TokenType::Assign:
-            return assignment_codegen(this, output, c);
-        case token::TokenType::And:
-        case token::TokenType::Or:
-            return short_circuit_codegen(this, output, c);
-        case token::TokenType::Minus:
-        case token::TokenType::Plus:
-        case token::TokenType::Div:
-        case token::TokenType::Star:
-        case token::TokenType::Mod:
-        case token::TokenType::Equal:
-        case token::TokenType::NEqual:
-        case token::TokenType::Less:
-        case token::TokenType::Greater:
-        case token::TokenType::LEq:
-        case token::TokenType::GEq:
-        case token::TokenType::LShift:
-        case token::TokenType::RShift:
-        case token::TokenType::Amp:
-        case token::TokenType::BitwiseOr:
-        case token::TokenType::BitwiseXor:
-        case token::TokenType::Comma:
-            return other_bin_op_codegen(this, output, c);
+    switch(operators::binary_operator(tok.type).kind){
+        case operators::Kind::Assignment:
+            return assignment_codegen(this, c);
+        case operators::Kind::Logical:
+            return short_circuit_codegen(this, c);
+        case operators::Kind::None:
+            assert(false && "Unknown binary op during codegen");
+            break;
         default:
-            assert(false && "Unknown binary assignment op during codegen");
+            return other_bin_op_codegen(this, c);
     }
     __builtin_unreachable();
 }
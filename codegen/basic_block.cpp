@@ -2,54 +2,161 @@
 #include "codegen/codegen_utility.h"
 
 namespace basicblock{
+namespace{
+constexpr auto label_prefixes = std::array<const char*, static_cast<std::size_t>(LabelKind::User) + 1>{
+    "function.enter", "logical_op_no_sc.", "logical_op_end.", "condtrue.", "condfalse.", "condend.",
+    "iftrue.", "iffalse.", "ifend.", "docontrol.", "dobody.", "doend.",
+    "whilecontrol.", "whilebody.", "whileend.", "forcontrol.", "forbody.", "forpost.", "forend.",
+    "afterswitchcontrol.", "switchend.", "case.", "case.", "afterret.", "aftergoto.", "afterbreak.", "aftercont.", ""
+};
+}//namespace
+const char* Label::prefix(LabelKind kind){
+    return label_prefixes[static_cast<std::size_t>(kind)];
+}
+std::ostream& operator<<(std::ostream& output, const Label& label){
+    label.print(output);
+    return output;
+}
+ir_writer::Writer& operator<<(ir_writer::Writer& output, const Label& label){
+    label.print(output);
+    return output;
+}
+namespace{
+void print_typed(const value::Value& v, ir_writer::Writer& output){
+    output << type::ir_type(v.get_type()) << " " << v.get_value();
+}
+}//namespace
+void Instruction::print(ir_writer::Writer& output) const{
+    if(result){
+        output << result->get_value() << " = ";
+    }
+    switch(kind){
+        case Kind::Alloca:
+            output << "alloca " << type::ir_type(type);
+            break;
+        case Kind::Load:
+            output << "load " << type::ir_type(type) << ", ";
+            print_typed(operands.at(0), output);
+            break;
+        case Kind::Store:
+            output << "store ";
+            print_typed(operands.at(0), output);
+            output << ", ";
+            print_typed(operands.at(1), output);
+            break;
+        case Kind::GetElementPtr:
+            output << opcode << " " << type::ir_type(type) << ", ptr " << operands.at(0).get_value();
+            for(std::size_t i = 1; i < operands.size(); i++){
+                output << ", ";
+                print_typed(operands[i], output);
+            }
+            break;
+        case Kind::ExtractValue:
+            output << "extractvalue " << type::ir_type(type) << " " << operands.at(0).get_value();
+            output << ", " << operands.at(1).get_value();
+            break;
+        case Kind::Call:
+            output << "call " << type::ir_type(type) << " " << operands.at(0).get_value() << "(";
+            for(std::size_t i = 1; i < operands.size(); i++){
+                if(i > 1){
+                    output << ", ";
+                }
+                output << type::ir_type(operands[i].get_type()) << " noundef " << operands[i].get_value();
+            }
+            output << ")";
+            break;
+        case Kind::Cast:
+            assert(result && "Cast without a result");
+            output << opcode << " ";
+            print_typed(operands.at(0), output);
+            output << " to " << type::ir_type(result->get_type());
+            break;
+        case Kind::Binary:
+            output << opcode << " " << type::ir_type(type) << " " << operands.at(0).get_value();
+            output << ", " << operands.at(1).get_value();
+            break;
+    }
+}
 Terminator::~Terminator (){}
-std::string RET::get_instruction(){
+RET::RET(const value::Value* v){
+    if(v){
+        ret_val.emplace(*v);
+    }
+}
+void RET::print(ir_writer::Writer& output) const{
     if(ret_val){
-        return "ret "+type::ir_type(ret_val->get_type())+" "+ret_val->get_value();
+        output << "ret ";
+        print_typed(*ret_val, output);
     }else{
-        return "ret void";
+        output << "ret void";
     }
 }
-std::string DefaultRet::get_instruction(){
+void DefaultRet::print(ir_writer::Writer& output) const{
     if(type::is_type<type::ArrayType>(type)){
         throw std::runtime_error("Cannot have array type as return value");
     }
     if(type::is_type<type::VoidType>(type)){
-        return "ret void";
+        output << "ret void";
     }else{
-        return "ret "+type::ir_type(type)+" "+codegen_utility::default_value(type);
+        output << "ret " << type::ir_type(type) << " " << codegen_utility::default_value(type);
     }
 }
-Cond_BR::Cond_BR(value::Value* cond, std::string tl, std::string fl) :
+Cond_BR::Cond_BR(const value::Value& cond, Label tl, Label fl) :
     cond(cond), t_label(tl), f_label(fl){
-    assert(cond && "Tried to create conditional branch with no condition");
-    assert(type::ir_type(cond->get_type())=="i1" 
+    assert(type::ir_type(cond.get_type())=="i1"
         && "Tried to create conditional branch with non bool condition");
 }
-std::string Cond_BR::get_instruction() {
-    auto ss = std::stringstream{};
-    ss << "br "<<type::ir_type(cond->get_type())<<" "<<cond->get_value()<<", label %";
-    ss << t_label <<", label %"<<f_label;
-    return ss.str();
+void Cond_BR::print(ir_writer::Writer& output) const{
+    output << "br ";
+    print_typed(cond, output);
+    output << ", label %" << t_label <<", label %"<<f_label;
+}
+void UCond_BR::print(ir_writer::Writer& output) const{
+    output << "br label %" << label;
 }
-std::string UCond_BR::get_instruction() {
-    return "br label %"+label;
+Switch::Switch(const value::Value& control, Label default_label, std::vector<std::pair<long long int, Label>> cases) :
+    control(control), default_label(default_label), cases(std::move(cases)){}
+void Switch::print(ir_writer::Writer& output) const{
+    output << "switch ";
+    print_typed(control, output);
+    output << ", label %" << default_label << " [\n";
+    for(const auto& c : cases){
+        output << "    " << type::ir_type(control.get_type()) << " " << c.first << ", label %" << c.second << '\n';
+    }
+    output << "  ]";
 }
-std::string Unreachable::get_instruction() {
-    return "unreachable";
+void Unreachable::print(ir_writer::Writer& output) const{
+    output << "unreachable";
 }
-std::string Block::get_label(){
+Label Block::get_label() const{
     return label;
 }
+void Block::add_instruction(Instruction instruction){
+    instructions.push_back(std::move(instruction));
+}
+const std::vector<Instruction>& Block::get_instructions() const noexcept{
+    return instructions;
+}
 bool Block::has_terminator() const{
     return t != nullptr;
 }
 void Block::add_terminator(std::unique_ptr<Terminator> term){
     t = std::move(term);
 }
-void Block::print_terminator(std::ostream& output) const{
+const Terminator* Block::get_terminator() const noexcept{
+    return t.get();
+}
+void Block::print(ir_writer::Writer& output) const{
     assert(t && "No terminator to print");
-    output << t->get_instruction() <<std::endl;
+    output << label << ":\n";
+    for(const auto& instruction : instructions){
+        output << "  ";
+        instruction.print(output);
+        output << '\n';
+    }
+    output << "  ";
+    t->print(output);
+    output << '\n';
 }
 
 }//namespace basicblock
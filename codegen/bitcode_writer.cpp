@@ -0,0 +1,1003 @@
+#include "bitcode_writer.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bitcode_writer{
+namespace{
+//Block ids and record codes, as numbered in LLVM's LLVMBitCodes.h
+enum BlockId : unsigned{
+    MODULE_BLOCK = 8, PARAMATTR_BLOCK = 9, PARAMATTR_GROUP_BLOCK = 10, CONSTANTS_BLOCK = 11,
+    FUNCTION_BLOCK = 12, IDENTIFICATION_BLOCK = 13, VALUE_SYMTAB_BLOCK = 14, TYPE_BLOCK = 17
+};
+enum IdentificationCode : unsigned{ IDENTIFICATION_STRING = 1, IDENTIFICATION_EPOCH = 2 };
+enum ModuleCode : unsigned{ MODULE_VERSION = 1, MODULE_TRIPLE = 2, MODULE_GLOBALVAR = 7, MODULE_FUNCTION = 8 };
+enum AttributeCode : unsigned{ PARAMATTR_ENTRY = 2, PARAMATTR_GROUP_ENTRY = 3, ATTR_KIND_NOUNDEF = 68 };
+enum TypeCode : unsigned{
+    TYPE_NUMENTRY = 1, TYPE_VOID = 2, TYPE_FLOAT = 3, TYPE_DOUBLE = 4, TYPE_INTEGER = 7, TYPE_ARRAY = 11,
+    TYPE_STRUCT_ANON = 18, TYPE_STRUCT_NAME = 19, TYPE_STRUCT_NAMED = 20, TYPE_FUNCTION = 21, TYPE_OPAQUE_POINTER = 25
+};
+enum ConstantCode : unsigned{
+    CST_SETTYPE = 1, CST_NULL = 2, CST_INTEGER = 4, CST_FLOAT = 6, CST_AGGREGATE = 7, CST_STRING = 8, CST_CSTRING = 9, CST_DATA = 22
+};
+enum FunctionCode : unsigned{
+    FUNC_DECLAREBLOCKS = 1, INST_BINOP = 2, INST_CAST = 3, INST_RET = 10, INST_BR = 11, INST_SWITCH = 12,
+    INST_UNREACHABLE = 15, INST_ALLOCA = 19, INST_LOAD = 20, INST_EXTRACTVAL = 26, INST_CMP2 = 28, INST_CALL = 34,
+    INST_GEP = 43, INST_STORE = 44
+};
+enum SymbolCode : unsigned{ VST_ENTRY = 1, VST_BBENTRY = 2 };
+//Linkage and flag values used in global records
+constexpr std::uint64_t external_linkage = 0;
+constexpr std::uint64_t private_linkage = 9;
+constexpr std::uint64_t global_unnamed_addr = 1;
+constexpr std::uint64_t global_explicit_type = 2;
+constexpr std::uint64_t alloca_explicit_type = 1 << 6;
+constexpr std::uint64_t call_explicit_type = 1 << 15;
+
+const std::unordered_map<std::string_view, std::uint64_t> binary_ops = {
+    {"add", 0}, {"sub", 1}, {"mul", 2}, {"udiv", 3}, {"sdiv", 4}, {"urem", 5}, {"srem", 6},
+    {"shl", 7}, {"lshr", 8}, {"ashr", 9}, {"and", 10}, {"or", 11}, {"xor", 12},
+    //Floating point operations share the codes of their integer counterparts
+    {"fadd", 0}, {"fsub", 1}, {"fmul", 2}, {"fdiv", 4}, {"frem", 6},
+};
+const std::unordered_map<std::string_view, std::uint64_t> comparisons = {
+    {"fcmp oeq", 1}, {"fcmp ogt", 2}, {"fcmp oge", 3}, {"fcmp olt", 4}, {"fcmp ole", 5}, {"fcmp one", 6},
+    {"fcmp ueq", 9}, {"fcmp une", 14},
+    {"icmp eq", 32}, {"icmp ne", 33}, {"icmp ugt", 34}, {"icmp uge", 35}, {"icmp ult", 36}, {"icmp ule", 37},
+    {"icmp sgt", 38}, {"icmp sge", 39}, {"icmp slt", 40}, {"icmp sle", 41},
+};
+const std::unordered_map<std::string_view, std::uint64_t> casts = {
+    {"trunc", 0}, {"zext", 1}, {"sext", 2}, {"fptoui", 3}, {"fptosi", 4}, {"uitofp", 5}, {"sitofp", 6},
+    {"fptrunc", 7}, {"fpext", 8}, {"ptrtoint", 9}, {"inttoptr", 10}, {"bitcast", 11},
+};
+std::uint64_t lookup(const std::unordered_map<std::string_view, std::uint64_t>& table, const char* opcode){
+    auto it = table.find(opcode);
+    if(it == table.end()){
+        throw std::runtime_error(std::string("Cannot encode opcode ")+opcode);
+    }
+    return it->second;
+}
+
+using Record = std::vector<std::uint64_t>;
+void append(Record& record, std::string_view chars){
+    for(char c : chars){
+        record.push_back(static_cast<unsigned char>(c));
+    }
+}
+//Collects the pieces of a label as it is printed, without the cost of a string stream
+struct LabelSpelling{
+    std::string text;
+    LabelSpelling& operator<<(const char* s){
+        text += s;
+        return *this;
+    }
+    LabelSpelling& operator<<(const std::string& s){
+        text += s;
+        return *this;
+    }
+    LabelSpelling& operator<<(char c){
+        text += c;
+        return *this;
+    }
+    LabelSpelling& operator<<(int i){
+        text += std::to_string(i);
+        return *this;
+    }
+    LabelSpelling& operator<<(long long int i){
+        text += std::to_string(i);
+        return *this;
+    }
+};
+std::string spelling(const basicblock::Label& label){
+    auto output = LabelSpelling();
+    label.print(output);
+    return std::move(output.text);
+}
+type::CType pointed_type(const value::Value& value){
+    assert(type::is_type<type::PointerType>(value.get_type()) && "Globals must be stored as pointers");
+    return type::get<type::PointerType>(value.get_type()).pointed_type();
+}
+//Alignments are written as one more than their log2, with 0 leaving the alignment to the type
+std::uint64_t encoded_alignment(long long align){
+    std::uint64_t encoded = 0;
+    for(; align > 0; align >>= 1){
+        encoded++;
+    }
+    return encoded;
+}
+
+//Bits are packed from the least significant end of 32 bit little-endian words
+//Each block is written to its own stream, which is copied into the enclosing stream when the block ends,
+//so blocks can be built in a different order than the one they are written in
+class Bitstream{
+    std::vector<std::uint32_t> words;
+    std::uint64_t current = 0;
+    unsigned used = 0;
+    //Width of the abbreviation ids, of which only END_BLOCK, ENTER_SUBBLOCK and UNABBREV_RECORD are used
+    unsigned width;
+    void align(){
+        if(used > 0){
+            emit(0, 32 - used);
+        }
+    }
+public:
+    explicit Bitstream(unsigned width) : width(width) {}
+    void emit(std::uint64_t value, unsigned bits){
+        assert(bits <= 32 && value >> bits == 0 && "Value does not fit in field");
+        current |= value << used;
+        used += bits;
+        if(used >= 32){
+            words.push_back(static_cast<std::uint32_t>(current));
+            current >>= 32;
+            used -= 32;
+        }
+    }
+    void emit_vbr(std::uint64_t value, unsigned bits){
+        const auto high = std::uint64_t{1} << (bits - 1);
+        while(value >= high){
+            emit((value & (high - 1)) | high, bits);
+            value >>= bits - 1;
+        }
+        emit(value, bits);
+    }
+    void record(unsigned code, const Record& operands){
+        emit(3, width);
+        emit_vbr(code, 6);
+        emit_vbr(operands.size(), 6);
+        for(auto operand : operands){
+            emit_vbr(operand, 6);
+        }
+    }
+    void block(unsigned id, Bitstream&& inner){
+        inner.emit(0, inner.width);
+        inner.align();
+        emit(1, width);
+        emit_vbr(id, 8);
+        emit_vbr(inner.width, 4);
+        align();
+        words.push_back(static_cast<std::uint32_t>(inner.words.size()));
+        words.insert(words.end(), inner.words.begin(), inner.words.end());
+    }
+    void write(std::ostream& output){
+        align();
+        auto bytes = std::string(words.size() * 4, '\0');
+        for(std::size_t i = 0; i < words.size(); i++){
+            for(int b = 0; b < 4; b++){
+                bytes[i * 4 + b] = static_cast<char>((words[i] >> (8 * b)) & 0xFF);
+            }
+        }
+        output.write(bytes.data(), bytes.size());
+    }
+};
+
+//Type table, with the same lowering as the LLVM backend: tags are named structs, other structs are literal
+//Types are added after the types they refer to, since only named structs may be referred to before they are defined
+class TypeTable{
+public:
+    struct Entry{
+        unsigned code;
+        Record operands;
+        //Element types of an array or struct
+        std::vector<unsigned> elements;
+        //Name of a tag, written in a STRUCT_NAME record before the type
+        std::string name;
+    };
+private:
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, unsigned> ids;
+    std::map<std::string, type::CType> tags;
+    //Lowered types by the address of their IR spelling, which is interned, so that most lookups need no key
+    std::unordered_map<const char*, unsigned> lowered;
+    unsigned add(std::string key, Entry entry){
+        auto id = static_cast<unsigned>(entries.size());
+        entries.push_back(std::move(entry));
+        ids.emplace(std::move(key), id);
+        return id;
+    }
+    static std::string key(char kind, const Record& operands){
+        auto s = std::string(1, kind);
+        for(auto operand : operands){
+            s += std::to_string(operand) + ",";
+        }
+        return s;
+    }
+    unsigned get(char kind, unsigned code, Record operands, std::vector<unsigned> elements = {}){
+        auto k = key(kind, operands);
+        if(auto it = ids.find(k); it != ids.end()){
+            return it->second;
+        }
+        return add(std::move(k), Entry{code, std::move(operands), std::move(elements), ""});
+    }
+    unsigned structure(const std::vector<unsigned>& members){
+        auto operands = Record{0};
+        operands.insert(operands.end(), members.begin(), members.end());
+        return get('s', TYPE_STRUCT_ANON, std::move(operands), members);
+    }
+    //Member types of a struct or union as laid out, which for a union is just its largest member
+    std::vector<unsigned> members(const type::CType& t){
+        auto result = std::vector<unsigned>{};
+        if(type::is_type<type::StructType>(t)){
+            for(const auto& member : type::get<type::StructType>(t).members){
+                result.push_back(lower(member));
+            }
+        }else if(type::is_type<type::UnionType>(t)){
+            const auto& u = type::get<type::UnionType>(t);
+            if(!u.members.empty()){
+                assert(u.largest_computed && "Cannot lower a union without computing its largest member");
+                result.push_back(lower(u.largest));
+            }
+        }
+        return result;
+    }
+    unsigned tag(const std::string& name){
+        auto k = "%" + name;
+        if(auto it = ids.find(k); it != ids.end()){
+            return it->second;
+        }
+        auto it = tags.find(name);
+        if(it == tags.end()){
+            throw std::runtime_error("Cannot lower undeclared tag "+name);
+        }
+        auto body = members(it->second);
+        auto operands = Record{0};
+        operands.insert(operands.end(), body.begin(), body.end());
+        return add(std::move(k), Entry{TYPE_STRUCT_NAMED, std::move(operands), std::move(body), name});
+    }
+public:
+    void set_tags(std::map<std::string, type::CType> table){
+        tags = std::move(table);
+    }
+    const Entry& operator[](unsigned id) const{
+        return entries.at(id);
+    }
+    unsigned integer(unsigned width){
+        return get('i', TYPE_INTEGER, {width});
+    }
+    unsigned pointer(){
+        return get('p', TYPE_OPAQUE_POINTER, {0});
+    }
+    unsigned function(unsigned return_type, const std::vector<unsigned>& params, bool variadic){
+        for(auto param : params){
+            if(entries[param].code == TYPE_VOID){
+                throw std::runtime_error("Cannot have void parameter type");
+            }
+        }
+        auto operands = Record{variadic, return_type};
+        operands.insert(operands.end(), params.begin(), params.end());
+        return get('F', TYPE_FUNCTION, std::move(operands));
+    }
+    //Types with the same IR spelling lower to the same type
+    unsigned lower(const type::CType& t){
+        auto spelling = type::ir_type(t);
+        if(auto it = lowered.find(spelling.data()); it != lowered.end()){
+            return it->second;
+        }
+        auto id = lower_uncached(t);
+        lowered.emplace(spelling.data(), id);
+        return id;
+    }
+    unsigned lower_uncached(const type::CType& t){
+        switch(t.kind()){
+            case type::TypeKind::Void:
+                return get('v', TYPE_VOID, {});
+            case type::TypeKind::Int:
+            case type::TypeKind::Float:
+            {
+                auto spelling = type::ir_type(t);
+                if(spelling == "float"){
+                    return get('f', TYPE_FLOAT, {});
+                }else if(spelling == "double"){
+                    return get('d', TYPE_DOUBLE, {});
+                }
+                //i1, i8, i16, i32 or i64
+                return integer(std::stoi(std::string(spelling.substr(1))));
+            }
+            case type::TypeKind::Pointer:
+                return pointer();
+            case type::TypeKind::Array:
+            {
+                const auto& array = type::get<type::ArrayType>(t);
+                auto element = lower(array.pointed_type());
+                return get('a', TYPE_ARRAY, {array.is_complete() ? static_cast<std::uint64_t>(array.size()) : 0, element}, {element});
+            }
+            case type::TypeKind::Function:
+            {
+                const auto& f = type::get<type::FuncType>(t);
+                auto params = std::vector<unsigned>{};
+                if(f.has_prototype()){
+                    for(const auto& param : f.param_types()){
+                        params.push_back(lower(param));
+                    }
+                }
+                return function(lower(f.return_type()), params, !f.has_prototype() || f.is_variadic());
+            }
+            case type::TypeKind::Struct:
+            {
+                const auto& s = type::get<type::StructType>(t);
+                if(s.members.empty() && !s.complete){
+                    return tag(s.tag);
+                }
+                return structure(members(t));
+            }
+            case type::TypeKind::Union:
+            {
+                const auto& u = type::get<type::UnionType>(t);
+                if(u.members.empty() && !u.complete){
+                    return tag(u.tag);
+                }
+                return structure(members(t));
+            }
+            case type::TypeKind::Typedef:
+                break;
+        }
+        throw std::runtime_error("Cannot lower type "+type::to_string(t));
+    }
+    Bitstream write() const{
+        auto output = Bitstream(4);
+        output.record(TYPE_NUMENTRY, {entries.size()});
+        for(const auto& entry : entries){
+            if(!entry.name.empty()){
+                auto name = Record{};
+                append(name, entry.name);
+                output.record(TYPE_STRUCT_NAME, name);
+            }
+            output.record(entry.code, entry.operands);
+        }
+        return output;
+    }
+};
+
+std::uint64_t sign_rotated(std::int64_t value){
+    auto bits = static_cast<std::uint64_t>(value);
+    return value >= 0 ? bits << 1 : ((0 - bits) << 1) | 1;
+}
+//Truncated to the given width and sign extended back
+std::int64_t truncated(std::uint64_t bits, unsigned width){
+    if(width < 64){
+        bits <<= 64 - width;
+        return static_cast<std::int64_t>(bits) >> (64 - width);
+    }
+    return static_cast<std::int64_t>(bits);
+}
+//Value of an integer literal, truncated and sign extended from the given width
+std::int64_t integer_value(const std::string& text, unsigned width){
+    auto c = ir::parse_constant(text);
+    if(c.kind != ir::Constant::Kind::Integer){
+        throw std::runtime_error("Cannot encode integer constant "+text);
+    }
+    return truncated(static_cast<std::uint64_t>(c.integer), width);
+}
+//Bits of a floating point number, which is held as a double even for floats
+std::uint64_t float_bits(double d, bool is_float){
+    static_assert(sizeof(d) == sizeof(std::uint64_t));
+    if(is_float){
+        float f = static_cast<float>(d);
+        std::uint32_t bits = 0;
+        static_assert(sizeof(f) == sizeof(bits));
+        std::memcpy(&bits, &f, sizeof(f));
+        return bits;
+    }
+    auto bits = std::uint64_t{0};
+    std::memcpy(&bits, &d, sizeof(d));
+    return bits;
+}
+
+//Constants of the module or of one function, numbered after the values which come before them
+//Aggregates refer to their elements by absolute value id, so elements are added first
+class ConstantTable{
+    struct Constant{
+        unsigned type;
+        unsigned code;
+        Record operands;
+    };
+    const TypeTable* types;
+    unsigned first_id;
+    std::vector<Constant> constants;
+    //Literals by type and text, and numbers by type and bits, so each is only added once
+    std::map<std::pair<unsigned, std::string>, unsigned> literals;
+    std::map<std::tuple<unsigned, ir::Constant::Kind, std::uint64_t>, unsigned> scalars;
+    unsigned add(unsigned type, unsigned code, Record operands){
+        constants.push_back(Constant{type, code, std::move(operands)});
+        return first_id + static_cast<unsigned>(constants.size()) - 1;
+    }
+    //Bits of a number as it is stored in a record of the given type
+    std::uint64_t scalar_bits(const ir::Constant& c, const TypeTable::Entry& entry) const{
+        bool is_float = entry.code == TYPE_FLOAT || entry.code == TYPE_DOUBLE;
+        if(entry.code == TYPE_INTEGER && c.kind == ir::Constant::Kind::Integer){
+            return static_cast<std::uint64_t>(truncated(static_cast<std::uint64_t>(c.integer), entry.operands.at(0)));
+        }
+        if(is_float && c.kind == ir::Constant::Kind::Float){
+            return float_bits(c.floating, entry.code == TYPE_FLOAT);
+        }
+        if(is_float && c.kind == ir::Constant::Kind::Integer){
+            return float_bits(static_cast<double>(c.integer), entry.code == TYPE_FLOAT);
+        }
+        throw std::runtime_error("Cannot encode constant of type code "+std::to_string(entry.code));
+    }
+    unsigned scalar(const ir::Constant& c, unsigned type){
+        const auto& entry = (*types)[type];
+        auto bits = c.kind == ir::Constant::Kind::Zero ? 0 : scalar_bits(c, entry);
+        auto key = std::make_tuple(type, c.kind, bits);
+        if(auto it = scalars.find(key); it != scalars.end()){
+            return it->second;
+        }
+        auto id = 0u;
+        if(c.kind == ir::Constant::Kind::Zero){
+            id = add(type, CST_NULL, {});
+        }else if(entry.code == TYPE_INTEGER){
+            id = add(type, CST_INTEGER, {sign_rotated(static_cast<std::int64_t>(bits))});
+        }else{
+            id = add(type, CST_FLOAT, {bits});
+        }
+        scalars.emplace(key, id);
+        return id;
+    }
+    //Elements of an array of integers or floating point numbers, which are stored packed in one record
+    //rather than as a constant each
+    std::optional<Record> scalar_data(const ir::Constant& c, unsigned element_type) const{
+        const auto& element = (*types)[element_type];
+        bool is_integer = element.code == TYPE_INTEGER && (element.operands.at(0) == 8 || element.operands.at(0) == 16
+            || element.operands.at(0) == 32 || element.operands.at(0) == 64);
+        if(!is_integer && element.code != TYPE_FLOAT && element.code != TYPE_DOUBLE){
+            return std::nullopt;
+        }
+        auto data = Record{};
+        data.reserve(c.elements.size());
+        for(const auto& e : c.elements){
+            if(e.kind == ir::Constant::Kind::Zero){
+                data.push_back(0);
+            }else if(e.kind != ir::Constant::Kind::Integer && e.kind != ir::Constant::Kind::Float){
+                return std::nullopt;
+            }else if(is_integer){
+                //Stored zero extended, which keeps negative numbers short
+                auto width = element.operands.at(0);
+                auto bits = scalar_bits(e, element);
+                data.push_back(width == 64 ? bits : bits & ((std::uint64_t{1} << width) - 1));
+            }else{
+                data.push_back(scalar_bits(e, element));
+            }
+        }
+        return data;
+    }
+    unsigned constant(const ir::Constant& c, unsigned type){
+        const auto& entry = (*types)[type];
+        switch(c.kind){
+            case ir::Constant::Kind::Aggregate:
+            {
+                bool is_array = entry.code == TYPE_ARRAY;
+                bool is_struct = entry.code == TYPE_STRUCT_ANON || entry.code == TYPE_STRUCT_NAMED;
+                auto count = is_array ? entry.operands.at(0) : entry.elements.size();
+                if(!(is_array || is_struct) || c.elements.size() != count){
+                    throw std::runtime_error("Aggregate constant does not match its type");
+                }
+                if(is_array && !c.elements.empty()){
+                    if(auto data = scalar_data(c, entry.elements.at(0))){
+                        return add(type, CST_DATA, std::move(*data));
+                    }
+                }
+                auto elements = Record{};
+                for(std::size_t i = 0; i < c.elements.size(); i++){
+                    elements.push_back(constant(c.elements[i], entry.elements.at(is_array ? 0 : i)));
+                }
+                return add(type, CST_AGGREGATE, std::move(elements));
+            }
+            case ir::Constant::Kind::String:
+            {
+                if(entry.code != TYPE_ARRAY || (*types)[entry.elements.at(0)].code != TYPE_INTEGER
+                    || (*types)[entry.elements.at(0)].operands.at(0) != 8 || entry.operands.at(0) != c.text.size()){
+                    throw std::runtime_error("String constant does not match its type");
+                }
+                if(c.text.empty()){
+                    return add(type, CST_NULL, {});
+                }
+                //A C string leaves off its terminating null
+                auto bytes = Record{};
+                bool is_c_string = c.text.back() == '\0' && c.text.find('\0') == c.text.size() - 1;
+                append(bytes, is_c_string ? std::string_view(c.text).substr(0, c.text.size() - 1) : c.text);
+                return add(type, is_c_string ? CST_CSTRING : CST_STRING, std::move(bytes));
+            }
+            case ir::Constant::Kind::Zero:
+            case ir::Constant::Kind::Integer:
+            case ir::Constant::Kind::Float:
+                break;
+        }
+        return scalar(c, type);
+    }
+public:
+    ConstantTable(const TypeTable& types, unsigned first_id) : types(&types), first_id(first_id) {}
+    unsigned size() const{
+        return static_cast<unsigned>(constants.size());
+    }
+    unsigned initializer(const ir::Constant& c, unsigned type){
+        return constant(c, type);
+    }
+    unsigned literal(const std::string& text, unsigned type){
+        auto key = std::make_pair(type, text);
+        if(auto it = literals.find(key); it != literals.end()){
+            return it->second;
+        }
+        auto id = constant(ir::parse_constant(text), type);
+        literals.emplace(std::move(key), id);
+        return id;
+    }
+    unsigned find(const std::string& text, unsigned type) const{
+        auto it = literals.find({type, text});
+        assert(it != literals.end() && "Literal was not added to the constants");
+        return it->second;
+    }
+    void write(Bitstream& output) const{
+        if(constants.empty()){
+            return;
+        }
+        auto block = Bitstream(4);
+        const Constant* last = nullptr;
+        for(const auto& c : constants){
+            if(!last || last->type != c.type){
+                block.record(CST_SETTYPE, {c.type});
+            }
+            block.record(c.code, c.operands);
+            last = &c;
+        }
+        output.block(CONSTANTS_BLOCK, std::move(block));
+    }
+};
+
+//Encodes one module, keeping track of the value ids of the globals and of the registers and blocks of the current function
+class ModuleWriter{
+    TypeTable types;
+    std::unordered_map<std::string, unsigned> globals;
+    //Names of the globals, in value id order
+    std::vector<const std::string*> global_names;
+    Record global_records;
+    std::vector<Record> variables;
+    std::vector<Record> functions;
+    //Values before the function level values, which are the globals and the module constants
+    unsigned module_values = 0;
+    //Most parameters or arguments of any function or call, each of which is noundef
+    unsigned max_params = 0;
+    std::vector<Bitstream> bodies;
+
+    //Registers of the function being encoded, with temporaries by number and locals by name and number
+    static constexpr unsigned no_value = ~0u;
+    std::vector<unsigned> temps;
+    std::map<std::pair<const std::string*, std::uint32_t>, unsigned> locals;
+    std::unordered_map<std::string, unsigned> blocks;
+    std::vector<std::pair<unsigned, std::string>> local_names;
+    ConstantTable constants = ConstantTable(types, 0);
+    //Id of the next instruction, which operands are encoded relative to
+    unsigned next_id = 0;
+
+    unsigned param_attributes(std::size_t params){
+        max_params = std::max(max_params, static_cast<unsigned>(params));
+        return static_cast<unsigned>(params);
+    }
+    void declare(const value::Value& v){
+        auto id = static_cast<unsigned>(global_names.size());
+        if(!globals.emplace(*v.get_name(), id).second){
+            throw std::runtime_error("Global "+*v.get_name()+" is defined twice");
+        }
+        global_names.push_back(v.get_name());
+    }
+    unsigned id(const value::Value& v){
+        switch(v.get_kind()){
+            case value::Value::Kind::Temp:
+                if(v.get_number() < temps.size() && temps[v.get_number()] != no_value){
+                    return temps[v.get_number()];
+                }
+                break;
+            case value::Value::Kind::Local:
+                if(auto it = locals.find({v.get_name(), v.get_number()}); it != locals.end()){
+                    return it->second;
+                }
+                break;
+            case value::Value::Kind::Global:
+                if(auto it = globals.find(*v.get_name()); it != globals.end()){
+                    return it->second;
+                }
+                break;
+            case value::Value::Kind::Literal:
+                return constants.find(*v.get_name(), types.lower(v.get_type()));
+        }
+        throw std::runtime_error("Use of undefined value "+v.get_value().str());
+    }
+    void define(const value::Value& v, unsigned id){
+        if(v.get_kind() == value::Value::Kind::Temp){
+            if(v.get_number() >= temps.size()){
+                temps.resize(v.get_number() + 1, no_value);
+            }
+            temps[v.get_number()] = id;
+        }else{
+            assert(v.get_kind() == value::Value::Kind::Local && "Only registers can be defined in a function");
+            locals[{v.get_name(), v.get_number()}] = id;
+            local_names.emplace_back(id, *v.get_name() + "." + std::to_string(v.get_number()));
+        }
+    }
+    unsigned block(const basicblock::Label& label) const{
+        auto it = blocks.find(spelling(label));
+        if(it == blocks.end()){
+            throw std::runtime_error("Branch to missing block "+spelling(label));
+        }
+        return it->second;
+    }
+    //Operands are encoded relative to the instruction, and a value defined later also needs its type
+    void push_value(Record& record, const value::Value& v){
+        record.push_back(static_cast<std::uint32_t>(next_id - id(v)));
+    }
+    void push_value_and_type(Record& record, const value::Value& v){
+        auto value_id = id(v);
+        record.push_back(static_cast<std::uint32_t>(next_id - value_id));
+        if(value_id >= next_id){
+            record.push_back(types.lower(v.get_type()));
+        }
+    }
+    static bool has_value(const basicblock::Instruction& instruction){
+        using Kind = basicblock::Instruction::Kind;
+        return instruction.get_kind() != Kind::Store
+            && !(instruction.get_kind() == Kind::Call && type::is_type<type::VoidType>(instruction.get_type()));
+    }
+
+    //Adds the constants an instruction or terminator refers to, which are written before the function's instructions
+    void add_constants(const basicblock::Instruction& instruction){
+        const auto& operands = instruction.get_operands();
+        if(instruction.get_kind() == basicblock::Instruction::Kind::Alloca){
+            constants.literal("1", types.integer(32));
+        }
+        //The index of an extractvalue is part of the instruction rather than an operand
+        auto count = instruction.get_kind() == basicblock::Instruction::Kind::ExtractValue ? 1 : operands.size();
+        for(std::size_t i = 0; i < count; i++){
+            if(operands[i].get_kind() == value::Value::Kind::Literal){
+                constants.literal(*operands[i].get_name(), types.lower(operands[i].get_type()));
+            }
+        }
+    }
+    void add_constants(const basicblock::Terminator& terminator){
+        auto add = [this](const value::Value& v){
+            if(v.get_kind() == value::Value::Kind::Literal){
+                constants.literal(*v.get_name(), types.lower(v.get_type()));
+            }
+        };
+        if(auto ret = dynamic_cast<const basicblock::RET*>(&terminator)){
+            if(ret->get_value()){
+                add(*ret->get_value());
+            }
+        }else if(auto ret = dynamic_cast<const basicblock::DefaultRet*>(&terminator)){
+            if(!type::is_type<type::VoidType>(ret->get_type()) && !type::is_type<type::ArrayType>(ret->get_type())){
+                constants.literal("zeroinitializer", types.lower(ret->get_type()));
+            }
+        }else if(auto br = dynamic_cast<const basicblock::Cond_BR*>(&terminator)){
+            add(br->get_condition());
+        }else if(auto s = dynamic_cast<const basicblock::Switch*>(&terminator)){
+            add(s->get_control());
+            auto t = types.lower(s->get_control().get_type());
+            for(const auto& c : s->get_cases()){
+                constants.literal(std::to_string(c.first), t);
+            }
+        }
+    }
+
+    //Indices after the first step into arrays or structs, as LLVM checks when it reads textual IR
+    void check_indices(unsigned source, const std::vector<value::Value>& operands){
+        auto t = source;
+        for(std::size_t i = 2; i < operands.size(); i++){
+            const auto& entry = types[t];
+            if(entry.code == TYPE_ARRAY){
+                t = entry.elements.at(0);
+            }else if((entry.code == TYPE_STRUCT_ANON || entry.code == TYPE_STRUCT_NAMED)
+                && operands[i].get_kind() == value::Value::Kind::Literal){
+                auto index = integer_value(*operands[i].get_name(), 64);
+                if(index < 0 || static_cast<std::size_t>(index) >= entry.elements.size()){
+                    throw std::runtime_error("Invalid getelementptr indices");
+                }
+                t = entry.elements[index];
+            }else{
+                throw std::runtime_error("Invalid getelementptr indices");
+            }
+        }
+    }
+    void write(const basicblock::Instruction& instruction, Bitstream& output){
+        using Kind = basicblock::Instruction::Kind;
+        const auto& operands = instruction.get_operands();
+        auto record = Record{};
+        unsigned code = 0;
+        switch(instruction.get_kind()){
+            case Kind::Alloca:
+            {
+                auto size_type = types.integer(32);
+                code = INST_ALLOCA;
+                record = {types.lower(instruction.get_type()), size_type, constants.find("1", size_type),
+                    alloca_explicit_type};
+                break;
+            }
+            case Kind::Load:
+                code = INST_LOAD;
+                push_value_and_type(record, operands.at(0));
+                record.insert(record.end(), {types.lower(instruction.get_type()), 0, 0});
+                break;
+            case Kind::Store:
+                code = INST_STORE;
+                push_value_and_type(record, operands.at(1));
+                push_value_and_type(record, operands.at(0));
+                record.insert(record.end(), {0, 0});
+                break;
+            case Kind::GetElementPtr:
+                check_indices(types.lower(instruction.get_type()), operands);
+                code = INST_GEP;
+                record = {std::strcmp(instruction.get_opcode(), "getelementptr inbounds") == 0,
+                    types.lower(instruction.get_type())};
+                for(const auto& operand : operands){
+                    push_value_and_type(record, operand);
+                }
+                break;
+            case Kind::ExtractValue:
+                code = INST_EXTRACTVAL;
+                push_value_and_type(record, operands.at(0));
+                record.push_back(static_cast<std::uint64_t>(integer_value(*operands.at(1).get_name(), 64)));
+                break;
+            case Kind::Call:
+            {
+                //As in the textual IR, the function type is given by the arguments
+                auto arg_types = std::vector<unsigned>{};
+                for(std::size_t i = 1; i < operands.size(); i++){
+                    arg_types.push_back(types.lower(operands[i].get_type()));
+                }
+                code = INST_CALL;
+                record = {param_attributes(arg_types.size()), call_explicit_type,
+                    types.function(types.lower(instruction.get_type()), arg_types, false)};
+                push_value_and_type(record, operands.at(0));
+                for(std::size_t i = 1; i < operands.size(); i++){
+                    push_value(record, operands[i]);
+                }
+                break;
+            }
+            case Kind::Cast:
+                code = INST_CAST;
+                push_value_and_type(record, operands.at(0));
+                record.push_back(types.lower(instruction.get_result()->get_type()));
+                record.push_back(lookup(casts, instruction.get_opcode()));
+                break;
+            case Kind::Binary:
+            {
+                auto opcode = instruction.get_opcode();
+                bool compare = std::strncmp(opcode, "icmp ", 5) == 0 || std::strncmp(opcode, "fcmp ", 5) == 0;
+                code = compare ? INST_CMP2 : INST_BINOP;
+                push_value_and_type(record, operands.at(0));
+                push_value(record, operands.at(1));
+                record.push_back(lookup(compare ? comparisons : binary_ops, opcode));
+                break;
+            }
+        }
+        output.record(code, record);
+        if(has_value(instruction)){
+            next_id++;
+        }
+    }
+    void write(const basicblock::Terminator& terminator, Bitstream& output){
+        auto record = Record{};
+        if(auto ret = dynamic_cast<const basicblock::RET*>(&terminator)){
+            if(ret->get_value()){
+                push_value_and_type(record, *ret->get_value());
+            }
+            output.record(INST_RET, record);
+        }else if(auto ret = dynamic_cast<const basicblock::DefaultRet*>(&terminator)){
+            if(type::is_type<type::ArrayType>(ret->get_type())){
+                throw std::runtime_error("Cannot have array type as return value");
+            }
+            if(!type::is_type<type::VoidType>(ret->get_type())){
+                record.push_back(next_id - constants.find("zeroinitializer", types.lower(ret->get_type())));
+            }
+            output.record(INST_RET, record);
+        }else if(auto br = dynamic_cast<const basicblock::Cond_BR*>(&terminator)){
+            record = {block(br->get_true_label()), block(br->get_false_label())};
+            push_value(record, br->get_condition());
+            output.record(INST_BR, record);
+        }else if(auto br = dynamic_cast<const basicblock::UCond_BR*>(&terminator)){
+            output.record(INST_BR, {block(br->get_label())});
+        }else if(auto s = dynamic_cast<const basicblock::Switch*>(&terminator)){
+            auto t = types.lower(s->get_control().get_type());
+            record = {t};
+            push_value(record, s->get_control());
+            record.push_back(block(s->get_default_label()));
+            //Case values are given by absolute id
+            for(const auto& [case_value, label] : s->get_cases()){
+                record.push_back(constants.find(std::to_string(case_value), t));
+                record.push_back(block(label));
+            }
+            output.record(INST_SWITCH, record);
+        }else{
+            assert(dynamic_cast<const basicblock::Unreachable*>(&terminator) && "Unknown terminator");
+            output.record(INST_UNREACHABLE, {});
+        }
+    }
+
+    //Definitions are dso_local, declarations are not
+    void declare_function(const value::Value& v, unsigned function_type, bool is_declaration, std::size_t params){
+        declare(v);
+        functions.push_back({function_type, 0, is_declaration, external_linkage, param_attributes(params),
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, !is_declaration});
+    }
+    void declare(const ir::FunctionDeclaration& declaration){
+        const auto& t = type::get<type::FuncType>(pointed_type(declaration.value));
+        declare_function(declaration.value, types.lower(t), true, t.has_prototype() ? t.param_types().size() : 0);
+    }
+    void declare(const ir::Function& f){
+        auto params = std::vector<unsigned>{};
+        for(const auto& param : f.params){
+            params.push_back(types.lower(param.get_type()));
+        }
+        declare_function(f.value, types.function(types.lower(f.return_type), params, false), false, params.size());
+    }
+    void define(const ir::GlobalVariable& global){
+        auto t = types.lower(global.storage_type.value_or(pointed_type(global.value)));
+        auto initializer = constants.initializer(global.initializer, t);
+        variables.push_back({t, global_explicit_type, initializer + 1, external_linkage,
+            encoded_alignment(global.align), 0, 0, 0, 0, 0, 0, 0, 0, 1});
+    }
+    void define(const ir::StringConstant& string){
+        auto t = types.lower(pointed_type(string.value));
+        auto initializer = constants.initializer(ir::Constant::of_string(string.literal), t);
+        variables.push_back({t, global_explicit_type | 1, initializer + 1, private_linkage,
+            0, 0, 0, 0, global_unnamed_addr, 0, 0, 0, 0, 1});
+    }
+    void define(const ir::Function& f){
+        temps.clear();
+        locals.clear();
+        blocks.clear();
+        local_names.clear();
+        next_id = module_values;
+        for(const auto& param : f.params){
+            define(param, next_id++);
+        }
+        constants = ConstantTable(types, next_id);
+        for(const auto& b : f.blocks){
+            assert(b->has_terminator() && "Block without a terminator");
+            for(const auto& instruction : b->get_instructions()){
+                add_constants(instruction);
+            }
+            add_constants(*b->get_terminator());
+        }
+        //Results are numbered up front, since a block may use a value defined in a block written after it
+        auto result_id = next_id + constants.size();
+        for(const auto& b : f.blocks){
+            blocks.emplace(spelling(b->get_label()), static_cast<unsigned>(blocks.size()));
+            for(const auto& instruction : b->get_instructions()){
+                if(has_value(instruction)){
+                    if(instruction.get_result()){
+                        define(*instruction.get_result(), result_id);
+                    }
+                    result_id++;
+                }
+            }
+        }
+        next_id += constants.size();
+        auto output = Bitstream(4);
+        output.record(FUNC_DECLAREBLOCKS, {f.blocks.size()});
+        constants.write(output);
+        for(const auto& b : f.blocks){
+            for(const auto& instruction : b->get_instructions()){
+                write(instruction, output);
+            }
+            write(*b->get_terminator(), output);
+        }
+        auto symbols = Bitstream(4);
+        for(const auto& [local, name] : local_names){
+            auto record = Record{local};
+            append(record, name);
+            symbols.record(VST_ENTRY, record);
+        }
+        for(const auto& b : f.blocks){
+            auto label = spelling(b->get_label());
+            auto record = Record{blocks.at(label)};
+            append(record, label);
+            symbols.record(VST_BBENTRY, record);
+        }
+        output.block(VALUE_SYMTAB_BLOCK, std::move(symbols));
+        bodies.push_back(std::move(output));
+    }
+public:
+    void write(const ir::Module& source, std::ostream& stream){
+        if(source.types){
+            types.set_tags(source.types->tag_table());
+        }
+        //Value ids are given to the variables, then the functions, then the module constants
+        for(const auto& global : source.globals){
+            if(auto g = std::get_if<ir::GlobalVariable>(&global)){
+                declare(g->value);
+            }else if(auto s = std::get_if<ir::StringConstant>(&global)){
+                declare(s->value);
+            }
+        }
+        for(const auto& global : source.globals){
+            if(auto d = std::get_if<ir::FunctionDeclaration>(&global)){
+                declare(*d);
+            }else if(auto f = std::get_if<ir::Function>(&global)){
+                declare(*f);
+            }
+        }
+        auto module_constants = ConstantTable(types, static_cast<unsigned>(global_names.size()));
+        std::swap(constants, module_constants);
+        for(const auto& global : source.globals){
+            if(auto g = std::get_if<ir::GlobalVariable>(&global)){
+                define(*g);
+            }else if(auto s = std::get_if<ir::StringConstant>(&global)){
+                define(*s);
+            }
+        }
+        std::swap(constants, module_constants);
+        module_values = static_cast<unsigned>(global_names.size()) + module_constants.size();
+        for(const auto& global : source.globals){
+            if(auto f = std::get_if<ir::Function>(&global)){
+                define(*f);
+            }
+        }
+
+        auto output = Bitstream(2);
+        for(unsigned magic : {'B', 'C'}){
+            output.emit(magic, 8);
+        }
+        for(unsigned magic : {0x0, 0xC, 0xE, 0xD}){
+            output.emit(magic, 4);
+        }
+        auto identification = Bitstream(5);
+        auto producer = Record{};
+        append(producer, "StepC");
+        identification.record(IDENTIFICATION_STRING, producer);
+        identification.record(IDENTIFICATION_EPOCH, {0});
+        output.block(IDENTIFICATION_BLOCK, std::move(identification));
+
+        auto module = Bitstream(3);
+        //Version 1 uses relative operand ids and takes names from the value symbol tables
+        module.record(MODULE_VERSION, {1});
+        module.block(TYPE_BLOCK, types.write());
+        if(max_params > 0){
+            //Attribute list n marks the first n parameters as noundef
+            auto groups = Bitstream(3);
+            auto lists = Bitstream(3);
+            auto list = Record{};
+            for(unsigned i = 1; i <= max_params; i++){
+                groups.record(PARAMATTR_GROUP_ENTRY, {i, i, 0, ATTR_KIND_NOUNDEF});
+                list.push_back(i);
+                lists.record(PARAMATTR_ENTRY, list);
+            }
+            module.block(PARAMATTR_GROUP_BLOCK, std::move(groups));
+            module.block(PARAMATTR_BLOCK, std::move(lists));
+        }
+        auto triple = Record{};
+        append(triple, "x86_64-unknown-linux-gnu");
+        module.record(MODULE_TRIPLE, triple);
+        for(const auto& record : variables){
+            module.record(MODULE_GLOBALVAR, record);
+        }
+        for(const auto& record : functions){
+            module.record(MODULE_FUNCTION, record);
+        }
+        module_constants.write(module);
+        auto symbols = Bitstream(4);
+        for(std::size_t i = 0; i < global_names.size(); i++){
+            auto record = Record{i};
+            append(record, *global_names[i]);
+            symbols.record(VST_ENTRY, record);
+        }
+        module.block(VALUE_SYMTAB_BLOCK, std::move(symbols));
+        //Bodies are in the same order as the functions records which have them
+        for(auto& body : bodies){
+            module.block(FUNCTION_BLOCK, std::move(body));
+        }
+        output.block(MODULE_BLOCK, std::move(module));
+        output.write(stream);
+    }
+};
+} //namespace
+
+void write(const ir::Module& module, std::ostream& output){
+    ModuleWriter().write(module, output);
+}
+} //namespace bitcode_writer
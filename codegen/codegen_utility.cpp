@@ -1,93 +1,42 @@
 #include "codegen/codegen_utility.h"
+#include "conversions.h"
 namespace codegen_utility{
 
 namespace{
-std::string convert_command(type::IType target, type::IType source){
-    if(type::can_represent(target, source)){
-        if(type::is_signed_int(source)){
-            return "sext";
-        }else{
-            return "zext";
-        }
-    }else{
-        return "trunc";
-    }
-}
-std::string convert_command(type::IType target, type::FType source){
-    if(type::is_signed_int(target)){
-        //IF IT CAN'T FIT, POTENTIAL SOURCE OF Undefined Behavior!!!!!!!!!
-        return "fptosi";
-    }else{
-        //IF IT CAN'T FIT, POTENTIAL SOURCE OF UB!!!!!!!!!
-        return "fptoui";
-    }
-}
-
-std::string convert_command(type::FType target, type::IType source){
-    if(type::is_signed_int(source)){
-        return "sitofp";
-    }else{
-        return "uitofp";
-    }
-}
-std::string convert_command(type::FType target, type::FType source){
-    if(type::can_represent(target, source)){
-        return "fpext";
-    }else{
-        return "fptrunc";
-    }
+value::Value* make_cast(const char* command, value::Value* val, type::CType target_type, context::Context& c){
+    auto new_tmp = c.new_temp(target_type);
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Cast, command, *new_tmp, target_type, {*val}));
+    return new_tmp;
 }
 value::Value* convert(type::BasicType target_type, value::Value* val, 
-        std::ostream& output, context::Context& c){
+        context::Context& c){
     if(type::is_type<type::PointerType>(val->get_type())){
         if(type::is_type<type::FType>(target_type)){
             assert(false && "Tried to convert pointer to float");
         }
         if(target_type == type::BasicType(type::IType::Bool)){
-            auto first_stage = convert(type::IType::LLong, val, output, c);
-            return convert(type::IType::Bool, first_stage, output, c);
+            auto first_stage = convert(type::IType::LLong, val, c);
+            return convert(type::IType::Bool, first_stage, c);
         }else{
-            auto new_tmp = c.new_temp(target_type);
-            print_whitespace(c.depth(), output);
-            output << new_tmp->get_value() <<" = ptrtoint "<<type::ir_type(val->get_type());
-            output << " "<<val->get_value()<<" to "<<type::ir_type(new_tmp->get_type())<<std::endl;
-            return new_tmp;
+            return make_cast("ptrtoint", val, target_type, c);
         }
     }
     if(!type::is_type<type::BasicType>(val->get_type())){
         assert(false && "Tried to convert non-basic, non-pointer type to basic type");
     }
     auto val_type = type::get<type::BasicType>(val->get_type());
-    if(target_type == type::from_str("_Bool")){
-        std::string command = std::visit(overloaded{
-                [](type::IType){return "icmp ne";},
-                [](type::FType){return "fcmp une";},
-                }, val_type);
-
-        print_whitespace(c.depth(), output);
-        auto new_tmp = c.new_temp(type::IType::Bool);
-        output << new_tmp->get_value() <<" = "<<command<<" "<<type::ir_type(val_type);
-        output << std::visit(overloaded{
-            [](type::IType){return " 0, ";},
-            [](type::FType){return " 0.0, ";},
-            }, val_type) << val->get_value() <<std::endl;
-        return new_tmp;
+    auto command = conversions::conversion_opcode(target_type, val_type);
+    if(target_type == type::BasicType(type::IType::Bool)){
+        auto zero = c.make_literal(default_value(val_type), val_type);
+        return make_command(type::IType::Bool, command, &zero, val, c);
     }
-    if(type::ir_type(target_type) == type::ir_type(val_type)){
-        return std::move(val);
+    if(!command){
+        return val;
     }
-    std::string command = std::visit([](auto t, auto s){
-        return convert_command(t, s);
-    }, target_type, val_type);
-
-    print_whitespace(c.depth(), output);
-    auto new_tmp = c.new_temp(target_type);
-    output << new_tmp->get_value() <<" = " << command <<" " << type::ir_type(val_type) <<" ";
-    output << val->get_value() << " to " << type::ir_type(target_type) << std::endl;
-    return new_tmp;
+    return make_cast(command, val, target_type, c);
 }
 value::Value* convert(type::PointerType target_type, value::Value* val, 
-        std::ostream& output, context::Context& c){
+        context::Context& c){
     if(type::is_type<type::PointerType>(val->get_type())){
         //We don't change the value, but we must alter the type of the pointer appropriately for our own type checking
         //Even if all pointers are opaque in the IR itself
@@ -96,20 +45,12 @@ value::Value* convert(type::PointerType target_type, value::Value* val,
         if(!type::is_type<type::IType>(val->get_type())){
             assert(false && "Tried to convert non-ptr, non-int type to ptr");
         }
-        auto new_tmp = c.new_temp(target_type);
-        output << new_tmp->get_value() <<" = inttoptr "<<type::ir_type(val->get_type());
-        output << " "<<val->get_value()<<" to "<<type::ir_type(new_tmp->get_type())<<std::endl;
-        return new_tmp;
+        return make_cast("inttoptr", val, target_type, c);
     }
 }
 
 } //namespace
 
-void print_whitespace(int depth, std::ostream& output){
-    if(depth > 0){
-        output << "  ";
-    }
-}
 std::string default_value(type::CType type){
     return type::visit(type::make_visitor<std::string>(
                 [](const type::IType& i){return "0";},
@@ -124,7 +65,7 @@ std::string default_value(type::CType type){
                 ), type);
 }
 value::Value* convert(type::CType target_type, value::Value* val, 
-        std::ostream& output, context::Context& c){
+        context::Context& c){
     if(!type::can_cast(val->get_type(),target_type)){
         throw std::runtime_error("Tried to convert "+type::to_string(val->get_type())+" to "+type::to_string(target_type));
     }
@@ -136,9 +77,9 @@ value::Value* convert(type::CType target_type, value::Value* val,
     //A specific derived type (distinguishing between array and pointer types), IType, FType, or VoidType
     //So we would need separate IType and FType options to avoid IType and FType binding to auto
     //And we would need a separate option for array types no matter what (to avoid it binding to auto
-        [&](type::BasicType bt){return convert(bt, val, output, c);},
-        [&](type::ArrayType pt){return convert(type::PointerType(type::CType(pt)), val, output, c);},
-        [&](type::PointerType pt){return convert(pt, val, output, c);},
+        [&](type::BasicType bt){return convert(bt, val, c);},
+        [&](type::ArrayType pt){return convert(type::PointerType(type::CType(pt)), val, c);},
+        [&](type::PointerType pt){return convert(pt, val, c);},
         [](type::VoidType t){throw std::runtime_error("Unable to convert value to given type "+type::to_string(t));},
         [](type::StructType t){throw std::runtime_error("Unable to convert value to given type "+type::to_string(t));},
         [&](type::UnionType t){
@@ -148,20 +89,19 @@ value::Value* convert(type::CType target_type, value::Value* val,
         [](type::FuncType t){throw std::runtime_error("Unable to convert value to given type "+type::to_string(t));}
     ),target_type);
 }
-value::Value* make_command(type::CType t, std::string command, value::Value* left, value::Value* right, 
-    std::ostream& output, context::Context& c){
+value::Value* make_command(type::CType t, const char* command, value::Value* left, value::Value* right, 
+    context::Context& c){
     //Perhaps confusingly, note that the type specified is always the type of the left operand
     auto lt = left->get_type();
     if(type::is_type<type::ArrayType>(lt)){
         lt = type::get<type::ArrayType>(lt).pointed_type();
     }
-    print_whitespace(c.depth(), output);
     auto new_temp = c.new_temp(t);
-    output << new_temp->get_value()<<" = "<<command<<" "<<type::ir_type(lt)<<" " << left->get_value() <<", "<< right->get_value()<<std::endl;
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Binary, command, *new_temp, lt, {*left, *right}));
     return new_temp;
 }
 //Basically returns result = *data_pointer
-value::Value* make_load(value::Value* data_pointer, std::ostream& output, context::Context& c){
+value::Value* make_load(value::Value* data_pointer, context::Context& c){
     assert(type::is_type<type::PointerType>(data_pointer->get_type()) && "Can only load from a pointer");
     auto result_type = type::get<type::PointerType>(data_pointer->get_type()).element_type();
     //Loads the pointed type, unless it's an array in which case we get the element instead
@@ -170,23 +110,50 @@ value::Value* make_load(value::Value* data_pointer, std::ostream& output, contex
         return data_pointer;
     }
     auto result = c.new_temp(result_type);
-    print_whitespace(c.depth(), output);
-    output << result->get_value()<<" = load "<<type::ir_type(result->get_type());
-    output << ", " <<type::ir_type(data_pointer->get_type())<<" "<<data_pointer->get_value()<<std::endl;
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Load, nullptr, *result, result_type, {*data_pointer}));
     return result;
 }
-value::Value* make_tmp_alloca(type::CType t, std::ostream& output, context::Context& c){
+value::Value* make_tmp_alloca(type::CType t, context::Context& c){
     auto new_tmp = c.new_temp(type::PointerType(t));
-    print_whitespace(c.depth(), output);
-    output << new_tmp->get_value() <<" = alloca "<<type::ir_type(t) <<std::endl;
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Alloca, nullptr, *new_tmp, t, {}));
     return new_tmp;
 }
 //Basically performs *mem = data_pointer
-void make_store(value::Value* val, value::Value* mem, std::ostream& output, context::Context& c){
+void make_store(value::Value* val, value::Value* mem, context::Context& c){
     assert(type::is_type<type::PointerType>(mem->get_type()) && "Can only store to a pointer");
-    print_whitespace(c.depth(), output);
-    output << "store "<<type::ir_type(val->get_type())<<" "<<val->get_value();
-    output<<", "<<type::ir_type(mem->get_type())<<" "<<mem->get_value()<<std::endl;
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Store, nullptr, std::nullopt, 
+        val->get_type(), {*val, *mem}));
+}
+value::Value* make_element_ptr(type::CType result_type, const char* command, type::CType source_type, value::Value* base,
+    const std::vector<value::Value>& indices, context::Context& c){
+    auto operands = std::vector<value::Value>{*base};
+    operands.insert(operands.end(), indices.begin(), indices.end());
+    auto new_tmp = c.new_temp(result_type);
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::GetElementPtr, command, *new_tmp, 
+        source_type, std::move(operands)));
+    return new_tmp;
+}
+value::Value* make_extract_value(type::CType result_type, value::Value* aggregate, int index, context::Context& c){
+    auto new_tmp = c.new_temp(result_type);
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::ExtractValue, nullptr, *new_tmp, 
+        aggregate->get_type(), {*aggregate, c.make_literal(std::to_string(index), type::IType::Int)}));
+    return new_tmp;
+}
+value::Value* make_call(type::CType return_type, value::Value* function, const std::vector<value::Value*>& args, 
+    context::Context& c){
+    auto operands = std::vector<value::Value>{*function};
+    for(const auto arg : args){
+        operands.push_back(*arg);
+    }
+    value::Value* return_val = nullptr;
+    auto result = std::optional<value::Value>();
+    if(return_type != type::CType(type::VoidType())){
+        return_val = c.new_temp(return_type);
+        result = *return_val;
+    }
+    c.add_instruction(basicblock::Instruction(basicblock::Instruction::Kind::Call, nullptr, result, 
+        return_type, std::move(operands)));
+    return return_val;
 }
 
 
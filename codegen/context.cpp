@@ -1,15 +1,21 @@
 #include "ast.h"
 #include "context.h"
 #include "type.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <thread>
 #include <vector>
 namespace context{
-void Context::enter_block(std::string block_label, std::ostream& output){
+ModuleContext::~ModuleContext() = default;
+void Context::enter_block(basicblock::Label block_label){
     assert(this->current_block == nullptr && "Starting new block without ending current basic block");
-    output << block_label<<":"<<std::endl;
-    current_block = std::make_unique<basicblock::Block>(block_label);
+    auto& blocks = current_function->function.blocks;
+    blocks.push_back(std::make_unique<basicblock::Block>(block_label));
+    current_block = blocks.back().get();
 }
-void Context::exit_block(std::ostream& output, std::unique_ptr<basicblock::Terminator> t){
+void Context::exit_block(std::unique_ptr<basicblock::Terminator> t){
     if(!current_block){
         assert(false && "Tried to exit block when not inside block");
     }
@@ -17,16 +23,37 @@ void Context::exit_block(std::ostream& output, std::unique_ptr<basicblock::Termi
         current_block->add_terminator(std::move(t));
     }
     assert(current_block->has_terminator() && "Tried to exit block with no terminator");
-    ast::AST::print_whitespace(this->depth(), output);
-    current_block->print_terminator(output);
     current_block = nullptr;
 }
 
-Context::Context() : global_sym_map(), current_function(nullptr), current_scope(nullptr), current_block(nullptr){
+Context::Context(unsigned int threads) : owned_module(new ModuleContext(threads)), module_context(*owned_module), 
+    parent(nullptr), first_symbol(0), current_function(nullptr), current_scope(nullptr), current_block(nullptr){
+    pending_strings = &module_context.string_batches.emplace_back();
+}
+Context::Context(ModuleContext& module_context, const Context& parent, std::vector<PendingString>& strings) 
+    : module_context(module_context), parent(&parent), pending_strings(&strings), first_symbol(0), 
+    current_function(nullptr), current_scope(nullptr), current_block(nullptr){
+}
+Context::~Context() = default;
+void Context::set_types(const type::TypeContext& types) noexcept{
+    module_context.type_context = &types;
+    module_context.ir_module.types = &types;
+}
+ir::Module& Context::module() noexcept{
+    return module_context.ir_module;
+}
+void Context::add_instruction(basicblock::Instruction instruction){
+    assert(current_block && "Tried to add instruction outside of a block");
+    current_block->add_instruction(std::move(instruction));
+}
+const type::TypeContext& Context::types() const noexcept{
+    assert(module_context.type_context && "Type context used before code generation of a program");
+    return *module_context.type_context;
 }
 value::Value* Context::prev_temp(int i) const{
     assert(current_function && current_scope && "Cannot look up local temp variable outside of function");
-    return current_scope->tmp_map.at(current_scope->tmp_map.size() - i - 1).get();
+    assert(current_function->temps.size() - i > current_scope->temps_mark && "Temp variable from outside the current scope");
+    return current_function->temps.back(i);
 }
 int Context::new_local_name(){
     assert(current_function && current_scope && "Cannot create local variable outside of function");
@@ -34,109 +61,155 @@ int Context::new_local_name(){
 }
 value::Value* Context::new_temp(type::CType t){
     assert(current_function && current_scope && "Cannot have local temp variable outside of function");
-    auto new_tmp_ptr = std::make_unique<value::Value>("%"+std::to_string(current_function->instructions),t);
-    current_scope->tmp_map.push_back(std::move(new_tmp_ptr));
+    auto new_tmp = current_function->temps.make(value::Value::Kind::Temp, current_function->instructions, nullptr, t);
     current_function->instructions++;
-    return prev_temp(0);
+    current_function->stats.values++;
+    update_stats();
+    return new_tmp;
+}
+void Context::update_stats(){
+    auto& f = *current_function;
+    f.stats.peak_values = std::max(f.stats.peak_values, f.locals.size() + f.temps.size());
+    auto bytes = (f.locals.capacity() + f.temps.capacity()) * sizeof(value::Value) + f.live_scopes * sizeof(Scope);
+    f.stats.peak_bytes = std::max(f.stats.peak_bytes, bytes);
+}
+std::size_t Context::temp_mark() const{
+    assert(current_function && current_scope && "Cannot mark temp variables outside of function");
+    return current_function->temps.size();
+}
+void Context::release_temps(std::size_t mark){
+    assert(mark >= current_scope->temps_mark && "Temp variables released from another scope");
+    current_function->temps.release(mark);
+}
+const std::vector<Context::FunctionStats>& Context::stats() const noexcept{
+    return module_context.function_stats;
+}
+const std::string* Context::intern_name(const std::string& name){
+    return &*names.insert(name).first;
 }
 value::Value* Context::add_literal(std::string literal, type::CType type){
     //Doesn't matter if already present
-    literal_map.emplace(literal,std::make_unique<value::Value>(literal,type));
-    return literal_map.at(literal).get();
+    auto it = literal_map.try_emplace(std::move(literal)).first;
+    if(!it->second){
+        it->second = std::make_unique<value::Value>(value::Value::Kind::Literal, 0, &it->first, type);
+    }
+    return it->second.get();
+}
+value::Value Context::make_literal(std::string literal, type::CType type){
+    return value::Value(value::Value::Kind::Literal, 0, &*names.insert(std::move(literal)).first, type);
 }
-value::Value* Context::add_local(std::string name, type::CType type){
+void Context::bind_symbol(std::size_t symbol_id, value::Value* v){
+    if(parent && symbol_values.empty()){
+        //Symbols of a function are declared together, so function contexts only cover the ids they bind
+        first_symbol = symbol_id;
+    }else if(symbol_id < first_symbol){
+        symbol_values.insert(symbol_values.begin(), first_symbol - symbol_id, nullptr);
+        first_symbol = symbol_id;
+    }
+    if(symbol_id - first_symbol >= symbol_values.size()){
+        symbol_values.resize(symbol_id - first_symbol + 1, nullptr);
+    }
+    symbol_values[symbol_id - first_symbol] = v;
+}
+value::Value* Context::add_local(std::string name, type::CType type, std::size_t symbol_id){
     assert(current_function && current_scope && "Cannot add local variable outside of function");
-    std::string value = "%" + name +"."+std::to_string(current_function->total_locals);
-    assert(current_scope->sym_map.find(name) == current_scope->sym_map.end() && "Symbol already present in table");
-    current_scope->sym_map.emplace(name,std::make_unique<value::Value>(value, type::PointerType(type)));
+    auto local = current_function->locals.make(value::Value::Kind::Local, current_function->total_locals, 
+        intern_name(name), type::PointerType(type));
     current_function->total_locals++;
-    return current_scope->sym_map.at(name).get();
+    current_function->stats.values++;
+    update_stats();
+    bind_symbol(symbol_id, local);
+    return local;
 }
-value::Value* Context::add_global(std::string name, type::CType type, bool defined){
-    std::string value = "@" + name; //No name mangling
+value::Value* Context::add_global(std::string name, type::CType type, std::size_t symbol_id, bool defined){
+    auto lock = std::lock_guard<std::mutex>(module_context.globals_mutex);
+    auto& global_sym_map = module_context.global_sym_map;
     assert(!(global_sym_map.find(name) != global_sym_map.end() 
         && global_sym_map.at(name).second && defined) && "Redefinition of global symbol");
-    auto emplace_pair = global_sym_map.emplace(name,std::make_pair(std::make_unique<value::Value>(value, type::PointerType(type)), defined));
-    if(!emplace_pair.second){ //If emplace failed because already present
-        global_sym_map.at(name).second = global_sym_map.at(name).second || defined;
+    auto emplace_pair = global_sym_map.try_emplace(std::move(name));
+    auto& entry = emplace_pair.first->second;
+    if(emplace_pair.second){
+        //No name mangling, so the value is named by the map key
+        entry = std::make_pair(std::make_unique<value::Value>(value::Value::Kind::Global, 0, 
+            &emplace_pair.first->first, type::PointerType(type)), defined);
+    }else{ //If emplace failed because already present
+        entry.second = entry.second || defined;
     }
-    return global_sym_map.at(name).first.get();
+    auto global = entry.first.get();
+    bind_symbol(symbol_id, global);
+    return global;
 }
 value::Value* Context::add_string(std::string s, type::CType type){
-    std::string name = "@__const.";
-    if(this->in_function()){
-        name += this->current_function->function_name+".";
+    auto it = string_map.try_emplace(std::move(s)).first;
+    if(!it->second){
+        //Numbered by generate_functions, or given the name of the same string if it was used earlier
+        auto& name = string_names.emplace_back("__const.");
+        if(this->in_function()){
+            name += this->current_function->function_name+".";
+        }
+        it->second = std::make_unique<value::Value>(value::Value::Kind::Global, 0, &name, type::PointerType(type));
+        pending_strings->push_back(PendingString{&it->first, it->second.get(), &name});
     }
-    name += std::to_string(string_map.size());
-    auto emplace_pair = string_map.emplace(s,std::make_unique<value::Value>(name,type::PointerType(type)));
-    return string_map.at(s).get();
+    return it->second.get();
 }
 value::Value* Context::ptr_cast(value::Value* val, type::PointerType t){
-    duplicates.emplace_back(val->get_value(), t);
-    return &duplicates.back();
+    if(this->in_function()){
+        //Released with the other temporaries of the statement
+        current_function->stats.values++;
+        auto cast = current_function->temps.make(*val, t);
+        update_stats();
+        return cast;
+    }
+    return global_casts.make(*val, t);
 }
 std::vector<std::pair<value::Value*,std::string>> Context::undefined_strings() const{
     auto undefined_symbols = std::vector<std::pair<value::Value*,std::string>>{};
-    for(const auto& map_pair : string_map){
-        undefined_symbols.emplace_back(map_pair.second.get(),map_pair.first);
+    for(const auto& map_pair : module_context.string_map){
+        undefined_symbols.emplace_back(map_pair.second,map_pair.first);
     }
     return undefined_symbols;
 }
 std::vector<value::Value*> Context::undefined_globals() const{
     auto undefined_symbols = std::vector<value::Value*>{};
-    for(const auto& map_pair : global_sym_map){
+    for(const auto& map_pair : module_context.global_sym_map){
         if(!map_pair.second.second){
             undefined_symbols.push_back(map_pair.second.first.get());
         }
     }
     return undefined_symbols;
 }
-bool Context::has_symbol(std::string name) const{
-    auto p = current_scope;
-    while(p != nullptr){
-        if(p->sym_map.find(name) != p->sym_map.end()){
-            return true;
-        }
-        p = p->parent;
-    }
-    return global_sym_map.find(name) != global_sym_map.end();
-}
-value::Value* Context::get_value(std::string name) const{
-    auto p = current_scope;
-    while(p != nullptr){
-        if(p->sym_map.find(name) != p->sym_map.end()){
-            return p->sym_map.at(name).get();
-        }
-        if(p->current_depth == 1){assert(!p->parent);}
-        p = p->parent;
+value::Value* Context::get_value(std::size_t symbol_id) const{
+    if(symbol_id >= first_symbol && symbol_id - first_symbol < symbol_values.size() && symbol_values[symbol_id - first_symbol]){
+        return symbol_values[symbol_id - first_symbol];
     }
-    return global_sym_map.at(name).first.get();
-    assert(false && "Failed symbol table lookup in context");
-    return nullptr;
+    assert(parent && "Symbol used before its declaration was generated");
+    return parent->get_value(symbol_id);
 }
 void Context::enter_scope(){
     current_scope = current_scope->new_child();
+    current_scope->locals_mark = current_function->locals.size();
+    current_scope->temps_mark = current_function->temps.size();
+    current_function->live_scopes++;
+    update_stats();
 }
 void Context::exit_scope(){
     assert(current_scope->parent != nullptr && "Tried to leave global scope");
+    current_function->locals.release(current_scope->locals_mark);
+    current_function->temps.release(current_scope->temps_mark);
+    current_function->live_scopes--;
     current_scope = current_scope->parent;
-    current_scope->children.pop_back();
+    current_scope->child = nullptr;
 }
-void Context::enter_function(std::string name, type::CType t, const std::vector<type::CType>& params, std::ostream& output){
+void Context::enter_function(std::string name, const value::Value& function, type::CType t, const std::vector<type::CType>& params){
     assert(!current_scope && !current_function && "Cannot enter function from local scope");
-    current_function = std::make_unique<FunctionScope>(name, t);
+    current_function = std::make_unique<FunctionScope>(name, function, t);
     current_scope = current_function.get();
-    output<<"(";
-    if(params.size() > 0){
-        for(int i=0; i<params.size()-1; i++){
-            output << type::ir_type(params.at(i)) <<" noundef "<<new_temp(params.at(i))->get_value()<<",";
-        }
-        output << type::ir_type(params.back()) <<" noundef "<<new_temp(params.back())->get_value();
+    for(const auto& param : params){
+        current_function->function.params.push_back(*new_temp(param));
     }
-    output<<"){"<<std::endl;
-    enter_block("function.enter",output);
+    enter_block(basicblock::Label(basicblock::LabelKind::FunctionEnter, 0));
 }
-void Context::exit_function(std::ostream& output, std::unique_ptr<basicblock::Terminator> t){
+void Context::exit_function(std::unique_ptr<basicblock::Terminator> t){
     assert(current_function && "Cannot exit function if not in function");
     if(t){
         current_block->add_terminator(std::move(t));
@@ -144,11 +217,78 @@ void Context::exit_function(std::ostream& output, std::unique_ptr<basicblock::Te
     if(!current_block->has_terminator()){
         current_block->add_terminator(std::make_unique<basicblock::DefaultRet>(current_function->ret_type));
     }
-    exit_block(output, nullptr);
+    exit_block(nullptr);
+    current_function->stats.name = current_function->function_name;
+    finished_stats = std::move(current_function->stats);
+    finished_function.emplace(std::move(current_function->function));
     current_function = nullptr;
     current_scope = nullptr;
-    //AST::print_whitespace(this->depth(), output);
-    output << "}"<<std::endl;
+}
+void Context::add_function(std::function<void(Context&)> generate){
+    assert(!parent && !in_function() && "Functions are added by the context of the external declarations");
+    auto& module = module_context;
+    auto slot = module.ir_module.globals.size();
+    module.ir_module.globals.emplace_back(ir::FunctionDeclaration{value::Value(value::Value::Kind::Global, 0, nullptr, type::VoidType())});
+    auto& strings = module.string_batches.emplace_back();
+    module.functions.push_back(ModuleContext::FunctionBody{slot, std::move(generate), 
+        std::unique_ptr<Context>(new Context(module, *this, strings))});
+    //Strings of later external declarations come after those of the function
+    pending_strings = &module.string_batches.emplace_back();
+}
+void Context::generate_functions(){
+    assert(!parent && "Functions are generated by the context of the external declarations");
+    auto& module = module_context;
+    auto& functions = module.functions;
+    auto errors = std::vector<std::exception_ptr>(functions.size());
+    auto next_function = std::atomic<std::size_t>{0};
+    auto worker = [&](){
+        auto arena = types().arena_scope();
+        for(auto i = next_function++; i < functions.size(); i = next_function++){
+            try{
+                functions.at(i).generate(*functions.at(i).context);
+            }catch(...){
+                errors.at(i) = std::current_exception();
+            }
+        }
+    };
+    auto threads = module.threads;
+    if(threads == 0){
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    auto workers = std::vector<std::thread>{};
+    for(unsigned int i = 1; i < threads && i < functions.size(); i++){
+        workers.emplace_back(worker);
+    }
+    worker();
+    for(auto& t : workers){
+        t.join();
+    }
+    for(const auto& e : errors){
+        if(e){
+            std::rethrow_exception(e);
+        }
+    }
+    for(auto& f : functions){
+        auto& function_context = *f.context;
+        assert(function_context.finished_function && "Function body did not exit its function");
+        module.ir_module.globals.at(f.slot) = std::move(*function_context.finished_function);
+        function_context.finished_function.reset();
+        module.function_stats.push_back(std::move(function_context.finished_stats));
+        //Only the context is kept, since the names of the function's values are interned by it
+        f.generate = nullptr;
+    }
+    //A string is numbered by how many strings were used before it
+    for(auto& batch : module.string_batches){
+        for(auto& pending : batch){
+            auto [it, inserted] = module.string_map.try_emplace(*pending.literal, pending.value);
+            if(inserted){
+                *pending.name += std::to_string(module.string_map.size() - 1);
+            }else{
+                *pending.name = *it->second->get_name();
+            }
+        }
+        batch.clear();
+    }
 }
 int Context::depth() const{
     if(!current_scope){
@@ -163,13 +303,12 @@ type::CType Context::return_type() const{
     assert(current_function && "Cannot check return type when not in function");
     return current_function->ret_type;
 }
-void Context::change_block(std::string block_label, std::ostream& output, 
-    std::unique_ptr<basicblock::Terminator> old_terminator){
+void Context::change_block(basicblock::Label block_label, std::unique_ptr<basicblock::Terminator> old_terminator){
     if(old_terminator || current_block->has_terminator()){
-        exit_block(output,std::move(old_terminator));
+        exit_block(std::move(old_terminator));
     }else{
-        exit_block(output, std::make_unique<basicblock::UCond_BR>(block_label));
+        exit_block(std::make_unique<basicblock::UCond_BR>(block_label));
     }
-    enter_block(block_label, output);
+    enter_block(block_label);
 }
 }//namespace context
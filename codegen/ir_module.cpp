@@ -0,0 +1,302 @@
+#include "ir_module.h"
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+namespace ir{
+namespace{
+//Type of the object or function a global value points to
+type::CType pointed_type(const value::Value& value){
+    assert(type::is_type<type::PointerType>(value.get_type()) && "Globals must be stored as pointers");
+    return type::get<type::PointerType>(value.get_type()).pointed_type();
+}
+void print(const GlobalVariable& global, const type::TypeContext* types, ir_writer::Writer& output){
+    auto type = global.storage_type.value_or(pointed_type(global.value));
+    output << global.value.get_value() << " = dso_local global " << type::ir_type(type) << " ";
+    auto literal = std::string();
+    format_constant(global.initializer, type, types, literal);
+    output << literal;
+    if(global.align != 0){
+        output << ", align " << global.align;
+    }
+    output << '\n';
+}
+void print(const StringConstant& string, ir_writer::Writer& output){
+    output << string.value.get_value() << " = private unnamed_addr constant " << type::ir_type(pointed_type(string.value));
+    output << type::ir_literal(string.literal) << '\n';
+}
+void print(const FunctionDeclaration& declaration, ir_writer::Writer& output){
+    auto t = type::get<type::FuncType>(pointed_type(declaration.value));
+    output << "declare " << type::ir_type(t.return_type()) << " " << declaration.value.get_value() << "(";
+    if(t.has_prototype()){
+        auto pt_list = t.param_types();
+        if(pt_list.size() > 0){
+            for(int i=0; i<pt_list.size()-1; i++){
+                output << type::ir_type(pt_list.at(i)) << " noundef,";
+            }
+            output << type::ir_type(pt_list.back()) << " noundef";
+            if(t.is_variadic()){
+                output << ",...";
+            }
+        }
+    }else{
+        output << "...";
+    }
+    output << ")" << '\n';
+}
+void skip_space(std::string_view& text){
+    while(!text.empty() && text.front() == ' '){
+        text.remove_prefix(1);
+    }
+}
+//Skips a type spelling like i32, ptr, [3 x i32] or {i32, ptr}
+void skip_type(std::string_view& text){
+    skip_space(text);
+    int depth = 0;
+    std::size_t i = 0;
+    for(; i < text.size(); i++){
+        if(text[i] == '[' || text[i] == '{'){
+            depth++;
+        }else if(text[i] == ']' || text[i] == '}'){
+            depth--;
+        }else if(text[i] == ' ' && depth == 0){
+            break;
+        }
+    }
+    text.remove_prefix(i);
+}
+int hex_digit(char c){
+    if(c >= '0' && c <= '9'){
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F'){
+        return c - 'A' + 10;
+    }
+    if(c >= 'a' && c <= 'f'){
+        return c - 'a' + 10;
+    }
+    throw std::runtime_error("Invalid hex digit in IR literal");
+}
+//Numbers are integers unless they are written as the hex bits of a double or with a decimal point
+Constant parse_scalar(std::string_view text){
+    if(text == "zeroinitializer" || text == "null"){
+        return Constant::zero();
+    }
+    if(text == "true" || text == "false"){
+        return Constant::of_integer(text == "true");
+    }
+    const auto end = text.data() + text.size();
+    auto result = std::from_chars_result{};
+    if(text.compare(0, 2, "0x") == 0){
+        auto bits = std::uint64_t{0};
+        result = std::from_chars(text.data() + 2, end, bits, 16);
+        if(result.ec == std::errc() && result.ptr == end){
+            double d = 0;
+            static_assert(sizeof(d) == sizeof(bits));
+            std::memcpy(&d, &bits, sizeof(d));
+            return Constant::of_float(d);
+        }
+    }else if(text.find_first_of(".eE") != std::string_view::npos){
+        auto literal = std::string(text);
+        auto literal_end = static_cast<char*>(nullptr);
+        double d = std::strtod(literal.c_str(), &literal_end);
+        if(literal_end == literal.c_str() + literal.size()){
+            return Constant::of_float(d);
+        }
+    }else if(!text.empty() && text.front() == '-'){
+        auto value = 0LL;
+        result = std::from_chars(text.data(), end, value);
+        if(result.ec == std::errc() && result.ptr == end){
+            return Constant::of_integer(value);
+        }
+    }else{
+        //Unsigned long longs may be written past the range of a long long, and are kept as the same bits
+        auto bits = std::uint64_t{0};
+        result = std::from_chars(text.data(), end, bits);
+        if(result.ec == std::errc() && result.ptr == end){
+            return Constant::of_integer(static_cast<long long>(bits));
+        }
+    }
+    throw std::runtime_error("Invalid number "+std::string(text)+" in IR literal");
+}
+//Structs and unions are typed by their tags, whose members are kept in the context,
+//except for the literal structs a global is stored as, which hold their members themselves
+type::CType tag_definition(const type::CType& type, const type::TypeContext* types){
+    if(types && type::is_type<type::StructType>(type) && !type::get<type::StructType>(type).is_complete()){
+        return types->get_tag(type::get<type::StructType>(type));
+    }
+    if(types && type::is_type<type::UnionType>(type)){
+        return types->get_tag(type::get<type::UnionType>(type));
+    }
+    return type;
+}
+//Parses one constant from the front of the text
+Constant parse_front(std::string_view& text){
+    skip_space(text);
+    if(text.empty()){
+        throw std::runtime_error("Missing constant in IR literal");
+    }
+    if(text.front() == '[' || text.front() == '{'){
+        const char close = text.front() == '[' ? ']' : '}';
+        text.remove_prefix(1);
+        auto aggregate = Constant::aggregate({});
+        skip_space(text);
+        while(!text.empty() && text.front() != close){
+            skip_type(text);
+            aggregate.elements.push_back(parse_front(text));
+            skip_space(text);
+            if(!text.empty() && text.front() == ','){
+                text.remove_prefix(1);
+                skip_space(text);
+            }
+        }
+        if(text.empty()){
+            throw std::runtime_error("Unterminated aggregate in IR literal");
+        }
+        text.remove_prefix(1);
+        return aggregate;
+    }
+    if(text.compare(0, 2, "c\"") == 0){
+        auto string = Constant::of_string("");
+        //Quotes and backslashes inside the string are escaped as \XX
+        std::size_t i = 2;
+        for(; i < text.size() && text[i] != '"'; i++){
+            if(text[i] == '\\'){
+                if(i + 2 >= text.size()){
+                    break;
+                }
+                string.text.push_back(static_cast<char>(hex_digit(text[i+1]) * 16 + hex_digit(text[i+2])));
+                i += 2;
+            }else{
+                string.text.push_back(text[i]);
+            }
+        }
+        if(i >= text.size()){
+            throw std::runtime_error("Unterminated string in IR literal");
+        }
+        text.remove_prefix(i + 1);
+        return string;
+    }
+    auto length = std::min(text.find_first_of(" ,]}"), text.size());
+    auto scalar = parse_scalar(text.substr(0, length));
+    text.remove_prefix(length);
+    return scalar;
+}
+} //namespace
+
+Constant parse_constant(std::string_view literal){
+    auto rest = literal;
+    auto result = parse_front(rest);
+    skip_space(rest);
+    if(!rest.empty()){
+        throw std::runtime_error("Trailing text in IR literal "+std::string(literal));
+    }
+    return result;
+}
+bool is_zero(const Constant& constant){
+    switch(constant.kind){
+        case Constant::Kind::Zero:
+            return true;
+        case Constant::Kind::Integer:
+            return constant.integer == 0;
+        case Constant::Kind::Float:
+            //A negative zero has its sign bit set
+            return constant.floating == 0 && !std::signbit(constant.floating);
+        case Constant::Kind::String:
+        case Constant::Kind::Aggregate:
+            break;
+    }
+    return false;
+}
+void format_constant(const Constant& constant, const type::CType& type, const type::TypeContext* types, std::string& output){
+    switch(constant.kind){
+        case Constant::Kind::Zero:
+            output += type::visit(type::make_visitor<const char*>(
+                [](const type::IType&){return "0";},
+                [](const type::FType&){return "0.0";},
+                [](const type::PointerType&){return "null";},
+                [](const auto&){return "zeroinitializer";}
+                ), type);
+            return;
+        case Constant::Kind::Integer:
+            assert(type::is_type<type::BasicType>(type) && "Integer constant must have a number type");
+            output += type::ir_literal(constant.integer, type::get<type::BasicType>(type));
+            return;
+        case Constant::Kind::Float:
+            assert(type::is_type<type::BasicType>(type) && "Floating point constant must have a number type");
+            output += type::ir_literal(static_cast<long double>(constant.floating), type::get<type::BasicType>(type));
+            return;
+        case Constant::Kind::String:
+            output += type::ir_literal(constant.text);
+            return;
+        case Constant::Kind::Aggregate:
+            break;
+    }
+    auto element = [&](const type::CType& t, const Constant& c){
+        output += type::ir_type(t);
+        output += ' ';
+        format_constant(c, t, types, output);
+    };
+    const auto definition = tag_definition(type, types);
+    if(type::is_type<type::ArrayType>(type)){
+        auto element_type = type::get<type::ArrayType>(type).pointed_type();
+        output += "[ ";
+        for(std::size_t i = 0; i < constant.elements.size(); i++){
+            if(i > 0){
+                output += ", ";
+            }
+            element(element_type, constant.elements[i]);
+        }
+        output += "]";
+    }else if(type::is_type<type::UnionType>(definition)){
+        const auto& union_type = type::get<type::UnionType>(definition);
+        assert(union_type.largest_computed && constant.elements.size() == 1 && "Union constant must give its largest member");
+        output += "{ ";
+        element(union_type.largest, constant.elements.front());
+        output += "}";
+    }else{
+        assert(type::is_type<type::StructType>(definition) && "Aggregate constant must be an array, struct or union");
+        const auto& members = type::get<type::StructType>(definition).members;
+        assert(members.size() == constant.elements.size() && "Struct constant must give every member");
+        output += "{ ";
+        for(std::size_t i = 0; i < constant.elements.size(); i++){
+            if(i > 0){
+                output += ", ";
+            }
+            element(members[i], constant.elements[i]);
+        }
+        output += "}";
+    }
+}
+void print(const Function& function, ir_writer::Writer& output){
+    output << "define dso_local " << type::ir_type(function.return_type) << " " << function.value.get_value() << "(";
+    for(std::size_t i = 0; i < function.params.size(); i++){
+        if(i > 0){
+            output << ",";
+        }
+        output << type::ir_type(function.params[i].get_type()) << " noundef " << function.params[i].get_value();
+    }
+    output << "){" << '\n';
+    for(const auto& block : function.blocks){
+        block->print(output);
+    }
+    output << "}" << '\n';
+}
+void print(const Module& module, ir_writer::Writer& output){
+    output << R"(target triple = "x86_64-unknown-linux-gnu")" << '\n';
+    if(module.types){
+        module.types->tag_ir_types(output);
+    }
+    for(const auto& global : module.globals){
+        std::visit(type::overloaded{
+            [&](const GlobalVariable& g){print(g, module.types, output);},
+            [&](const auto& g){print(g, output);},
+            }, global);
+    }
+}
+} //namespace ir
@@ -0,0 +1,463 @@
+#include "llvm_backend.h"
+#include "conversions.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm_backend{
+namespace{
+const std::unordered_map<std::string_view, llvm::Instruction::BinaryOps> binary_ops = {
+    {"add", llvm::Instruction::Add}, {"sub", llvm::Instruction::Sub}, {"mul", llvm::Instruction::Mul},
+    {"sdiv", llvm::Instruction::SDiv}, {"udiv", llvm::Instruction::UDiv},
+    {"srem", llvm::Instruction::SRem}, {"urem", llvm::Instruction::URem},
+    {"shl", llvm::Instruction::Shl}, {"lshr", llvm::Instruction::LShr}, {"ashr", llvm::Instruction::AShr},
+    {"and", llvm::Instruction::And}, {"or", llvm::Instruction::Or}, {"xor", llvm::Instruction::Xor},
+    {"fadd", llvm::Instruction::FAdd}, {"fsub", llvm::Instruction::FSub}, {"fmul", llvm::Instruction::FMul},
+    {"fdiv", llvm::Instruction::FDiv}, {"frem", llvm::Instruction::FRem},
+};
+const std::unordered_map<std::string_view, llvm::CmpInst::Predicate> comparisons = {
+    {"icmp eq", llvm::CmpInst::ICMP_EQ}, {"icmp ne", llvm::CmpInst::ICMP_NE},
+    {"icmp sgt", llvm::CmpInst::ICMP_SGT}, {"icmp sge", llvm::CmpInst::ICMP_SGE},
+    {"icmp slt", llvm::CmpInst::ICMP_SLT}, {"icmp sle", llvm::CmpInst::ICMP_SLE},
+    {"icmp ugt", llvm::CmpInst::ICMP_UGT}, {"icmp uge", llvm::CmpInst::ICMP_UGE},
+    {"icmp ult", llvm::CmpInst::ICMP_ULT}, {"icmp ule", llvm::CmpInst::ICMP_ULE},
+    {"fcmp oeq", llvm::CmpInst::FCMP_OEQ}, {"fcmp one", llvm::CmpInst::FCMP_ONE},
+    {"fcmp ogt", llvm::CmpInst::FCMP_OGT}, {"fcmp oge", llvm::CmpInst::FCMP_OGE},
+    {"fcmp olt", llvm::CmpInst::FCMP_OLT}, {"fcmp ole", llvm::CmpInst::FCMP_OLE},
+    {"fcmp une", llvm::CmpInst::FCMP_UNE}, {"fcmp ueq", llvm::CmpInst::FCMP_UEQ},
+};
+const std::unordered_map<std::string_view, llvm::Instruction::CastOps> casts = {
+    {"trunc", llvm::Instruction::Trunc}, {"zext", llvm::Instruction::ZExt}, {"sext", llvm::Instruction::SExt},
+    {"fptrunc", llvm::Instruction::FPTrunc}, {"fpext", llvm::Instruction::FPExt},
+    {"fptosi", llvm::Instruction::FPToSI}, {"fptoui", llvm::Instruction::FPToUI},
+    {"sitofp", llvm::Instruction::SIToFP}, {"uitofp", llvm::Instruction::UIToFP},
+    {"ptrtoint", llvm::Instruction::PtrToInt}, {"inttoptr", llvm::Instruction::IntToPtr},
+    {"bitcast", llvm::Instruction::BitCast},
+};
+template<typename Table>
+auto lookup(const Table& table, const char* opcode){
+    auto it = table.find(opcode);
+    if(it == table.end()){
+        throw std::runtime_error(std::string("Cannot lower opcode ")+opcode);
+    }
+    return it->second;
+}
+
+//Lowers one module, keeping track of the named types and the registers and blocks of the current function
+class ModuleBuilder{
+    llvm::LLVMContext& context;
+    std::unique_ptr<llvm::Module> module;
+    llvm::IRBuilder<> builder;
+    //Named struct types for the struct and union tags, by mangled tag
+    std::unordered_map<std::string, llvm::StructType*> tags;
+    //Registers of the function being built, with temporaries by number and locals by name and number
+    std::vector<llvm::Value*> temps;
+    std::map<std::pair<const std::string*, std::uint32_t>, llvm::Value*> locals;
+    std::map<basicblock::Label, llvm::BasicBlock*> blocks;
+    //Literals by their interned text and type, so the text of each is only read once
+    std::map<std::pair<const std::string*, llvm::Type*>, llvm::Constant*> literals;
+
+    llvm::Type* lower(const type::CType& t){
+        switch(t.kind()){
+            case type::TypeKind::Void:
+                return llvm::Type::getVoidTy(context);
+            case type::TypeKind::Int:
+            {
+                auto bits = conversions::properties(std::get<type::IType>(type::get<type::BasicType>(t))).bits;
+                return llvm::IntegerType::get(context, bits);
+            }
+            case type::TypeKind::Float:
+                //Long doubles are written as doubles, as in the textual IR
+                if(std::get<type::FType>(type::get<type::BasicType>(t)) == type::FType::Float){
+                    return llvm::Type::getFloatTy(context);
+                }
+                return llvm::Type::getDoubleTy(context);
+            case type::TypeKind::Pointer:
+                return llvm::PointerType::get(context, 0);
+            case type::TypeKind::Array:
+            {
+                const auto& array = type::get<type::ArrayType>(t);
+                return llvm::ArrayType::get(lower(array.pointed_type()), array.is_complete() ? array.size() : 0);
+            }
+            case type::TypeKind::Function:
+            {
+                const auto& function = type::get<type::FuncType>(t);
+                auto params = std::vector<llvm::Type*>{};
+                if(function.has_prototype()){
+                    for(const auto& param : function.param_types()){
+                        params.push_back(lower(param));
+                    }
+                }
+                return llvm::FunctionType::get(lower(function.return_type()), params,
+                    !function.has_prototype() || function.is_variadic());
+            }
+            case type::TypeKind::Struct:
+            {
+                const auto& s = type::get<type::StructType>(t);
+                if(s.members.empty() && !s.complete){
+                    return tag(s.tag);
+                }
+                auto members = std::vector<llvm::Type*>{};
+                for(const auto& member : s.members){
+                    members.push_back(lower(member));
+                }
+                return llvm::StructType::get(context, members);
+            }
+            case type::TypeKind::Union:
+            {
+                const auto& u = type::get<type::UnionType>(t);
+                if(u.members.empty()){
+                    return u.complete ? llvm::StructType::get(context) : tag(u.tag);
+                }
+                assert(u.largest_computed && "Cannot lower a union without computing its largest member");
+                auto largest = lower(u.largest);
+                return llvm::StructType::get(context, llvm::ArrayRef<llvm::Type*>(largest));
+            }
+            case type::TypeKind::Typedef:
+                break;
+        }
+        throw std::runtime_error("Cannot lower type "+type::to_string(t));
+    }
+    llvm::StructType* tag(const std::string& name){
+        auto it = tags.find(name);
+        if(it == tags.end()){
+            throw std::runtime_error("Cannot lower undeclared tag "+name);
+        }
+        return it->second;
+    }
+    void declare_tags(const type::TypeContext& types){
+        auto table = types.tag_table();
+        //Create every tag before any bodies, since bodies may refer to other tags
+        for(const auto& [name, t] : table){
+            if(type::is_type<type::StructType>(t) || type::is_type<type::UnionType>(t)){
+                tags.emplace(name, llvm::StructType::create(context, name));
+            }
+        }
+        for(const auto& [name, t] : table){
+            if(auto it = tags.find(name); it != tags.end()){
+                it->second->setBody(llvm::cast<llvm::StructType>(lower(t))->elements());
+            }
+        }
+    }
+
+    llvm::Constant* constant(const ir::Constant& c, llvm::Type* t){
+        switch(c.kind){
+            case ir::Constant::Kind::Aggregate:{
+                auto elements = std::vector<llvm::Constant*>{};
+                for(const auto& element : c.elements){
+                    if(t->isArrayTy()){
+                        elements.push_back(constant(element, t->getArrayElementType()));
+                    }else if(t->isStructTy() && elements.size() < t->getStructNumElements()){
+                        elements.push_back(constant(element, t->getStructElementType(elements.size())));
+                    }else{
+                        throw std::runtime_error("Aggregate constant does not match its type");
+                    }
+                }
+                if(auto array = llvm::dyn_cast<llvm::ArrayType>(t)){
+                    return llvm::ConstantArray::get(array, elements);
+                }
+                return llvm::ConstantStruct::get(llvm::cast<llvm::StructType>(t), elements);
+            }
+            case ir::Constant::Kind::String:
+                if(!t->isArrayTy()){
+                    throw std::runtime_error("Cannot lower string constant");
+                }
+                return llvm::ConstantDataArray::getString(context, c.text, false);
+            case ir::Constant::Kind::Zero:
+                return llvm::Constant::getNullValue(t);
+            case ir::Constant::Kind::Integer:
+                if(auto int_type = llvm::dyn_cast<llvm::IntegerType>(t)){
+                    return llvm::ConstantInt::get(int_type,
+                        llvm::APInt(64, static_cast<std::uint64_t>(c.integer)).sextOrTrunc(int_type->getBitWidth()));
+                }
+                if(t->isFloatingPointTy()){
+                    return llvm::ConstantFP::get(t, static_cast<double>(c.integer));
+                }
+                break;
+            case ir::Constant::Kind::Float:
+                if(t->isFloatingPointTy()){
+                    return llvm::ConstantFP::get(t, c.floating);
+                }
+                break;
+        }
+        throw std::runtime_error("Constant does not match its type");
+    }
+    llvm::Constant* literal(const std::string* text, const type::CType& t){
+        auto lowered = lower(t);
+        auto& result = literals[{text, lowered}];
+        if(!result){
+            result = constant(ir::parse_constant(*text), lowered);
+        }
+        return result;
+    }
+    llvm::Value* value(const value::Value& v){
+        llvm::Value* result = nullptr;
+        switch(v.get_kind()){
+            case value::Value::Kind::Temp:
+                if(v.get_number() < temps.size()){
+                    result = temps[v.get_number()];
+                }
+                break;
+            case value::Value::Kind::Local:
+                if(auto it = locals.find({v.get_name(), v.get_number()}); it != locals.end()){
+                    result = it->second;
+                }
+                break;
+            case value::Value::Kind::Global:
+                result = module->getNamedValue(*v.get_name());
+                break;
+            case value::Value::Kind::Literal:
+                return literal(v.get_name(), v.get_type());
+        }
+        if(!result){
+            throw std::runtime_error("Use of undefined value "+v.get_value().str());
+        }
+        return result;
+    }
+    void define(const value::Value& v, llvm::Value* result){
+        if(v.get_kind() == value::Value::Kind::Temp){
+            if(v.get_number() >= temps.size()){
+                temps.resize(v.get_number() + 1, nullptr);
+            }
+            temps[v.get_number()] = result;
+        }else{
+            assert(v.get_kind() == value::Value::Kind::Local && "Only registers can be defined in a function");
+            result->setName(*v.get_name() + "." + std::to_string(v.get_number()));
+            locals[{v.get_name(), v.get_number()}] = result;
+        }
+    }
+    llvm::BasicBlock* block(const basicblock::Label& label){
+        auto it = blocks.find(label);
+        if(it == blocks.end()){
+            auto name = std::string();
+            auto output = llvm::raw_string_ostream(name);
+            label.print(output);
+            throw std::runtime_error("Branch to missing block "+output.str());
+        }
+        return it->second;
+    }
+
+    void build(const basicblock::Instruction& instruction){
+        using Kind = basicblock::Instruction::Kind;
+        const auto& operands = instruction.get_operands();
+        llvm::Value* result = nullptr;
+        switch(instruction.get_kind()){
+            case Kind::Alloca:
+                result = builder.CreateAlloca(lower(instruction.get_type()));
+                break;
+            case Kind::Load:
+                result = builder.CreateLoad(lower(instruction.get_type()), value(operands.at(0)));
+                break;
+            case Kind::Store:
+                builder.CreateStore(value(operands.at(0)), value(operands.at(1)));
+                break;
+            case Kind::GetElementPtr:
+            {
+                auto indices = std::vector<llvm::Value*>{};
+                for(std::size_t i = 1; i < operands.size(); i++){
+                    indices.push_back(value(operands[i]));
+                }
+                auto source = lower(instruction.get_type());
+                if(!llvm::GetElementPtrInst::getIndexedType(source, indices)){
+                    throw std::runtime_error("Invalid getelementptr indices");
+                }
+                if(std::strcmp(instruction.get_opcode(), "getelementptr inbounds") == 0){
+                    result = builder.CreateInBoundsGEP(source, value(operands.at(0)), indices);
+                }else{
+                    result = builder.CreateGEP(source, value(operands.at(0)), indices);
+                }
+                break;
+            }
+            case Kind::ExtractValue:
+            {
+                auto index = llvm::cast<llvm::ConstantInt>(value(operands.at(1)))->getZExtValue();
+                result = builder.CreateExtractValue(value(operands.at(0)), {static_cast<unsigned>(index)});
+                break;
+            }
+            case Kind::Call:
+            {
+                auto callee = value(operands.at(0));
+                auto args = std::vector<llvm::Value*>{};
+                auto arg_types = std::vector<llvm::Type*>{};
+                for(std::size_t i = 1; i < operands.size(); i++){
+                    args.push_back(value(operands[i]));
+                    arg_types.push_back(args.back()->getType());
+                }
+                //Calls to variadic functions need the callee's type, otherwise the type is given by the arguments
+                auto function = llvm::dyn_cast<llvm::Function>(callee);
+                auto function_type = function && function->isVarArg() ? function->getFunctionType()
+                    : llvm::FunctionType::get(lower(instruction.get_type()), arg_types, false);
+                result = builder.CreateCall(function_type, callee, args);
+                break;
+            }
+            case Kind::Cast:
+                result = builder.CreateCast(lookup(casts, instruction.get_opcode()), value(operands.at(0)),
+                    lower(instruction.get_result()->get_type()));
+                break;
+            case Kind::Binary:
+            {
+                auto left = value(operands.at(0));
+                auto right = value(operands.at(1));
+                auto opcode = instruction.get_opcode();
+                if(std::strncmp(opcode, "icmp ", 5) == 0 || std::strncmp(opcode, "fcmp ", 5) == 0){
+                    result = builder.CreateCmp(lookup(comparisons, opcode), left, right);
+                }else{
+                    result = builder.CreateBinOp(lookup(binary_ops, opcode), left, right);
+                }
+                break;
+            }
+        }
+        if(instruction.get_result()){
+            define(*instruction.get_result(), result);
+        }
+    }
+    void build(const basicblock::Terminator& terminator){
+        if(auto ret = dynamic_cast<const basicblock::RET*>(&terminator)){
+            if(ret->get_value()){
+                builder.CreateRet(value(*ret->get_value()));
+            }else{
+                builder.CreateRetVoid();
+            }
+        }else if(auto ret = dynamic_cast<const basicblock::DefaultRet*>(&terminator)){
+            if(type::is_type<type::ArrayType>(ret->get_type())){
+                throw std::runtime_error("Cannot have array type as return value");
+            }
+            if(type::is_type<type::VoidType>(ret->get_type())){
+                builder.CreateRetVoid();
+            }else{
+                builder.CreateRet(llvm::Constant::getNullValue(lower(ret->get_type())));
+            }
+        }else if(auto br = dynamic_cast<const basicblock::Cond_BR*>(&terminator)){
+            builder.CreateCondBr(value(br->get_condition()), block(br->get_true_label()), block(br->get_false_label()));
+        }else if(auto br = dynamic_cast<const basicblock::UCond_BR*>(&terminator)){
+            builder.CreateBr(block(br->get_label()));
+        }else if(auto s = dynamic_cast<const basicblock::Switch*>(&terminator)){
+            auto control = value(s->get_control());
+            auto inst = builder.CreateSwitch(control, block(s->get_default_label()), s->get_cases().size());
+            for(const auto& [case_value, label] : s->get_cases()){
+                inst->addCase(llvm::ConstantInt::get(llvm::cast<llvm::IntegerType>(control->getType()), case_value, true),
+                    block(label));
+            }
+        }else{
+            assert(dynamic_cast<const basicblock::Unreachable*>(&terminator) && "Unknown terminator");
+            builder.CreateUnreachable();
+        }
+    }
+
+    llvm::GlobalVariable* global_variable(const value::Value& v, bool constant, llvm::GlobalValue::LinkageTypes linkage){
+        assert(type::is_type<type::PointerType>(v.get_type()) && "Globals must be stored as pointers");
+        auto pointed = lower(type::get<type::PointerType>(v.get_type()).pointed_type());
+        return new llvm::GlobalVariable(*module, pointed, constant, linkage, nullptr, *v.get_name());
+    }
+    llvm::Function* function(const value::Value& v, llvm::FunctionType* t){
+        if(auto existing = module->getFunction(*v.get_name())){
+            return existing;
+        }
+        return llvm::Function::Create(t, llvm::Function::ExternalLinkage, *v.get_name(), *module);
+    }
+    //Creates the global, without its initializer or body, so that globals can refer to each other in any order
+    void declare(const ir::GlobalVariable& global){
+        auto t = lower(global.storage_type.value_or(type::get<type::PointerType>(global.value.get_type()).pointed_type()));
+        auto variable = new llvm::GlobalVariable(*module, t, false, llvm::GlobalValue::ExternalLinkage, nullptr,
+            *global.value.get_name());
+        variable->setDSOLocal(true);
+        if(global.align != 0){
+            variable->setAlignment(llvm::MaybeAlign(global.align));
+        }
+    }
+    void declare(const ir::StringConstant& string){
+        global_variable(string.value, true, llvm::GlobalValue::PrivateLinkage)
+            ->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    }
+    void declare(const ir::FunctionDeclaration& declaration){
+        auto t = lower(type::get<type::PointerType>(declaration.value.get_type()).pointed_type());
+        function(declaration.value, llvm::cast<llvm::FunctionType>(t));
+    }
+    void declare(const ir::Function& f){
+        auto params = std::vector<llvm::Type*>{};
+        for(const auto& param : f.params){
+            params.push_back(lower(param.get_type()));
+        }
+        function(f.value, llvm::FunctionType::get(lower(f.return_type), params, false))->setDSOLocal(true);
+    }
+    void define(const ir::GlobalVariable& global){
+        auto variable = module->getGlobalVariable(*global.value.get_name());
+        variable->setInitializer(constant(global.initializer, variable->getValueType()));
+    }
+    void define(const ir::StringConstant& string){
+        auto global = module->getGlobalVariable(*string.value.get_name(), true);
+        global->setInitializer(constant(ir::Constant::of_string(string.literal), global->getValueType()));
+    }
+    void define(const ir::FunctionDeclaration& declaration){}
+    void define(const ir::Function& f){
+        auto function = module->getFunction(*f.value.get_name());
+        temps.clear();
+        locals.clear();
+        blocks.clear();
+        for(std::size_t i = 0; i < f.params.size(); i++){
+            define(f.params[i], function->getArg(i));
+        }
+        for(const auto& b : f.blocks){
+            auto name = llvm::SmallString<32>();
+            auto output = llvm::raw_svector_ostream(name);
+            b->get_label().print(output);
+            blocks.emplace(b->get_label(), llvm::BasicBlock::Create(context, name, function));
+        }
+        for(const auto& b : f.blocks){
+            assert(b->has_terminator() && "Block without a terminator");
+            builder.SetInsertPoint(block(b->get_label()));
+            for(const auto& instruction : b->get_instructions()){
+                build(instruction);
+            }
+            build(*b->get_terminator());
+        }
+    }
+public:
+    ModuleBuilder(llvm::LLVMContext& context)
+        : context(context), module(std::make_unique<llvm::Module>("", context)), builder(context) {}
+    std::unique_ptr<llvm::Module> build(const ir::Module& source){
+        module->setTargetTriple("x86_64-unknown-linux-gnu");
+        if(source.types){
+            declare_tags(*source.types);
+        }
+        for(const auto& global : source.globals){
+            std::visit([this](const auto& g){declare(g);}, global);
+        }
+        for(const auto& global : source.globals){
+            std::visit([this](const auto& g){define(g);}, global);
+        }
+        return std::move(module);
+    }
+};
+} //namespace
+
+std::unique_ptr<llvm::Module> build_module(const ir::Module& module, llvm::LLVMContext& context){
+#if LLVM_VERSION_MAJOR < 15
+    //Later releases use opaque pointers by default
+    context.enableOpaquePointers();
+#endif
+    return ModuleBuilder(context).build(module);
+}
+void write_bitcode(const llvm::Module& module, const std::string& path){
+    std::error_code error;
+    llvm::raw_fd_ostream output(path, error, llvm::sys::fs::OF_None);
+    if(error){
+        throw std::runtime_error("Could not open "+path+": "+error.message());
+    }
+    llvm::WriteBitcodeToFile(module, output);
+}
+} //namespace llvm_backend
@@ -10,6 +10,10 @@
 #include "token.h"
 #include "type.h"
 #include "symbol.h"
+namespace serialize{
+class Writer;
+class Reader;
+}//namespace serialize
 namespace ast{
 
 //Forward declare node types
@@ -30,8 +34,9 @@ struct AST{
     static void print_whitespace(int depth, std::ostream& output = std::cout);
     virtual void analyze(symbol::STable* st) = 0;
     virtual void pretty_print(int depth) const = 0;
+    virtual void serialize(serialize::Writer& w) const = 0;
     virtual ~AST() = 0;
-    virtual value::Value* codegen(std::ostream& output, context::Context& c) const = 0;
+    virtual value::Value* codegen(context::Context& c) const = 0;
 };
 struct BlockItem : virtual public AST{
     //Block items can appear in compound statements
@@ -51,23 +56,27 @@ struct AmbiguousBlock : public BlockItem{
     AmbiguousBlock(std::vector<token::Token> toks) : unparsed_tokens(toks), ambiguous_ident(toks.front()) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct Initializer{
     virtual ~Initializer() = 0;
-    virtual void initializer_codegen(value::Value* variable, std::ostream& output, context::Context& c) const = 0;
+    virtual void initializer_codegen(value::Value* variable, context::Context& c) const = 0;
     virtual void initializer_print(int depth) const = 0;
+    virtual void initializer_serialize(serialize::Writer& w) const = 0;
     virtual void initializer_analyze(type::CType& variable_type, symbol::STable* st) = 0;
-    virtual std::string compute_constant(type::CType type) const = 0;
+    //Value of a static initializer for an object of the given type
+    virtual ir::Constant initializer_constant(type::CType type) const = 0;
 };
 struct InitializerList : public Initializer{
     token::Token tok;
     std::vector<std::unique_ptr<Initializer>> initializers;
     InitializerList(token::Token tok, std::vector<std::unique_ptr<Initializer>> inits) : tok(tok), initializers(std::move(inits)) {}
-    void initializer_codegen(value::Value* variable, std::ostream& output, context::Context& c) const;
+    void initializer_codegen(value::Value* variable, context::Context& c) const;
     void initializer_print(int depth) const;
+    void initializer_serialize(serialize::Writer& w) const;
     void initializer_analyze(type::CType& variable_type, symbol::STable* st);
-    std::string compute_constant(type::CType type) const override;
+    ir::Constant initializer_constant(type::CType type) const override;
 };
 typedef std::variant<std::monostate,long long int, long double> ConstantExprType;
 struct Expr : virtual public Stmt, public Initializer{
@@ -77,20 +86,32 @@ struct Expr : virtual public Stmt, public Initializer{
     token::Token tok;
     Expr(token::Token tok) : tok(tok), analyzed(){}
     virtual ~Expr() = 0;
-    void initializer_codegen(value::Value* variable, std::ostream& output, context::Context& c) const override;
+    void initializer_codegen(value::Value* variable, context::Context& c) const override;
     void initializer_print(int depth) const override;
+    void initializer_serialize(serialize::Writer& w) const override;
     void initializer_analyze(type::CType& variable_type, symbol::STable* st) override;
-    std::string compute_constant(type::CType type) const override;
+    ir::Constant initializer_constant(type::CType type) const override;
+    //Text of the constant value as the given basic type
+    std::string compute_constant(type::CType type) const;
 };
 
 struct Program : public AST{
     std::vector<std::unique_ptr<ExtDecl>> decls;
+    //Tags declared by this translation unit, filled in during analysis
+    type::TypeContext types;
     Program(std::vector<std::unique_ptr<ExtDecl>> decls) : decls(std::move(decls)) {}
+    //With the context whose arena holds the types of the declarations
+    Program(std::vector<std::unique_ptr<ExtDecl>> decls, type::TypeContext types) 
+        : decls(std::move(decls)), types(std::move(types)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
+    //Generates the program into the module of the context and prints it to the stream
+    void codegen(std::ostream& output, context::Context& c) const;
     void analyze(){
-        auto global_st = symbol::GlobalTable();
+        auto arena = types.arena_scope();
+        auto global_st = symbol::GlobalTable(types);
         this->analyze(&global_st);
     }
 };
@@ -99,7 +120,8 @@ struct NullStmt : public Stmt{
     NullStmt(){}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct TypeDecl : virtual public AST {
@@ -107,7 +129,7 @@ struct TypeDecl : virtual public AST {
     //To the analysis step
     token::Token tok;
     TypeDecl(token::Token tok) : tok(tok) {}
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct TypedefDecl : public TypeDecl {
     std::string name;
@@ -116,12 +138,14 @@ struct TypedefDecl : public TypeDecl {
         TypeDecl(tok), name(tok.value), type(std::move(type)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
+    void serialize(serialize::Writer& w) const override;
 };
 struct TagDecl : public TypeDecl {
     type::TagType type;
     TagDecl(token::Token tok, type::TagType type) : TypeDecl(tok), type(std::move(type)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
+    void serialize(serialize::Writer& w) const override;
 };
 struct ExtDecl : virtual public AST{
     std::vector<std::unique_ptr<TypeDecl>> tag_decls;
@@ -132,6 +156,8 @@ struct Decl : virtual public AST{
     const std::string name;
     const token::Token tok;
     type::CType type;
+    //Set by analysis, and used by codegen to record the value of the declared symbol
+    symbol::SymbolId symbol_id = 0;
     Decl(token::Token tok, type::CType type) 
         : tok(tok), name(tok.value), type(type) {}
     virtual ~Decl() = 0;
@@ -143,7 +169,8 @@ struct DeclList : public BlockItem, public ExtDecl{
         : ExtDecl(std::move(tags)), decls(std::move(decls)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct FunctionDecl : public Decl{
     bool analyzed = false;
@@ -151,7 +178,8 @@ struct FunctionDecl : public Decl{
         : Decl(name_tok, type){}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct VarDecl : public Decl{
     bool analyzed = false;
@@ -161,7 +189,8 @@ struct VarDecl : public Decl{
         : Decl(tok,type), assignment(std::move(assignment)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct EnumVarDecl : public TypeDecl{
     std::unique_ptr<Expr> initializer;
@@ -169,7 +198,8 @@ struct EnumVarDecl : public TypeDecl{
         : TypeDecl(tok), initializer(std::move(initializer)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct DoStmt : public Stmt{
     std::unique_ptr<Expr> control_expr;
@@ -178,7 +208,8 @@ struct DoStmt : public Stmt{
         : control_expr(std::move(control)), body(std::move(body)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct WhileStmt : public Stmt{
     std::unique_ptr<Expr> control_expr;
@@ -187,7 +218,8 @@ struct WhileStmt : public Stmt{
         : control_expr(std::move(control)), body(std::move(body)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct ForStmt : public Stmt{
     typedef std::variant<std::monostate,std::unique_ptr<DeclList>,std::unique_ptr<Expr>, std::unique_ptr<AmbiguousBlock>> InitClauseTypes;
@@ -201,7 +233,8 @@ struct ForStmt : public Stmt{
         post_expr(std::move(post)) , body(std::move(body)){}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct IfStmt : public Stmt{
     std::unique_ptr<Expr> if_condition;
@@ -211,7 +244,8 @@ struct IfStmt : public Stmt{
         if_condition(std::move(if_condition)), if_body(std::move(if_body)), else_body(std::move(else_body)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct CaseStmt : public Stmt{
     token::Token tok;
@@ -221,7 +255,8 @@ struct CaseStmt : public Stmt{
         : tok(tok), label(std::move(c)), stmt(std::move(stmt)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct DefaultStmt : public Stmt{
     token::Token tok;
@@ -230,7 +265,8 @@ struct DefaultStmt : public Stmt{
         : tok(tok), stmt(std::move(stmt)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct SwitchStmt : public Stmt{
     std::unique_ptr<Expr> control_expr;
@@ -240,27 +276,41 @@ struct SwitchStmt : public Stmt{
         :control_expr(std::move(expr)), switch_body(std::move(body)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 private:
+    friend class serialize::Reader;
     std::unique_ptr<std::set<std::optional<unsigned long long int>>> case_table;
 };
 struct CompoundStmt : public Stmt{
     std::vector<std::unique_ptr<BlockItem>> stmt_body;
     CompoundStmt(std::vector<std::unique_ptr<BlockItem>> stmt_body) : stmt_body(std::move(stmt_body)) {}
     void analyze(symbol::STable*) override;
+    //Analyzes the statements in an already opened block scope
+    void analyze_stmts(symbol::BlockTable* stmt_table);
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct FunctionDef : public ExtDecl, public FunctionDecl{
     std::vector<std::unique_ptr<VarDecl>> params;
     std::unique_ptr<CompoundStmt> function_body;
+    //Tokens of a lazily parsed body, which stays null until
+    //the function is referenced during analysis
+    std::vector<token::Token> unparsed_body;
     FunctionDef(token::Token tok, type::FuncType type, std::vector<std::unique_ptr<VarDecl>> param_decls, 
         std::unique_ptr<CompoundStmt> body, std::vector<std::unique_ptr<TypeDecl>> tags) : 
         ExtDecl(std::move(tags)), FunctionDecl(tok, type), params(std::move(param_decls)), function_body(std::move(body)) {}
+    FunctionDef(token::Token tok, type::FuncType type, std::vector<std::unique_ptr<VarDecl>> param_decls, 
+        std::vector<token::Token> body_tokens, std::vector<std::unique_ptr<TypeDecl>> tags) : 
+        ExtDecl(std::move(tags)), FunctionDecl(tok, type), params(std::move(param_decls)), 
+        function_body(nullptr), unparsed_body(std::move(body_tokens)) {}
     void analyze(symbol::STable*) override;
+    void analyze_body(symbol::GlobalTable* global);
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct LabeledStmt : public Stmt{
@@ -270,7 +320,8 @@ struct LabeledStmt : public Stmt{
         : ident_tok(tok), stmt(std::move(stmt)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct GotoStmt : public Stmt{
@@ -278,21 +329,24 @@ struct GotoStmt : public Stmt{
     GotoStmt(token::Token tok) :ident_tok(tok) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct ContinueStmt : public Stmt{
     token::Token tok;
     ContinueStmt(token::Token tok) : tok(tok) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct BreakStmt : public Stmt{
     token::Token tok;
     BreakStmt(token::Token tok) : tok(tok) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct ReturnStmt : public Stmt{
     token::Token tok;
@@ -300,7 +354,8 @@ struct ReturnStmt : public Stmt{
     ReturnStmt(token::Token tok, std::optional<std::unique_ptr<Expr>> ret_expr) : tok(tok), return_expr(std::move(ret_expr)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct Conditional : public Expr{
@@ -311,15 +366,19 @@ struct Conditional : public Expr{
         Expr(op_tok), cond(std::move(cond)), true_expr(std::move(t)), false_expr(std::move(f)) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct Variable : public Expr{
     std::string variable_name;
+    //Declaration the name resolves to, set by analysis
+    symbol::SymbolId symbol_id = 0;
     Variable(token::Token tok) : Expr(tok), variable_name(tok.value) {}
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct StrLiteral : public Expr{
@@ -327,7 +386,8 @@ struct StrLiteral : public Expr{
     StrLiteral(std::vector<token::Token> toks);
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct Constant : public Expr{
@@ -335,7 +395,8 @@ struct Constant : public Expr{
     Constant(const token::Token& tok);
     void analyze(symbol::STable*) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct MemberAccess : public Expr{
@@ -345,7 +406,8 @@ struct MemberAccess : public Expr{
         Expr(tok), arg(std::move(argument)), index(std::move(index)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct ArrayAccess : public Expr{
     std::unique_ptr<Expr> arg;
@@ -354,7 +416,8 @@ struct ArrayAccess : public Expr{
         Expr(tok), arg(std::move(argument)), index(std::move(index)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct Alignof : public Expr{
@@ -363,7 +426,8 @@ struct Alignof : public Expr{
         Expr(tok), arg(std::move(arg)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct Sizeof : public Expr{
@@ -372,7 +436,8 @@ struct Sizeof : public Expr{
         Expr(tok), arg(std::move(arg)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct FuncCall : public Expr{
     std::unique_ptr<Expr> func;
@@ -381,7 +446,8 @@ struct FuncCall : public Expr{
         Expr(tok), func(std::move(func)), args(std::move(args)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct Postfix : public Expr{
     std::unique_ptr<Expr> arg;
@@ -389,7 +455,8 @@ struct Postfix : public Expr{
         Expr(op), arg(std::move(exp)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 struct UnaryOp : public Expr{
     std::unique_ptr<Expr> arg;
@@ -397,7 +464,8 @@ struct UnaryOp : public Expr{
         Expr(op), arg(std::move(exp)) {}
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 
 struct BinaryOp : public Expr{
@@ -409,7 +477,8 @@ struct BinaryOp : public Expr{
         Expr(op), left(std::move(left)), right(std::move(right)) { }
     void analyze(symbol::STable* st) override;
     void pretty_print(int depth) const override;
-    value::Value* codegen(std::ostream& output, context::Context& c) const override;
+    void serialize(serialize::Writer& w) const override;
+    value::Value* codegen(context::Context& c) const override;
 };
 bool is_lval(const ast::AST* node);
 
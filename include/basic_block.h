@@ -2,61 +2,212 @@
 #define _BASIC_BLOCK_
 #include "value.h"
 #include "type.h"
+#include "ir_writer.h"
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
 namespace basicblock{
+//Kind of block a label starts, which gives the prefix of its name in the IR
+enum class LabelKind : std::uint8_t{
+    FunctionEnter, LogicalNoSc, LogicalEnd, CondTrue, CondFalse, CondEnd, IfTrue, IfFalse, IfEnd,
+    DoControl, DoBody, DoEnd, WhileControl, WhileBody, WhileEnd, ForControl, ForBody, ForPost, ForEnd,
+    SwitchControl, SwitchEnd, Case, CaseDefault, AfterRet, AfterGoto, AfterBreak, AfterCont, User
+};
+//Labels are only formatted when they are printed
+class Label{
+    LabelKind kind;
+    int id;
+    long long int case_value;
+    //Name of a user label, interned by the context
+    const std::string* name;
+    Label(LabelKind kind, int id, long long int case_value, const std::string* name)
+        : kind(kind), id(id), case_value(case_value), name(name) {}
+public:
+    Label(LabelKind kind, int id) : Label(kind, id, 0, nullptr) {}
+    static Label switch_case(int switch_id, long long int case_value){
+        return Label(LabelKind::Case, switch_id, case_value, nullptr);
+    }
+    static Label user(const std::string* name){
+        return Label(LabelKind::User, 0, 0, name);
+    }
+    //Text before the id, which is the whole label for the function entry
+    static const char* prefix(LabelKind kind);
+    //Labels of one function are ordered by their parts, so they can be looked up without being formatted
+    friend bool operator<(const Label& a, const Label& b) noexcept{
+        return std::tie(a.kind, a.id, a.case_value, a.name) < std::tie(b.kind, b.id, b.case_value, b.name);
+    }
+    template<typename Output>
+    void print(Output& output) const{
+        output << prefix(kind);
+        switch(kind){
+            case LabelKind::FunctionEnter:
+                break;
+            case LabelKind::Case:
+                output << id << '.' << case_value;
+                break;
+            case LabelKind::CaseDefault:
+                output << id << ".default";
+                break;
+            case LabelKind::User:
+                output << *name << ".label";
+                break;
+            default:
+                output << id;
+        }
+    }
+};
+std::ostream& operator<<(std::ostream& output, const Label& label);
+ir_writer::Writer& operator<<(ir_writer::Writer& output, const Label& label);
+
+//One non-terminator instruction, with its operands held by value so that it
+//stays valid after the context releases the values it was built from
+class Instruction{
+public:
+    enum class Kind : std::uint8_t{
+        //result = alloca type
+        Alloca,
+        //result = load type, ptr operand
+        Load,
+        //store value, ptr address
+        Store,
+        //result = opcode type, ptr base, indices...
+        GetElementPtr,
+        //result = extractvalue type aggregate, index
+        ExtractValue,
+        //[result =] call type function(arguments...)
+        Call,
+        //result = opcode operand to result type
+        Cast,
+        //result = opcode type left, right
+        Binary
+    };
+private:
+    Kind kind;
+    //Text of the operation for casts, binary operations and element pointers, like "sext" or "icmp slt"
+    const char* opcode;
+    std::optional<value::Value> result;
+    type::CType type;
+    std::vector<value::Value> operands;
+public:
+    Instruction(Kind kind, const char* opcode, std::optional<value::Value> result, type::CType type, 
+        std::vector<value::Value> operands)
+        : kind(kind), opcode(opcode), result(std::move(result)), type(type), operands(std::move(operands)) {}
+    Kind get_kind() const noexcept{
+        return kind;
+    }
+    const char* get_opcode() const noexcept{
+        return opcode;
+    }
+    const std::optional<value::Value>& get_result() const noexcept{
+        return result;
+    }
+    const type::CType& get_type() const noexcept{
+        return type;
+    }
+    const std::vector<value::Value>& get_operands() const noexcept{
+        return operands;
+    }
+    void print(ir_writer::Writer& output) const;
+};
+
 class Terminator{
 public:
-    virtual std::string get_instruction() = 0;
+    virtual void print(ir_writer::Writer& output) const = 0;
     virtual ~Terminator() = 0;
 };
 class DefaultRet : public Terminator{
     type::CType type;
 public:
     DefaultRet(type::CType t) : type(t){}
-    std::string get_instruction() override;
+    const type::CType& get_type() const noexcept{
+        return type;
+    }
+    void print(ir_writer::Writer& output) const override;
 };
 
 class RET : public Terminator{
-    value::Value* ret_val;
+    std::optional<value::Value> ret_val;
 public:
-    RET(value::Value* v) : ret_val(v){}
-    std::string get_instruction() override;
+    //A null value returns void
+    RET(const value::Value* v);
+    const std::optional<value::Value>& get_value() const noexcept{
+        return ret_val;
+    }
+    void print(ir_writer::Writer& output) const override;
 };
 class Cond_BR : public Terminator{
-    value::Value* cond;
-    std::string t_label;
-    std::string f_label;
+    value::Value cond;
+    Label t_label;
+    Label f_label;
 public:
-    Cond_BR(value::Value* cond, std::string tl, std::string fl);
-    std::string get_instruction() override;
+    Cond_BR(const value::Value& cond, Label tl, Label fl);
+    const value::Value& get_condition() const noexcept{
+        return cond;
+    }
+    Label get_true_label() const noexcept{
+        return t_label;
+    }
+    Label get_false_label() const noexcept{
+        return f_label;
+    }
+    void print(ir_writer::Writer& output) const override;
 };
 
 class UCond_BR : public Terminator{
-    std::string label;
+    Label label;
+public:
+    UCond_BR(Label label) : label(label){}
+    Label get_label() const noexcept{
+        return label;
+    }
+    void print(ir_writer::Writer& output) const override;
+};
+class Switch : public Terminator{
+    value::Value control;
+    Label default_label;
+    std::vector<std::pair<long long int, Label>> cases;
 public:
-    UCond_BR(std::string label) : label(label){}
-    std::string get_instruction() override;
+    Switch(const value::Value& control, Label default_label, std::vector<std::pair<long long int, Label>> cases);
+    const value::Value& get_control() const noexcept{
+        return control;
+    }
+    Label get_default_label() const noexcept{
+        return default_label;
+    }
+    const std::vector<std::pair<long long int, Label>>& get_cases() const noexcept{
+        return cases;
+    }
+    void print(ir_writer::Writer& output) const override;
 };
 class Unreachable : public Terminator{
 public:
     Unreachable(){}
-    std::string get_instruction() override;
+    void print(ir_writer::Writer& output) const override;
 };
 
 class Block{
-    std::string label;
+    Label label;
+    std::vector<Instruction> instructions;
     std::unique_ptr<Terminator> t;
 public:
-    Block(std::string label) : label(label), t(nullptr) {}
-    Block(std::string label, std::unique_ptr<Terminator> default_terminator) 
+    Block(Label label) : label(label), t(nullptr) {}
+    Block(Label label, std::unique_ptr<Terminator> default_terminator)
         : label(label), t(std::move(default_terminator)){}
-    std::string get_label();
+    Label get_label() const;
+    void add_instruction(Instruction instruction);
+    const std::vector<Instruction>& get_instructions() const noexcept;
     bool has_terminator() const;
     void add_terminator(std::unique_ptr<Terminator> term);
-    void print_terminator(std::ostream& output) const;
+    const Terminator* get_terminator() const noexcept;
+    //Prints the label, the instructions and then the terminator
+    void print(ir_writer::Writer& output) const;
 };
 
 } //namespace basicblock
@@ -0,0 +1,12 @@
+#ifndef _BITCODE_WRITER_
+#define _BITCODE_WRITER_
+#include "ir_module.h"
+#include <ostream>
+namespace bitcode_writer{
+//Writes the module as LLVM bitcode without depending on LLVM, for the subset of IR that codegen generates
+//The bitcode matches the textual IR: opaque pointers, no datalayout, and noundef on every parameter and argument
+//Names are given by value symbol tables (module version 1), so no string table is needed
+//Throws std::runtime_error if the module contains something that cannot be encoded
+void write(const ir::Module& module, std::ostream& output);
+} //namespace bitcode_writer
+#endif
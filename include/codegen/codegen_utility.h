@@ -1,6 +1,7 @@
 #ifndef _CODEGEN_UTILITY_
 #define _CODEGEN_UTILITY_
 #include <iostream>
+#include <vector>
 #include "value.h"
 #include "type.h"
 #include "context.h"
@@ -9,19 +10,24 @@ namespace codegen_utility{
 template <class... Ts> struct overloaded : Ts...{using Ts::operator()...;};
 template<class...Ts> overloaded(Ts ...) -> overloaded<Ts...>;
 
-value::Value* convert(type::CType original_target_type, value::Value* val, 
-        std::ostream& output, context::Context& c);
+value::Value* convert(type::CType original_target_type, value::Value* val, context::Context& c);
 
-void print_whitespace(int, std::ostream&);
-value::Value* make_command(type::CType t, std::string command, value::Value* left, value::Value* right, 
-    std::ostream& output, context::Context& c);
+value::Value* make_command(type::CType t, const char* command, value::Value* left, value::Value* right,
+    context::Context& c);
 
-value::Value* make_load(value::Value* local, std::ostream& output, context::Context& c);
-value::Value* make_tmp_alloca(type::CType t, std::ostream& output, context::Context& c);
-void make_store(value::Value* val, value::Value* reg, std::ostream& output, context::Context& c);
+value::Value* make_load(value::Value* local, context::Context& c);
+value::Value* make_tmp_alloca(type::CType t, context::Context& c);
+void make_store(value::Value* val, value::Value* reg, context::Context& c);
+//Pointer to an element of the object of type source_type at base, selected by the indices
+value::Value* make_element_ptr(type::CType result_type, const char* command, type::CType source_type, value::Value* base,
+    const std::vector<value::Value>& indices, context::Context& c);
+value::Value* make_extract_value(type::CType result_type, value::Value* aggregate, int index, context::Context& c);
+//Returns nullptr for a void call
+value::Value* make_call(type::CType return_type, value::Value* function, const std::vector<value::Value*>& args,
+    context::Context& c);
 
 value::Value* bin_op_codegen(value::Value* left, value::Value* right, token::TokenType op_type, type::CType result_type,
-    std::ostream& output, context::Context& c);
+    context::Context& c);
 
 std::string default_value(type::CType type);
 
@@ -1,75 +1,182 @@
 #ifndef _CONTEXT_
 #define _CONTEXT_
 #include <string>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include "value.h"
 #include "basic_block.h"
+#include "ir_module.h"
 namespace context{
+class Context;
+//Values held by the context while a function was generated
+//Bytes count the value pool chunks and scopes
+struct FunctionStats{
+    std::string name;
+    std::size_t values = 0;
+    std::size_t peak_values = 0;
+    std::size_t peak_bytes = 0;
+};
+//A string literal whose global is named once every function has been generated,
+//so names follow the order strings are first used in the source whichever thread found them
+struct PendingString{
+    const std::string* literal;
+    value::Value* value;
+    //Holds the prefix of the name until it is named
+    std::string* name;
+};
+//State shared by every function of a translation unit
+//Function bodies are generated into contexts of their own, possibly in parallel,
+//so globals are registered under a lock and everything else is merged in source order
+class ModuleContext{
+    friend class Context;
+    struct FunctionBody{
+        //Index of the function in the module's globals, kept empty until it is generated
+        std::size_t slot;
+        std::function<void(Context&)> generate;
+        std::unique_ptr<Context> context;
+    };
+    //Number of threads generating function bodies (0 uses every core)
+    unsigned int threads;
+    std::mutex globals_mutex;
+    std::map<std::string, std::pair<std::unique_ptr<value::Value>,bool>> global_sym_map;
+    //Named string literals, each owned by the context which first used it
+    std::map<std::string, value::Value*> string_map;
+    //Strings in the order they were first used by each function or run of external declarations
+    std::deque<std::vector<PendingString>> string_batches;
+    std::vector<FunctionBody> functions;
+    std::vector<FunctionStats> function_stats;
+    ir::Module ir_module;
+    //Tags of the program being generated, set by Program::codegen
+    const type::TypeContext* type_context = nullptr;
+    explicit ModuleContext(unsigned int threads) : threads(threads) {}
+public:
+    ~ModuleContext();
+};
+//Generates either a function body or the external declarations of a translation unit into its module
 class Context{
+public:
+    using FunctionStats = context::FunctionStats;
+private:
     struct Scope{
         int current_depth;
         Scope* parent;
-        std::vector<std::unique_ptr<Scope>> children;
-        std::map<std::string, std::unique_ptr<value::Value>> sym_map;
-        std::vector<std::unique_ptr<value::Value>> tmp_map;
+        //Only the innermost scope is open, and a scope is freed as soon as it is exited
+        std::unique_ptr<Scope> child;
+        //Sizes of the function's value pools when the scope was entered,
+        //so exiting the scope releases its locals and temporaries
+        std::size_t locals_mark = 0;
+        std::size_t temps_mark = 0;
         Scope(Scope* p) : parent(p) {
             assert(p && "Tried to create scope with null parent");
             current_depth = p->current_depth + 1;
         }
         Scope* new_child(){
-            auto child = Scope(this);
-            children.push_back(std::make_unique<Scope>(std::move(child)));
-            return children.back().get();
+            child = std::make_unique<Scope>(this);
+            return child.get();
         }
         protected:
             Scope() : parent(nullptr), current_depth(0){}
     };
     struct FunctionScope : public Scope{
-        FunctionScope(std::string name, type::CType t) : Scope(), function_name(name), ret_type(t),total_locals(0), instructions(0){
+        FunctionScope(std::string name, value::Value function_value, type::CType t) 
+            : Scope(), function_name(name), function(function_value, t), ret_type(t),total_locals(0), instructions(0){
             current_depth = 1;
         }
         std::string function_name;
+        //Code of the function, which is added to the module once the function is finished
+        ir::Function function;
         type::CType ret_type;
         int total_locals;
         int instructions;
+        //Locals are found through their symbol id, so the pool only needs to own them
+        value::ValuePool locals;
+        value::ValuePool temps;
+        std::size_t live_scopes = 1;
+        FunctionStats stats;
     };
+    //Set for the context of the external declarations, which owns the module
+    std::unique_ptr<ModuleContext> owned_module;
+    ModuleContext& module_context;
+    //Context of the external declarations, for the function contexts
+    const Context* parent;
+    //Names of locals, strings and literals, so every value with the same name points at one copy
+    std::unordered_set<std::string> names;
     std::map<std::string, std::unique_ptr<value::Value>> literal_map;
     std::map<std::string, std::unique_ptr<value::Value>> string_map;
-    std::map<std::string, std::pair<std::unique_ptr<value::Value>,bool>> global_sym_map;
-    std::vector<value::Value> duplicates;
+    std::deque<std::string> string_names;
+    std::vector<PendingString>* pending_strings;
+    //Value of each symbol declared by this context, indexed by the symbol id given to it
+    //during analysis less the first id; function contexts look other symbols up in their parent
+    std::size_t first_symbol;
+    std::vector<value::Value*> symbol_values;
+    //Pointer casts made outside of a function
+    value::ValuePool global_casts;
     std::unique_ptr<FunctionScope> current_function;
     Scope* current_scope;
-    std::unique_ptr<basicblock::Block> current_block;
-    void enter_block(std::string block_label, std::ostream& output);
-    void exit_block(std::ostream& output, std::unique_ptr<basicblock::Terminator> t);
+    //Block of the current function that instructions are added to
+    basicblock::Block* current_block;
+    //The function, once it has been exited
+    std::optional<ir::Function> finished_function;
+    FunctionStats finished_stats;
+    Context(ModuleContext& module_context, const Context& parent, std::vector<PendingString>& strings);
+    void enter_block(basicblock::Label block_label);
+    void exit_block(std::unique_ptr<basicblock::Terminator> t);
+    void bind_symbol(std::size_t symbol_id, value::Value* v);
+    void update_stats();
 public:
-    Context();
+    //Function bodies are generated by the given number of threads (0 uses every core)
+    explicit Context(unsigned int threads = 1);
+    ~Context();
+    void set_types(const type::TypeContext& types) noexcept;
+    const type::TypeContext& types() const noexcept;
     value::Value* prev_temp(int i) const;
     value::Value* new_temp(type::CType t);
     int new_local_name();
+    const std::string* intern_name(const std::string& name);
     value::Value* add_literal(std::string literal, type::CType type);
-    value::Value* add_global(std::string name, type::CType type, bool defined = false);
-    value::Value* add_local(std::string name, type::CType type);
+    //A literal value owned by the caller, with exactly the given type
+    value::Value make_literal(std::string literal, type::CType type);
+    value::Value* add_global(std::string name, type::CType type, std::size_t symbol_id, bool defined = false);
+    value::Value* add_local(std::string name, type::CType type, std::size_t symbol_id);
     value::Value* add_string(std::string s, type::CType type);
     value::Value* ptr_cast(value::Value* v, type::PointerType type);
     std::vector<std::pair<value::Value*,std::string>> undefined_strings() const;
     std::vector<value::Value*> undefined_globals() const;
-    bool has_symbol(std::string name) const;
-    value::Value* get_value(std::string name) const;
+    value::Value* get_value(std::size_t symbol_id) const;
     void enter_scope();
     void exit_scope();
-    void enter_function(std::string name, type::CType t, const std::vector<type::CType>& params, std::ostream& output);
-    void exit_function(std::ostream& output, std::unique_ptr<basicblock::Terminator> t = nullptr);
+    //Temporaries are only used by the statement that creates them, so each statement
+    //releases the ones made after its mark once its code is generated
+    std::size_t temp_mark() const;
+    void release_temps(std::size_t mark);
+    //One entry per function generated so far, in order
+    const std::vector<FunctionStats>& stats() const noexcept;
+    //Code generated so far, with each function added once every function has been generated
+    ir::Module& module() noexcept;
+    //Reserves the function's place in the module, after the globals generated so far
+    //Its body is generated by generate_functions into a context of its own
+    void add_function(std::function<void(Context&)> generate);
+    //Generates the bodies of the added functions, in parallel if the context was given more than one thread,
+    //then adds them to the module and names the string literals in source order, so the module
+    //is the same however many threads are used
+    //Rethrows the first exception in source order if any body could not be generated
+    void generate_functions();
+    void add_instruction(basicblock::Instruction instruction);
+    void enter_function(std::string name, const value::Value& function, type::CType t, const std::vector<type::CType>& params);
+    void exit_function(std::unique_ptr<basicblock::Terminator> t = nullptr);
     bool in_function() const;
     int depth() const;
     type::CType return_type() const;
-    void change_block(std::string block_label, std::ostream& output, 
-        std::unique_ptr<basicblock::Terminator> old_terminator);
-    std::vector<std::string> continue_targets;
-    std::vector<std::string> break_targets;
+    void change_block(basicblock::Label block_label, std::unique_ptr<basicblock::Terminator> old_terminator);
+    std::vector<basicblock::Label> continue_targets;
+    std::vector<basicblock::Label> break_targets;
     std::vector<int> switch_numbers;
 };
 } //namespace context
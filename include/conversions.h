@@ -0,0 +1,220 @@
+#ifndef _CONVERSIONS_
+#define _CONVERSIONS_
+#include "type.h"
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <variant>
+namespace conversions{
+//Properties of the arithmetic types and the results of converting between them, shared by
+//semantic analysis and codegen
+//Built at compile time and indexed directly by IType/FType, so nothing is recomputed per expression
+
+constexpr std::size_t int_type_count = static_cast<std::size_t>(type::IType::Bool) + 1;
+constexpr std::size_t float_type_count = static_cast<std::size_t>(type::FType::LDouble) + 1;
+constexpr std::size_t basic_type_count = int_type_count + float_type_count;
+
+//Integer types are indexed first, followed by the floating types
+constexpr std::size_t index(type::IType t){
+    return static_cast<std::size_t>(t);
+}
+constexpr std::size_t index(type::FType t){
+    return int_type_count + static_cast<std::size_t>(t);
+}
+constexpr std::size_t index(const type::BasicType& t){
+    if(auto i = std::get_if<type::IType>(&t)){
+        return index(*i);
+    }
+    return index(*std::get_if<type::FType>(&t));
+}
+constexpr type::BasicType basic_type(std::size_t i){
+    if(i < int_type_count){
+        return type::BasicType(std::in_place_index<0>, static_cast<type::IType>(i));
+    }
+    return type::BasicType(std::in_place_index<1>, static_cast<type::FType>(i - int_type_count));
+}
+
+struct IntProperties{
+    int rank = 0;
+    int bits = 0;
+    bool is_signed = false;
+    unsigned long long max_value = 0;
+    type::IType unsigned_type = type::IType::Bool;
+    //Next type of higher rank with the same signedness, or the type itself at the highest rank
+    type::IType next_rank = type::IType::Bool;
+};
+struct FloatProperties{
+    int rank = 0;
+    //We cheat and make long double the same as double, since other long doubles are target dependent
+    int bits = 0;
+    type::FType next_rank = type::FType::LDouble;
+};
+
+namespace detail{
+constexpr std::array<IntProperties, int_type_count> make_int_properties(){
+    using type::IType;
+    auto table = std::array<IntProperties, int_type_count>{};
+    auto set = [&table](IType t, IntProperties p){
+        table[index(t)] = p;
+    };
+    constexpr int char_bits = std::numeric_limits<unsigned char>::digits;
+    constexpr int short_bits = std::numeric_limits<unsigned short int>::digits;
+    constexpr int int_bits = std::numeric_limits<unsigned int>::digits;
+    constexpr int long_bits = std::numeric_limits<unsigned long>::digits;
+    constexpr int llong_bits = std::numeric_limits<unsigned long long>::digits;
+    set(IType::Bool, IntProperties{0, 1, false, 1ull, IType::Bool, IType::UChar});
+    //Char is signed by default
+    set(IType::Char, IntProperties{1, char_bits, true, CHAR_MAX, IType::UChar, IType::Short});
+    set(IType::SChar, IntProperties{1, char_bits, true, SCHAR_MAX, IType::UChar, IType::Short});
+    set(IType::UChar, IntProperties{1, char_bits, false, UCHAR_MAX, IType::UChar, IType::UShort});
+    set(IType::Short, IntProperties{2, short_bits, true, SHRT_MAX, IType::UShort, IType::Int});
+    set(IType::UShort, IntProperties{2, short_bits, false, USHRT_MAX, IType::UShort, IType::UInt});
+    set(IType::Int, IntProperties{3, int_bits, true, INT_MAX, IType::UInt, IType::Long});
+    set(IType::UInt, IntProperties{3, int_bits, false, UINT_MAX, IType::UInt, IType::ULong});
+    set(IType::Long, IntProperties{4, long_bits, true, LONG_MAX, IType::ULong, IType::LLong});
+    set(IType::ULong, IntProperties{4, long_bits, false, ULONG_MAX, IType::ULong, IType::ULLong});
+    set(IType::LLong, IntProperties{5, llong_bits, true, LLONG_MAX, IType::ULLong, IType::LLong});
+    set(IType::ULLong, IntProperties{5, llong_bits, false, ULLONG_MAX, IType::ULLong, IType::ULLong});
+    return table;
+}
+constexpr std::array<FloatProperties, float_type_count> make_float_properties(){
+    using type::FType;
+    auto table = std::array<FloatProperties, float_type_count>{};
+    table[static_cast<std::size_t>(FType::Float)] = FloatProperties{0, 32, FType::Double};
+    table[static_cast<std::size_t>(FType::Double)] = FloatProperties{1, 64, FType::LDouble};
+    table[static_cast<std::size_t>(FType::LDouble)] = FloatProperties{2, 64, FType::LDouble};
+    return table;
+}
+}//namespace detail
+
+inline constexpr std::array<IntProperties, int_type_count> int_properties = detail::make_int_properties();
+inline constexpr std::array<FloatProperties, float_type_count> float_properties = detail::make_float_properties();
+
+constexpr const IntProperties& properties(type::IType t){
+    return int_properties[index(t)];
+}
+constexpr const FloatProperties& properties(type::FType t){
+    return float_properties[static_cast<std::size_t>(t)];
+}
+constexpr bool can_represent(type::IType target, unsigned long long value){
+    return value <= properties(target).max_value;
+}
+constexpr bool can_represent(type::IType target, type::IType source){
+    return conversions::can_represent(target, properties(source).max_value);
+}
+constexpr bool can_represent(type::FType target, type::FType source){
+    return properties(target).bits >= properties(source).bits;
+}
+constexpr type::IType integer_promotion(type::IType t){
+    if(properties(t).rank > properties(type::IType::Int).rank){
+        return t;
+    }
+    return conversions::can_represent(type::IType::Int, t) ? type::IType::Int : type::IType::UInt;
+}
+
+namespace detail{
+constexpr type::IType usual_int_conversion(type::IType t1, type::IType t2){
+    t1 = integer_promotion(t1);
+    t2 = integer_promotion(t2);
+    if(t1 == t2){
+        return t1;
+    }
+    const auto& p1 = properties(t1);
+    const auto& p2 = properties(t2);
+    if(p1.is_signed == p2.is_signed){
+        return p1.rank < p2.rank ? t2 : t1;
+    }
+    if(p1.is_signed && p1.rank <= p2.rank){
+        return t2;
+    }
+    if(p2.is_signed && p2.rank <= p1.rank){
+        return t1;
+    }
+    if(p1.is_signed){
+        return conversions::can_represent(t1, t2) ? t1 : p1.unsigned_type;
+    }
+    return conversions::can_represent(t2, t1) ? t2 : p2.unsigned_type;
+}
+constexpr std::size_t usual_conversion(std::size_t i, std::size_t j){
+    if(i >= int_type_count || j >= int_type_count){
+        //The floating types are indexed by rank, and any float outranks every integer
+        return i > j ? i : j;
+    }
+    return index(usual_int_conversion(static_cast<type::IType>(i), static_cast<type::IType>(j)));
+}
+constexpr std::array<std::array<std::uint8_t, basic_type_count>, basic_type_count> make_usual_conversions(){
+    auto table = std::array<std::array<std::uint8_t, basic_type_count>, basic_type_count>{};
+    for(std::size_t i = 0; i < basic_type_count; i++){
+        for(std::size_t j = 0; j < basic_type_count; j++){
+            table[i][j] = static_cast<std::uint8_t>(usual_conversion(i, j));
+        }
+    }
+    return table;
+}
+
+//LLVM instruction converting a value of the source type to the target type
+//nullptr if the two have the same IR type, so no instruction is needed
+constexpr const char* conversion_opcode(std::size_t target, std::size_t source){
+    bool int_target = target < int_type_count;
+    bool int_source = source < int_type_count;
+    if(target == index(type::IType::Bool)){
+        //Conversion to _Bool is a comparison against zero rather than a truncation
+        return int_source ? "icmp ne" : "fcmp une";
+    }
+    if(int_target && int_source){
+        auto t = static_cast<type::IType>(target);
+        auto s = static_cast<type::IType>(source);
+        if(properties(t).bits == properties(s).bits){
+            return nullptr;
+        }
+        if(conversions::can_represent(t, s)){
+            return properties(s).is_signed ? "sext" : "zext";
+        }
+        return "trunc";
+    }
+    if(int_target){
+        //IF IT CAN'T FIT, POTENTIAL SOURCE OF Undefined Behavior!!!!!!!!!
+        return properties(static_cast<type::IType>(target)).is_signed ? "fptosi" : "fptoui";
+    }
+    if(int_source){
+        return properties(static_cast<type::IType>(source)).is_signed ? "sitofp" : "uitofp";
+    }
+    auto t = static_cast<type::FType>(target - int_type_count);
+    auto s = static_cast<type::FType>(source - int_type_count);
+    if(properties(t).bits == properties(s).bits){
+        return nullptr;
+    }
+    return conversions::can_represent(t, s) ? "fpext" : "fptrunc";
+}
+constexpr std::array<std::array<const char*, basic_type_count>, basic_type_count> make_conversion_opcodes(){
+    auto table = std::array<std::array<const char*, basic_type_count>, basic_type_count>{};
+    for(std::size_t i = 0; i < basic_type_count; i++){
+        for(std::size_t j = 0; j < basic_type_count; j++){
+            table[i][j] = conversion_opcode(i, j);
+        }
+    }
+    return table;
+}
+}//namespace detail
+
+inline constexpr auto usual_conversions = detail::make_usual_conversions();
+inline constexpr auto conversion_opcodes = detail::make_conversion_opcodes();
+
+constexpr type::BasicType usual_arithmetic_conversion(const type::BasicType& t1, const type::BasicType& t2){
+    return basic_type(usual_conversions[index(t1)][index(t2)]);
+}
+constexpr const char* conversion_opcode(const type::BasicType& target, const type::BasicType& source){
+    return conversion_opcodes[index(target)][index(source)];
+}
+
+static_assert(usual_conversions[index(type::IType::Char)][index(type::IType::Short)] == index(type::IType::Int));
+static_assert(usual_conversions[index(type::IType::Long)][index(type::IType::UInt)] == index(type::IType::Long));
+static_assert(usual_conversions[index(type::IType::Int)][index(type::IType::UInt)] == index(type::IType::UInt));
+static_assert(usual_conversions[index(type::IType::ULLong)][index(type::FType::Float)] == index(type::FType::Float));
+static_assert(conversion_opcodes[index(type::IType::Int)][index(type::IType::Char)][0] == 's');
+static_assert(conversion_opcodes[index(type::IType::UInt)][index(type::IType::Int)] == nullptr);
+static_assert(conversion_opcodes[index(type::FType::LDouble)][index(type::FType::Double)] == nullptr);
+}//namespace conversions
+#endif
@@ -0,0 +1,111 @@
+#ifndef _IR_MODULE_
+#define _IR_MODULE_
+#include "basic_block.h"
+#include "ir_writer.h"
+#include "type.h"
+#include "value.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+namespace ir{
+//Generated code for a translation unit, kept in memory until it is printed
+//Values refer to names interned by the context that generated them, so a module
+//must not outlive its context
+
+//A constant as generated by codegen, kept in parts so that backends which do not print
+//text can lower it; the types of aggregate elements are not kept since they follow from the constant's type
+struct Constant{
+    enum class Kind{
+        //null, zeroinitializer or the zero of a number
+        Zero,
+        //Integer, held in integer
+        Integer,
+        //Floating point number, held in floating as a double since that is how the IR writes it
+        Float,
+        //c"..." string, with text holding its bytes
+        String,
+        //[ ... ] or { ... }, where a union is a struct holding its largest member, or for a union initialized through
+        //a smaller member, the member followed by padding (see GlobalVariable::storage_type)
+        Aggregate
+    };
+    Kind kind;
+    long long integer = 0;
+    double floating = 0;
+    std::string text;
+    std::vector<Constant> elements;
+    static Constant zero(){
+        return Constant{Kind::Zero};
+    }
+    static Constant of_integer(long long value){
+        auto c = Constant{Kind::Integer};
+        c.integer = value;
+        return c;
+    }
+    static Constant of_float(double value){
+        auto c = Constant{Kind::Float};
+        c.floating = value;
+        return c;
+    }
+    static Constant of_string(std::string bytes){
+        auto c = Constant{Kind::String};
+        c.text = std::move(bytes);
+        return c;
+    }
+    static Constant aggregate(std::vector<Constant> elements){
+        auto c = Constant{Kind::Aggregate};
+        c.elements = std::move(elements);
+        return c;
+    }
+};
+//Reads a literal from the text of a value, throwing std::runtime_error if the literal is malformed
+Constant parse_constant(std::string_view literal);
+//Whether the constant is a zero, null or zeroinitializer
+bool is_zero(const Constant& constant);
+//Appends the constant as a literal of the given type, which parse_constant reads back
+//Aggregates are the type's array, struct or union, with their elements written in order,
+//and the members of structs and unions are looked up by tag in the context if one is given
+void format_constant(const Constant& constant, const type::CType& type, const type::TypeContext* types, std::string& output);
+
+//@name = dso_local global type initializer[, align n]
+struct GlobalVariable{
+    value::Value value;
+    Constant initializer;
+    //Type of the initializer if it is not the global's own, as for a union initialized through a member smaller
+    //than its largest, which like clang is stored as a literal struct of that member and its padding
+    std::optional<type::CType> storage_type = std::nullopt;
+    //Alignment in bytes if the storage type may be less aligned than the global's own type, and 0 otherwise
+    long long align = 0;
+};
+//@name = private unnamed_addr constant, for a string literal
+struct StringConstant{
+    value::Value value;
+    std::string literal;
+};
+//declare type @name(params)
+struct FunctionDeclaration{
+    value::Value value;
+};
+struct Function{
+    value::Value value;
+    type::CType return_type;
+    std::vector<value::Value> params;
+    //Blocks in the order they are printed, the first being the entry block
+    std::vector<std::unique_ptr<basicblock::Block>> blocks;
+    Function(value::Value value, type::CType return_type) : value(value), return_type(return_type) {}
+};
+using Global = std::variant<GlobalVariable, StringConstant, FunctionDeclaration, Function>;
+
+struct Module{
+    //Tags whose types are declared at the top of the module
+    const type::TypeContext* types = nullptr;
+    //Globals in the order they were generated, which is the order they are printed
+    std::vector<Global> globals;
+};
+
+void print(const Module& module, ir_writer::Writer& output);
+void print(const Function& function, ir_writer::Writer& output);
+} //namespace ir
+#endif
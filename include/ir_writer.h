@@ -0,0 +1,81 @@
+#ifndef _IR_WRITER_
+#define _IR_WRITER_
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+namespace ir_writer{
+//Sink for generated IR text
+//Text is appended to a fixed buffer, which is handed to the output stream in a single write
+//whenever it fills and once more when the writer is flushed, so the stream is never flushed per line
+class Writer{
+    static constexpr std::size_t buffer_size = std::size_t{1} << 20;
+    //Longest decimal integer, including the sign
+    static constexpr std::size_t max_integer_length = 24;
+    std::ostream& output;
+    std::unique_ptr<char[]> buffer;
+    std::size_t used = 0;
+public:
+    explicit Writer(std::ostream& output) : output(output), buffer(std::make_unique<char[]>(buffer_size)) {}
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer(){
+        flush();
+    }
+    void write(const char* data, std::size_t length){
+        if(length > buffer_size - used){
+            flush();
+            if(length > buffer_size){
+                output.write(data, length);
+                return;
+            }
+        }
+        std::memcpy(buffer.get() + used, data, length);
+        used += length;
+    }
+    //Hands the buffered text to the output stream, without flushing the stream itself
+    void flush(){
+        if(used > 0){
+            output.write(buffer.get(), used);
+            used = 0;
+        }
+    }
+    //Bytes written that have not been handed to the output stream yet
+    std::size_t buffered() const noexcept{
+        return used;
+    }
+
+    Writer& operator<<(std::string_view s){
+        write(s.data(), s.size());
+        return *this;
+    }
+    Writer& operator<<(const char* s){
+        return *this << std::string_view(s);
+    }
+    Writer& operator<<(const std::string& s){
+        return *this << std::string_view(s);
+    }
+    Writer& operator<<(char c){
+        if(used == buffer_size){
+            flush();
+        }
+        buffer[used++] = c;
+        return *this;
+    }
+    template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>, int> = 0>
+    Writer& operator<<(T value){
+        if(buffer_size - used < max_integer_length){
+            flush();
+        }
+        auto result = std::to_chars(buffer.get() + used, buffer.get() + buffer_size, value);
+        assert(result.ec == std::errc() && "Integer did not fit in IR buffer");
+        used = result.ptr - buffer.get();
+        return *this;
+    }
+};
+} //namespace ir_writer
+#endif
@@ -14,11 +14,14 @@ namespace lexer{
 class Tokenizer;
 class Preprocessor;
 class Lexer : public TokenStream{
-    std::unique_ptr<Tokenizer> tokenizer;
+    std::unique_ptr<TokenStream> source;
     std::unique_ptr<Preprocessor> preprocessor;
     token::Token read_token_from_stream() override;
 public:
     Lexer(std::istream& input);
+    //Preprocesses tokens already read by a Tokenizer (ending with its END token),
+    //so that tokenizing can be done, and timed, on its own
+    explicit Lexer(std::vector<token::Token> tokenized);
     ~Lexer();
 };
 
@@ -0,0 +1,19 @@
+#ifndef _LLVM_BACKEND_
+#define _LLVM_BACKEND_
+#include "ir_module.h"
+#include <memory>
+#include <string>
+namespace llvm{
+class LLVMContext;
+class Module;
+} //namespace llvm
+namespace llvm_backend{
+//Alternative to printing the module as text, which builds it directly with LLVM's IRBuilder
+//so that neither we nor LLVM has to go through textual IR
+//The module uses opaque pointers, which are enabled on the LLVM context for LLVM 14
+//Throws std::runtime_error if the module contains something that cannot be lowered
+std::unique_ptr<llvm::Module> build_module(const ir::Module& module, llvm::LLVMContext& context);
+//Writes the module as bitcode, which clang accepts in place of a .ll file
+void write_bitcode(const llvm::Module& module, const std::string& path);
+} //namespace llvm_backend
+#endif
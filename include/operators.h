@@ -0,0 +1,120 @@
+#ifndef _OPERATORS_
+#define _OPERATORS_
+#include "token.h"
+#include <array>
+#include <cstddef>
+namespace operators{
+//Properties of binary operators, shared by the parser, semantic analysis and codegen
+//Built at compile time and indexed directly by token type
+
+enum class Kind{
+    None, Multiplicative, Additive, Shift, Relational, Equality, Bitwise, Logical, Assignment, Comma
+};
+enum class Associativity{
+    Left, Right
+};
+
+struct BinaryOperator{
+    Kind kind = Kind::None;
+    int precedence = 0;
+    Associativity associativity = Associativity::Left;
+    //Operator applied by a compound assignment, or Assign for simple assignment
+    token::TokenType compound_base = token::TokenType::END;
+    //LLVM instructions for signed integer, unsigned integer, floating point and pointer operands
+    //nullptr where the operation is not defined for that kind of operand
+    const char* signed_op = nullptr;
+    const char* unsigned_op = nullptr;
+    const char* float_op = nullptr;
+    const char* pointer_op = nullptr;
+
+    constexpr bool is_binary() const{
+        return kind != Kind::None;
+    }
+    constexpr bool is_assignment() const{
+        return kind == Kind::Assignment;
+    }
+    constexpr bool is_compound_assignment() const{
+        return kind == Kind::Assignment && compound_base != token::TokenType::Assign;
+    }
+    constexpr bool is_comparison() const{
+        return kind == Kind::Relational || kind == Kind::Equality;
+    }
+    //left binding is less than right binding for left associativity (+, -)
+    //and vice versa for right associativity
+    constexpr int left_binding_power() const{
+        return associativity == Associativity::Left ? precedence : precedence + 1;
+    }
+    constexpr int right_binding_power() const{
+        return associativity == Associativity::Left ? precedence + 1 : precedence;
+    }
+};
+
+constexpr std::size_t token_type_count = static_cast<std::size_t>(token::TokenType::NEWLINE) + 1;
+
+namespace detail{
+constexpr BinaryOperator arithmetic(Kind kind, int precedence, const char* signed_op, const char* unsigned_op,
+        const char* float_op = nullptr, const char* pointer_op = nullptr){
+    return BinaryOperator{kind, precedence, Associativity::Left, token::TokenType::END, signed_op, unsigned_op, float_op, pointer_op};
+}
+constexpr BinaryOperator comparison(Kind kind, const char* signed_op, const char* unsigned_op, const char* float_op){
+    //Pointers are compared as signed integers
+    return arithmetic(kind, kind == Kind::Equality ? 17 : 19, signed_op, unsigned_op, float_op, signed_op);
+}
+constexpr BinaryOperator assignment(token::TokenType base){
+    return BinaryOperator{Kind::Assignment, 4, Associativity::Right, base};
+}
+
+constexpr std::array<BinaryOperator, token_type_count> make_binary_operators(){
+    using token::TokenType;
+    auto table = std::array<BinaryOperator, token_type_count>{};
+    auto set = [&table](TokenType type, BinaryOperator op){
+        table[static_cast<std::size_t>(type)] = op;
+    };
+    set(TokenType::Star, arithmetic(Kind::Multiplicative, 25, "mul", "mul", "fmul"));
+    set(TokenType::Div, arithmetic(Kind::Multiplicative, 25, "sdiv", "udiv", "fdiv"));
+    set(TokenType::Mod, arithmetic(Kind::Multiplicative, 25, "srem", "urem"));
+    set(TokenType::Plus, arithmetic(Kind::Additive, 23, "add", "add", "fadd", "getelementptr inbounds"));
+    set(TokenType::Minus, arithmetic(Kind::Additive, 23, "sub", "sub", "fsub", "sub"));
+    set(TokenType::LShift, arithmetic(Kind::Shift, 21, "shl", "shl"));
+    //Right shifting a negative signed number is UB, so it doesn't matter if we lshr or ashr
+    set(TokenType::RShift, arithmetic(Kind::Shift, 21, "lshr", "lshr"));
+    set(TokenType::Less, comparison(Kind::Relational, "icmp slt", "icmp ult", "fcmp olt"));
+    set(TokenType::Greater, comparison(Kind::Relational, "icmp sgt", "icmp ugt", "fcmp ogt"));
+    set(TokenType::LEq, comparison(Kind::Relational, "icmp sle", "icmp ule", "fcmp ole"));
+    set(TokenType::GEq, comparison(Kind::Relational, "icmp sge", "icmp uge", "fcmp oge"));
+    set(TokenType::Equal, comparison(Kind::Equality, "icmp eq", "icmp eq", "fcmp oeq"));
+    set(TokenType::NEqual, comparison(Kind::Equality, "icmp ne", "icmp ne", "fcmp one"));
+    set(TokenType::Amp, arithmetic(Kind::Bitwise, 15, "and", "and"));
+    set(TokenType::BitwiseXor, arithmetic(Kind::Bitwise, 13, "xor", "xor"));
+    set(TokenType::BitwiseOr, arithmetic(Kind::Bitwise, 11, "or", "or"));
+    set(TokenType::And, arithmetic(Kind::Logical, 9, nullptr, nullptr));
+    set(TokenType::Or, arithmetic(Kind::Logical, 7, nullptr, nullptr));
+    set(TokenType::Assign, assignment(TokenType::Assign));
+    set(TokenType::PlusAssign, assignment(TokenType::Plus));
+    set(TokenType::MinusAssign, assignment(TokenType::Minus));
+    set(TokenType::MultAssign, assignment(TokenType::Star));
+    set(TokenType::DivAssign, assignment(TokenType::Div));
+    set(TokenType::ModAssign, assignment(TokenType::Mod));
+    set(TokenType::LSAssign, assignment(TokenType::LShift));
+    set(TokenType::RSAssign, assignment(TokenType::RShift));
+    set(TokenType::BAAssign, assignment(TokenType::Amp));
+    set(TokenType::BOAssign, assignment(TokenType::BitwiseOr));
+    set(TokenType::BXAssign, assignment(TokenType::BitwiseXor));
+    set(TokenType::Comma, arithmetic(Kind::Comma, 1, nullptr, nullptr));
+    return table;
+}
+}//namespace detail
+
+inline constexpr std::array<BinaryOperator, token_type_count> binary_operators = detail::make_binary_operators();
+
+//Entry for a token type; kind is None if the token is not a binary operator
+constexpr const BinaryOperator& binary_operator(token::TokenType type){
+    return binary_operators[static_cast<std::size_t>(type)];
+}
+
+static_assert(binary_operator(token::TokenType::Star).left_binding_power() > binary_operator(token::TokenType::Plus).right_binding_power());
+static_assert(binary_operator(token::TokenType::Assign).left_binding_power() > binary_operator(token::TokenType::Assign).right_binding_power());
+static_assert(binary_operator(token::TokenType::PlusAssign).compound_base == token::TokenType::Plus);
+static_assert(!binary_operator(token::TokenType::Question).is_binary());
+}//namespace operators
+#endif
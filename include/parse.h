@@ -6,9 +6,19 @@
 namespace parse{
 typedef std::pair<std::optional<token::Token>, type::CType> Declarator;
 
+struct ParseOptions{
+    //Only record the tokens of static function bodies, leaving them
+    //to be parsed during analysis once the function is referenced
+    bool lazy_function_bodies = false;
+    //Number of threads parsing function bodies, which are split off from the
+    //external declarations by brace matching when this is not 1 (0 uses every core)
+    unsigned int parse_threads = 1;
+};
+
 //in parse.cpp
 void check_token_type(const token::Token& tok, token::TokenType type);
-std::unique_ptr<ast::Program> construct_ast(lexer::TokenStream& l);
+std::unique_ptr<ast::Program> construct_ast(lexer::TokenStream& l, const ParseOptions& options = ParseOptions());
+std::vector<token::Token> collect_braced_tokens(lexer::TokenStream& l);
 std::unique_ptr<ast::BlockItem> parse_block_item(lexer::TokenStream& l);
 std::unique_ptr<ast::AmbiguousBlock> parse_ambiguous_block(lexer::TokenStream& l);
 
@@ -29,8 +39,13 @@ std::pair<type::CType,std::vector<std::unique_ptr<ast::TypeDecl>>> parse_specifi
 //In parse_decl.cpp
 Declarator parse_declarator(type::CType type, lexer::TokenStream& l);
 std::pair<std::vector<Declarator>,bool> parse_param_list(lexer::TokenStream& l);
-std::unique_ptr<ast::FunctionDef> parse_function_def(lexer::TokenStream& l, std::pair<std::vector<Declarator>,bool> params, Declarator function_type);
+//When construct_ast parses function bodies in parallel, it passes the list of definitions whose bodies it parses itself,
+//and definitions are added to it with their bodies only brace matched
+std::unique_ptr<ast::FunctionDef> parse_function_def(lexer::TokenStream& l, std::vector<Declarator> params, 
+    Declarator func, std::vector<std::unique_ptr<ast::TypeDecl>> tags, const ParseOptions& options = ParseOptions(),
+    std::vector<ast::FunctionDef*>* unparsed_definitions = nullptr);
 std::unique_ptr<ast::DeclList> parse_decl_list(lexer::TokenStream& l);
-std::unique_ptr<ast::ExtDecl> parse_ext_decl(lexer::TokenStream& l);
+std::unique_ptr<ast::ExtDecl> parse_ext_decl(lexer::TokenStream& l, const ParseOptions& options = ParseOptions(),
+    std::vector<ast::FunctionDef*>* unparsed_definitions = nullptr);
 } //namespace parse
 #endif
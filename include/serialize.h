@@ -0,0 +1,94 @@
+#ifndef _SERIALIZE_
+#define _SERIALIZE_
+#include "ast.h"
+#include "token.h"
+#include "type.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+namespace serialize{
+enum class TypeKind : std::uint8_t;
+//Binary encoding of analyzed ASTs, so that unchanged input can go straight to codegen
+//Strings (identifiers, source lines, tags) are written once and then referred to by index
+
+//Throws the std::runtime_error that loading reports for data it cannot decode
+[[noreturn]] void malformed(const std::string& what);
+
+class Writer{
+    std::string buffer;
+    std::unordered_map<std::string, std::uint64_t> string_ids;
+public:
+    void write_byte(std::uint8_t b);
+    void write_bool(bool b);
+    void write_uint(std::uint64_t n);
+    void write_int(std::int64_t n);
+    void write_string(const std::string& s);
+    void write_token(const token::Token& tok);
+    void write_tokens(const std::vector<token::Token>& toks);
+    void write_type(const type::CType& type);
+    void write_tag_type(const type::TagType& type);
+    void write_constant(const ast::ConstantExprType& constant);
+    //Writes the node, or a null marker
+    void write_node(const ast::AST* node);
+    void write_initializer(const ast::Initializer* init);
+    const std::string& data() const;
+};
+
+class Reader{
+    std::string_view data;
+    std::size_t position = 0;
+    std::vector<std::string> strings;
+    std::unique_ptr<ast::AST> read_node();
+    type::TagType read_tag_body(TypeKind kind);
+public:
+    explicit Reader(std::string_view data) : data(data) {}
+    std::uint8_t read_byte();
+    bool read_bool();
+    std::uint64_t read_uint();
+    //Reads a count of elements which each take at least one byte, so a corrupt count is caught before allocating
+    std::uint64_t read_count();
+    std::int64_t read_int();
+    std::string read_string();
+    token::Token read_token();
+    std::vector<token::Token> read_tokens();
+    type::CType read_type();
+    type::TagType read_tag_type();
+    ast::ConstantExprType read_constant();
+    //Reads a node written by Writer::write_node, checking that it has type T
+    template<typename T>
+    std::unique_ptr<T> read_node_as();
+    std::unique_ptr<ast::Initializer> read_initializer();
+    bool at_end() const;
+};
+
+template<typename T>
+std::unique_ptr<T> Reader::read_node_as(){
+    auto node = read_node();
+    if(!node){
+        return nullptr;
+    }
+    auto cast_node = dynamic_cast<T*>(node.get());
+    if(!cast_node){
+        malformed("unexpected node type");
+    }
+    node.release();
+    return std::unique_ptr<T>(cast_node);
+}
+
+//Hash of a preprocessed token stream, used as the key for cached ASTs
+std::uint64_t hash_tokens(const std::vector<token::Token>& tokens, std::uint64_t seed = 0);
+
+//Everything a cached AST depends on: the preprocessed tokens and the options changing the AST
+//The hash of the tokens only names the cache entry, so the key is stored in the entry and checked on load
+std::string cache_key(const std::vector<token::Token>& tokens, std::uint64_t options);
+
+//Encodes an analyzed program along with the tag table its types refer to, and the key it is saved under
+std::string save_program(const ast::Program& program, std::string_view key = {});
+//Decodes a program written by save_program, restoring its tag table
+//Throws std::runtime_error if the data is malformed, from another format version or saved under another key
+std::unique_ptr<ast::Program> load_program(std::string_view data, std::string_view key = {});
+}//namespace serialize
+#endif
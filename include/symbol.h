@@ -2,56 +2,145 @@
 #define _SYMBOL_
 #include<vector>
 #include<memory>
-#include<unordered_set>
 #include<exception>
 #include<map>
 #include<set>
 #include<optional>
+#include<deque>
+#include<functional>
+#include<unordered_map>
+#include<limits>
 #include "type.h"
 #include "token.h"
 namespace symbol{
 class BlockTable;
 class FuncTable;
 class GlobalTable;
+//Identifies one declaration in a translation unit, so later passes can find it without a name lookup
+using SymbolId = std::size_t;
+
+//Every name declared during analysis of a translation unit, shared by all of its scopes
+//Names are interned once into a table of the translation unit, and each id indexes its chain of
+//declarations with the innermost last, so a lookup is a single hash lookup however deeply the scopes are nested
+//Declarations are recorded by id in an undo log, which a scope unwinds when it is exited
+class Bindings{
+public:
+    //Index of an interned identifier, the same for ordinary names and tags spelled alike
+    using NameId = std::size_t;
+    enum class Kind{
+        Variable, Typedef, Constant
+    };
+    struct Symbol{
+        type::CType type;
+        bool has_def;
+        Kind kind;
+        int constant_value;
+        std::size_t depth;
+        SymbolId id = 0;
+        //Position of the declaration in the undo log
+        std::size_t position = 0;
+    };
+    struct Tag{
+        type::TagId id;
+        std::size_t depth;
+        std::size_t position = 0;
+    };
+    Bindings() = default;
+    Bindings(const Bindings&) = delete;
+    Bindings& operator=(const Bindings&) = delete;
+
+    //Id of the name, adding it to the name table if it is new
+    NameId intern(const std::string& name);
+    //Id of the name if it has ever been declared
+    std::optional<NameId> name_id(const std::string& name) const;
+
+    const Symbol* find(NameId name) const;
+    const Symbol* find(const std::string& name) const;
+    //The declaration of name in the scope at the given depth, if any
+    const Symbol* find(const std::string& name, std::size_t depth) const;
+    //Adds the declaration and gives it the next symbol id
+    SymbolId declare(NameId name, Symbol symbol);
+    SymbolId declare(const std::string& name, Symbol symbol);
+    std::optional<type::TagId> find_tag(NameId name) const;
+    std::optional<type::TagId> find_tag(const std::string& name) const;
+    std::optional<type::TagId> find_tag(const std::string& name, std::size_t depth) const;
+    void declare_tag(NameId name, Tag tag);
+    void declare_tag(const std::string& name, Tag tag);
+
+    std::size_t mark() const noexcept;
+    //Removes every declaration made since the given mark
+    void unwind(std::size_t mark);
+    //Hides the file scope declarations made since the given mark from lookups,
+    //and returns the previous mark so that it can be restored
+    std::size_t hide_globals_from(std::size_t mark) noexcept;
+private:
+    //File scope declarations from this position on are hidden
+    std::size_t visible_globals = std::numeric_limits<std::size_t>::max();
+    bool hidden(std::size_t depth, std::size_t position) const noexcept;
+    std::unordered_map<std::string, NameId> names;
+    //Both indexed by NameId, and grown together whenever a name is interned
+    std::vector<std::vector<Symbol>> symbols;
+    std::vector<std::vector<Tag>> tags;
+    SymbolId symbol_count = 0;
+    //Name of each declaration in order, and whether it declared a tag
+    struct Declaration{
+        NameId name;
+        bool is_tag;
+    };
+    std::vector<Declaration> undo_log;
+};
 
 class STable{
 public:
     bool in_loop = false;
 protected:
     STable* parent;
-    std::vector<std::unique_ptr<STable>> children;
-    std::map<std::string, std::pair<type::CType,bool>> sym_map;
-    std::unordered_set<std::string> typedefs;
-    std::unordered_map<std::string, int> constants;
-    STable(STable* p) : parent(p), sym_map() {
-        if(p && p->in_loop){
+    //Tags of the program being analyzed, shared by every scope
+    type::TypeContext* type_context;
+    //Declarations of every open scope, owned by the global table
+    Bindings* bindings;
+    //Number of enclosing scopes, so 0 for the global scope
+    std::size_t depth;
+    STable(STable* p) : parent(p), type_context(p->type_context), bindings(p->bindings), depth(p->depth + 1) {
+        if(p->in_loop){
             in_loop = true;
         }else{
             in_loop = false;
         }
     }
+    STable(type::TypeContext& types, Bindings& bindings) : parent(nullptr), type_context(&types), bindings(&bindings), depth(0) {}
     STable() = delete;
 public:
     virtual ~STable() = default;
     STable& operator=(const STable&) = delete;
     STable(const STable&) = delete;
-    STable& operator=(STable&&) = default;
-    STable(STable&&) = default;
+    //Scopes are referred to by their children, so they cannot be moved
+    STable& operator=(STable&&) = delete;
+    STable(STable&&) = delete;
 
-    STable* most_recent_child();
+    type::TypeContext& types() const noexcept;
 
-    void add_symbol(std::string name, type::CType type, bool has_def = false);
+    //Returns the id of the declaration, which for a redeclaration at global scope is that of the first one
+    SymbolId add_symbol(std::string name, type::CType type, bool has_def = false);
+    //Innermost declaration of name, or nullptr if there is none
+    const Bindings::Symbol* find_symbol(const std::string& name) const;
     type::CType symbol_type(std::string name) const;
     bool has_symbol(std::string name);
 
     virtual bool in_function() const = 0;
     virtual void add_extern_decl(const std::string& name, const type::CType& type) = 0;
+    virtual void add_reference(const std::string& name) = 0;
 
     type::CType get_tag(std::string unmangled_tag) const;
     virtual void add_tag(std::string tag, type::TagType type) = 0;
     type::CType mangle_type_or_throw(type::CType type) const;
-    virtual std::string mangle_name(std::string name) const noexcept = 0;
+    //Id of the tag that the unmangled name refers to in this scope, if any
+    std::optional<type::TagId> find_tag(const std::string& name) const;
 
+    //Declares each struct or union tag named by the type which is not visible yet
+    //as an incomplete tag in this scope, as naming a tag in a declaration does
+    void declare_missing_tags(const type::CType& type);
+    //Typedefs are stored with their tags already resolved, so each use is a plain lookup
     void add_typedef(std::string name, type::CType type);
     //Returns true if the given symbol is, in the current scope
     //A valid typedef-name, and false otherwise
@@ -62,40 +151,49 @@ public:
     int get_constant_value(std::string name) const;
 };
 class GlobalTable : public STable{
+    Bindings global_bindings;
     std::map<std::string, type::CType> external_type_map;
-    std::map<std::string, type::CType> tags;
+    //Definitions whose analysis waits until a reference to them is found
+    std::map<std::string, std::function<void()>> deferred_definitions;
+    std::deque<std::function<void()>> referenced_definitions;
+    std::set<std::string> referenced_symbols;
 public:
     std::map<std::string, int> local_tag_count;
-    GlobalTable() : STable(nullptr), external_type_map() {}
-    FuncTable* new_function_scope_child(type::CType t);
+    explicit GlobalTable(type::TypeContext& types) : STable(types, global_bindings), external_type_map() {}
+    //Child scopes are owned by the caller, and their declarations are removed when they are destroyed
+    std::unique_ptr<FuncTable> new_function_scope_child(type::CType t);
     bool in_function() const override;
     void add_extern_decl(const std::string& name, const type::CType& type) override;
+    void add_reference(const std::string& name) override;
+    void defer_definition(const std::string& name, std::function<void()> analyze_definition);
+    void analyze_referenced_definitions();
     void add_tag(std::string tag, type::TagType type) override;
-    std::string mangle_name(std::string name) const noexcept override;
 };
 
 class BlockTable : public STable{
     GlobalTable* global;
     FuncTable* current_func;
     std::unique_ptr<std::set<std::optional<unsigned long long int>>> switch_cases;
-    std::map<std::string, int> tags;
+    //Size of the undo log when this scope was entered
+    std::size_t bindings_mark;
 public:
     BlockTable(GlobalTable* global, FuncTable* func, STable* parent) : 
-        STable(parent), global(global), current_func(func), switch_cases(nullptr) {}
+        STable(parent), global(global), current_func(func), switch_cases(nullptr), bindings_mark(bindings->mark()) {}
+    ~BlockTable() override;
     type::CType return_type();
     bool in_function() const override;
     void add_extern_decl(const std::string& name, const type::CType& type) override;
+    void add_reference(const std::string& name) override;
     void add_tag(std::string tag, type::TagType type) override;
-    std::string mangle_name(std::string name) const noexcept override;
     bool in_switch() const;
-    BlockTable* new_switch_scope_child();
+    std::unique_ptr<BlockTable> new_switch_scope_child();
     std::set<std::optional<unsigned long long int>>* get_switch() const;
     void require_label(const token::Token& tok);
     void add_label(const std::string& name);
     void add_case(std::optional<unsigned long long int> case_val);
     std::unique_ptr<std::set<std::optional<unsigned long long int>>> transfer_switch_table();
     std::optional<token::Token> unmatched_label() const;
-    BlockTable* new_block_scope_child();
+    std::unique_ptr<BlockTable> new_block_scope_child();
 };
 class FuncTable : public BlockTable{
     friend BlockTable;
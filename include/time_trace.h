@@ -0,0 +1,38 @@
+#ifndef _TIME_TRACE_
+#define _TIME_TRACE_
+#include "location.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+namespace time_trace{
+//Records how long each phase of a compile takes, to be written out as a Chrome trace (JSON)
+//Spans can be opened on any thread, and nest within the spans already open on the same thread
+//Nothing is recorded (and scopes cost a single check) unless tracing has been enabled
+
+//Starts recording spans, dropping those shorter than the granularity
+//Locations of spans are written as being in the source file
+void enable(std::string source_file, std::chrono::microseconds granularity = std::chrono::microseconds(500));
+//Stops recording, and drops every span recorded so far
+void disable();
+bool enabled();
+//Writes the spans closed so far as a Chrome trace, which trace viewers (chrome://tracing, Perfetto) can load
+void write(std::ostream& output);
+
+//A span from construction until destruction
+class Scope{
+    const char* name;
+    std::string detail;
+    location::Location loc;
+    bool active;
+    bool has_location;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit Scope(const char* name);
+    //The detail (such as the name of a function) and its location are shown with the span
+    Scope(const char* name, const std::string& detail, const location::Location& loc);
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope();
+};
+} //namespace time_trace
+#endif
@@ -1,17 +1,22 @@
 #ifndef _TYPE_
 #define _TYPE_
 #include <variant>
-#include <unordered_set>
 #include <cassert>
+#include <cstdint>
 #include <set>
 #include <map>
+#include <deque>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <optional>
 #include <functional>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include "ir_writer.h"
 namespace type{
 bool is_specifier(const std::string& s);
 
@@ -23,6 +28,35 @@ enum class TQualifier{
 bool is_type_qualifier(const std::string& s);
 TQualifier get_type_qualifier(const std::string& s);
 
+//Set of type qualifiers, stored as one bit per qualifier
+class QualifierSet{
+    std::uint8_t bits = 0;
+    static constexpr std::uint8_t bit(TQualifier q) noexcept{
+        return std::uint8_t(1) << static_cast<int>(q);
+    }
+public:
+    constexpr QualifierSet() noexcept = default;
+    constexpr explicit QualifierSet(std::uint8_t mask) noexcept : bits(mask) {}
+    constexpr void insert(TQualifier q) noexcept{
+        bits |= bit(q);
+    }
+    constexpr bool contains(TQualifier q) const noexcept{
+        return bits & bit(q);
+    }
+    constexpr bool empty() const noexcept{
+        return bits == 0;
+    }
+    constexpr std::uint8_t mask() const noexcept{
+        return bits;
+    }
+    constexpr bool operator ==(const QualifierSet& other) const noexcept{
+        return bits == other.bits;
+    }
+    constexpr bool operator !=(const QualifierSet& other) const noexcept{
+        return bits != other.bits;
+    }
+};
+
 enum class SSpecifier{
     Auto, Typedef, Extern, Static, Register, 
     Thread_local, Thread_local_static, Thread_local_extern
@@ -53,40 +87,50 @@ class UnionType;
 class EnumType;
 class DerivedType;
 class CType;
+struct InternedType;
+class TypeArena;
+
+//Reference for derived types, which point into the intern table, and a copy otherwise
+template<typename T>
+using get_result_t = std::conditional_t<std::is_convertible_v<T, DerivedType>, const T&, T>;
 
-typedef std::variant<std::unique_ptr<FuncType>, std::unique_ptr<PointerType>, 
+//Alternatives are in the same order as the derived kinds below
+typedef std::variant<std::unique_ptr<FuncType>, std::unique_ptr<PointerType>, std::unique_ptr<ArrayType>,
     std::unique_ptr<StructType>, std::unique_ptr<UnionType>> DerivedPointers;
+
+//Cheap tag for the most specific kind of a type, so predicates don't need to visit or cast
+enum class TypeKind : std::uint8_t{
+    Void, Int, Float, Typedef, Function, Pointer, Array, Struct, Union
+};
 struct EnumType{
     std::string tag;
 };
 typedef std::variant<type::StructType, type::UnionType, type::EnumType> TagType;
 
+//Handle to a derived type in the intern table of a TypeArena
+//Each distinct type is stored once in its arena, so copies are pointer copies,
+//and equality between types of the same arena compares their equivalence classes
 class DerivedType{
-    DerivedPointers type;
+    const InternedType* type;
 public:
-    DerivedType(FuncType f); //Defined in type_func.cpp
-    DerivedType(PointerType f); //Defined in type_pointer.cpp
-    DerivedType(ArrayType f); //Defined in type_array.cpp
-    DerivedType(StructType f); //Defined in type_struct.cpp
-    DerivedType(UnionType f); //Defined in type_struct.cpp
-
-    DerivedType(const DerivedType& other); 
-    DerivedType& operator=(const DerivedType& other);
-    DerivedType(DerivedType&& other) = default;
-    DerivedType& operator=(DerivedType&& other) = default;
-    ~DerivedType() = default;
-
-    bool operator==(const DerivedType& other) const;
-    bool operator!=(const DerivedType& other) const;
+    //Looks up the type in the arena new types go into, adding it if it is new
+    DerivedType(const FuncType& f);
+    DerivedType(const PointerType& f);
+    DerivedType(const ArrayType& f);
+    DerivedType(const StructType& f);
+    DerivedType(const UnionType& f);
+
+    bool operator==(const DerivedType& other) const noexcept;
+    bool operator!=(const DerivedType& other) const noexcept;
+    //Distinct for each distinct type, including array sizes, qualifiers and struct members
+    const InternedType* identity() const noexcept;
+    TypeKind kind() const noexcept;
 
     template <typename ReturnType, typename Visitor>
     ReturnType visit(Visitor&& v) const;
 
     template<typename T>
-    friend T get(const CType& type);
-
-    template<typename T>
-    friend bool is_type(const CType& type);
+    friend get_result_t<T> get(const CType& type) noexcept;
 };
 class UnevaluatedTypedef{
     std::string name;
@@ -96,13 +140,21 @@ public:
     bool operator ==(const UnevaluatedTypedef& other) const;
     bool operator !=(const UnevaluatedTypedef& other) const;
 };
+//Size, alignment and member placement of a complete struct or union
+struct Layout{
+    long long int size = 0;
+    long long int align = 0;
+    //Byte offset of each member, in declaration order
+    std::vector<long long int> offsets;
+    //Index of the first member of largest size, which is how a union is stored
+    std::size_t largest_member = 0;
+};
+
 class CType{
     std::variant<VoidType, BasicType, UnevaluatedTypedef, DerivedType> type;
-    //Maps mangled tags to completed types
-    static std::map<std::string, type::CType> tags;
 public:
     std::optional<SSpecifier> storage = std::nullopt;
-    std::unordered_set<TQualifier> qualifiers = {};
+    QualifierSet qualifiers = {};
 
     CType() : type() {}
     bool operator ==(const CType& other) const;
@@ -116,21 +168,76 @@ public:
     CType& operator=(CType&& other) = default;
     ~CType() = default;
 
+    TypeKind kind() const noexcept;
     template<typename T>
-    friend bool is_type(const CType& type);
-    template<typename T>
-    friend T get(const CType& type);
+    friend get_result_t<T> get(const CType& type) noexcept;
     template<typename Visitor>
     friend auto visit(Visitor&& v, const CType& type);
-    friend long long int size(const CType& type);
-    friend long long int align(const CType& type);
+};
 
-    static bool tag_declared(std::string tag);
-    static CType get_tag(std::string mangled_tag);
-    static void add_tag(std::string tag, type::TagType type);
-    static void tag_ir_types(std::ostream& output);
+//Index of a mangled tag within its TypeContext
+using TagId = std::size_t;
 
-    static void reset_tables() noexcept;
+//Makes the derived types created on the calling thread go into the arena until the scope ends
+//Outside of any scope, new types go into the arena of the types they are built from, and otherwise into
+//an arena shared by the whole process, which is only meant for tools and tests working on lone declarations
+class ArenaScope{
+    TypeArena* previous;
+public:
+    explicit ArenaScope(TypeArena& arena) noexcept;
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+//Struct, union and enum tags declared by one compilation, along with the layouts of its structs and unions,
+//and the arena holding its derived types
+//Owned by the program being compiled, so separate translation units never share tags or types
+//Mangled tags are interned, so symbol tables can resolve a tag to its id once and then index directly
+class TypeContext{
+    struct Tag{
+        std::string name;
+        //Empty until the tag is declared
+        std::optional<CType> type;
+        //Filled in the first time a completed tag's layout is needed
+        mutable std::optional<Layout> layout;
+    };
+    template<typename T>
+    std::optional<TagId> tag_of(const T& type) const;
+    //A deque so that references to tags and layouts stay valid as tags are added
+    std::deque<Tag> tags;
+    std::unordered_map<std::string, TagId> tag_ids;
+    std::shared_ptr<TypeArena> arena;
+public:
+    TypeContext();
+    //Derived types created on the calling thread while the scope lives are freed along with this context
+    //Every thread parsing, analyzing or generating code for the program opens one
+    ArenaScope arena_scope() const noexcept;
+    //Id of the mangled tag, adding it as an undeclared tag if it is new
+    TagId intern_tag(const std::string& mangled_tag);
+    std::optional<TagId> find_tag(const std::string& mangled_tag) const;
+    //Uses the id the type was mangled with, and only looks the tag up by name for types
+    //built elsewhere, such as ones read back from a cache
+    std::optional<TagId> find_tag(const StructType& type) const;
+    std::optional<TagId> find_tag(const UnionType& type) const;
+    const std::string& tag_name(TagId id) const noexcept;
+    bool tag_declared(TagId id) const noexcept;
+    bool tag_declared(const std::string& mangled_tag) const;
+    //Throw std::runtime_error if the tag has not been declared
+    const CType& get_tag(TagId id) const;
+    const CType& get_tag(const std::string& mangled_tag) const;
+    const CType& get_tag(const StructType& type) const;
+    const CType& get_tag(const UnionType& type) const;
+    void add_tag(TagId id, TagType type);
+    //Tag definitions in order of mangled name
+    void tag_ir_types(ir_writer::Writer& output) const;
+    std::map<std::string, CType> tag_table() const;
+    void restore_tags(const std::map<std::string, CType>& tags);
+    //Fills in the layout of every complete struct and union, after which the context
+    //is only ever read, so it can be shared by threads generating code
+    void compute_layouts() const;
+
+    friend const Layout& layout(const CType& type, const TypeContext& types);
 };
 
 class PointerType{
@@ -142,7 +249,6 @@ public:
     explicit PointerType(CType t);
     bool operator ==(const PointerType& other) const;
     bool operator !=(const PointerType& other) const;
-    virtual std::unique_ptr<PointerType> copy() const;
     CType pointed_type() const;
     CType element_type() const;
     friend bool is_compatible(const PointerType& type1, const PointerType& type2);
@@ -157,7 +263,6 @@ public:
     ArrayType(CType t, std::optional<int> s);
     bool operator ==(const ArrayType& other) const;
     bool operator !=(const ArrayType& other) const;
-    std::unique_ptr<PointerType> copy() const override;
     void set_size(long long int size);
     long long int size() const;
     long long int align() const;
@@ -180,13 +285,12 @@ public:
     explicit FuncType(CType ret);
     bool operator ==(const FuncType& other) const;
     bool operator !=(const FuncType& other) const;
-    std::unique_ptr<FuncType> copy() const;
     friend bool is_compatible(const FuncType& type1, const FuncType& type2);
     std::string to_string() const;
     std::string ir_type() const;
     bool has_prototype() const; 
     bool is_variadic() const; 
-    std::vector<CType> param_types() const; 
+    const std::vector<CType>& param_types() const; 
     CType return_type() const; 
     bool params_match(std::vector<CType> arg_types) const;
 };
@@ -194,17 +298,17 @@ public:
 struct StructType{
     bool complete;
     std::string tag;
+    //Id of the mangled tag in the TypeContext, once the type has been mangled
+    std::optional<TagId> id;
     std::vector<CType> members;
     std::map<std::string, int> indices;
-    explicit StructType(std::string tag) : tag(tag), complete(false) {}
-    StructType(std::string tag, std::vector<CType> members, std::map<std::string, int> indices) :
-        tag(tag), members(members), indices(indices), complete(true) {}
+    explicit StructType(std::string tag, std::optional<TagId> id = std::nullopt) : complete(false), tag(tag), id(id) {}
+    StructType(std::string tag, std::vector<CType> members, std::map<std::string, int> indices,
+        std::optional<TagId> id = std::nullopt) :
+        complete(true), tag(tag), id(id), members(members), indices(indices) {}
     std::string to_string() const;
     std::string ir_type() const;
     bool is_complete() const;
-    std::unique_ptr<StructType> copy() const;
-    long long int size(const std::map<std::string, type::CType>& tags) const;
-    long long int align(const std::map<std::string, type::CType>& tags) const;
     bool operator ==(const StructType& other) const;
     bool operator !=(const StructType& other) const;
 };
@@ -212,18 +316,18 @@ struct UnionType{
     bool complete;
     bool largest_computed;
     std::string tag;
+    std::optional<TagId> id;
     std::vector<CType> members;
     std::map<std::string, int> indices;
     CType largest;
-    explicit UnionType(std::string tag) : tag(tag), complete(false), largest_computed(false) {}
-    UnionType(std::string tag, std::vector<CType> members, std::map<std::string, int> indices);
+    explicit UnionType(std::string tag, std::optional<TagId> id = std::nullopt) :
+        complete(false), largest_computed(false), tag(tag), id(id) {}
+    UnionType(std::string tag, std::vector<CType> members, std::map<std::string, int> indices,
+        std::optional<TagId> id = std::nullopt);
     std::string to_string() const;
     std::string ir_type() const;
     bool is_complete() const;
-    void compute_largest(const std::map<std::string, type::CType>& tags);
-    std::unique_ptr<UnionType> copy() const;
-    long long int size(const std::map<std::string, type::CType>& tags) const;
-    long long int align(const std::map<std::string, type::CType>& tags) const;
+    void compute_largest(const TypeContext& types);
     bool operator ==(const UnionType& other) const;
     bool operator !=(const UnionType& other) const;
 };
@@ -235,45 +339,149 @@ bool can_assign(const CType& from, const CType& to); //Defined in type.cpp
 bool can_cast(const CType& from, const CType& to); //Defined in type.cpp
 
 BasicType from_str_multiset(const std::multiset<std::string>& keywords);
-BasicType usual_arithmetic_conversions(CType type1, CType type2);
+BasicType usual_arithmetic_conversions(const CType& type1, const CType& type2);
 BasicType integer_promotions(const CType& type);
-bool is_signed_int(CType type);
-bool is_unsigned_int(CType type);
-bool is_float(CType type);
+bool is_signed_int(const CType& type);
+bool is_unsigned_int(const CType& type);
+bool is_float(const CType& type);
 
-bool is_int(CType type);
-bool is_arith(CType type);
-bool is_scalar(CType type);
+bool is_int(const CType& type);
+bool is_arith(const CType& type);
+bool is_scalar(const CType& type);
 
 bool can_represent(IType type, unsigned long long int value);
 bool can_represent(IType target, IType source);
 bool can_represent(FType target, FType source);
 
-std::string ir_type(const CType& type);
+//Cached for derived types, so the view stays valid for the life of the program
+std::string_view ir_type(const CType& type);
 BasicType from_str(const std::string& type);
+//Prebuilt CTypes for the basic types, for hot paths that would otherwise build the same type repeatedly
+const CType& basic_ctype(IType type) noexcept;
+const CType& basic_ctype(FType type) noexcept;
 bool promote_one_rank(IType& type);
 IType to_unsigned(IType type); 
 bool can_represent(IType type, unsigned long long int value);
-long long int size(const CType& type);
-long long int align(const CType& type);
+long long int size(const CType& type, const TypeContext& types);
+long long int align(const CType& type, const TypeContext& types);
+//For struct and union types; incomplete types are looked up in the tag table
+//Throws std::runtime_error if the tag is undefined or still incomplete
+const Layout& layout(const CType& type, const TypeContext& types);
+//Text of a constant in LLVM IR: integers in decimal, and floating point numbers as the exact bits of a double
+//(rounded to float precision for floats); a literal's text is parsed first, and other values are converted to the type
 std::string ir_literal(const std::string& c_literal,BasicType type);
+std::string ir_literal(long long int value, BasicType type);
+std::string ir_literal(long double value, BasicType type);
+//c"..." string holding the bytes, with quotes, backslashes and unprintable bytes written as \XX
 std::string ir_literal(const std::string& c_literal);
 
 bool is_complete(const CType& type);
 
 
+//Entry in the intern table of an arena
+//Types of an arena which compare equal (ignoring qualifiers, array sizes, and struct members) share an equivalence class
+struct InternedType{
+    DerivedPointers node;
+    std::size_t equivalence_class;
+    TypeArena* arena;
+    InternedType(DerivedPointers node, std::size_t equivalence_class, TypeArena* arena)
+        : node(std::move(node)), equivalence_class(equivalence_class), arena(arena) {}
+    //Built on first use, since union spellings need the largest member computed
+    std::string_view ir_type() const;
+private:
+    mutable std::once_flag ir_type_computed;
+    mutable std::string ir_type_spelling;
+};
+
+inline TypeKind DerivedType::kind() const noexcept{
+    return static_cast<TypeKind>(static_cast<std::size_t>(TypeKind::Function) + type->node.index());
+}
+
+inline TypeKind CType::kind() const noexcept{
+    if(auto derived = std::get_if<DerivedType>(&type)){
+        return derived->kind();
+    }else if(auto basic = std::get_if<BasicType>(&type)){
+        return std::holds_alternative<IType>(*basic) ? TypeKind::Int : TypeKind::Float;
+    }else if(std::holds_alternative<UnevaluatedTypedef>(type)){
+        return TypeKind::Typedef;
+    }
+    return TypeKind::Void;
+}
+
+//Whether a type of the given kind can be used as a T
+//Arrays are also pointers, since ArrayType derives from PointerType
+template<typename T>
+constexpr bool is_kind(TypeKind kind) noexcept{
+    if constexpr(std::is_same_v<T,VoidType>){
+        return kind == TypeKind::Void;
+    }else if constexpr(std::is_same_v<T,BasicType>){
+        return kind == TypeKind::Int || kind == TypeKind::Float;
+    }else if constexpr(std::is_same_v<T,IType>){
+        return kind == TypeKind::Int;
+    }else if constexpr(std::is_same_v<T,FType>){
+        return kind == TypeKind::Float;
+    }else if constexpr(std::is_same_v<T,UnevaluatedTypedef>){
+        return kind == TypeKind::Typedef;
+    }else if constexpr(std::is_same_v<T,DerivedType>){
+        return kind >= TypeKind::Function;
+    }else if constexpr(std::is_same_v<T,FuncType>){
+        return kind == TypeKind::Function;
+    }else if constexpr(std::is_same_v<T,PointerType>){
+        return kind == TypeKind::Pointer || kind == TypeKind::Array;
+    }else if constexpr(std::is_same_v<T,ArrayType>){
+        return kind == TypeKind::Array;
+    }else if constexpr(std::is_same_v<T,StructType>){
+        return kind == TypeKind::Struct;
+    }else if constexpr(std::is_same_v<T,UnionType>){
+        return kind == TypeKind::Union;
+    }else{
+        static_assert(!std::is_same_v<T,T>, "is_kind called with a type that is not a C type");
+        return false;
+    }
+}
+
+template<typename T>
+bool is_type(const CType& type) noexcept{
+    return is_kind<T>(type.kind());
+}
+
+//Callers must check is_type<T> first; asking for the wrong type is a bug in the compiler, not in the input
+template<typename T>
+get_result_t<T> get(const CType& type) noexcept{
+    assert(is_type<T>(type) && "Incorrect type for type::get");
+    if constexpr(std::is_same_v<T,DerivedType>){
+        return *std::get_if<DerivedType>(&type.type);
+    }else if constexpr(std::is_convertible_v<T,DerivedType>){
+        const auto& node = std::get_if<DerivedType>(&type.type)->type->node;
+        if constexpr(std::is_same_v<T,PointerType>){
+            if(auto array = std::get_if<std::unique_ptr<ArrayType>>(&node)){
+                return **array;
+            }
+        }
+        return **std::get_if<std::unique_ptr<T>>(&node);
+    }else if constexpr(std::is_same_v<T,IType> || std::is_same_v<T,FType>){
+        return *std::get_if<T>(std::get_if<BasicType>(&type.type));
+    }else{
+        return *std::get_if<T>(&type.type);
+    }
+}
+
 //Everything below is template stuff for type::make_visitor to work properly
 template <class... Ts> struct overloaded : Ts...{using Ts::operator()...;};
 template<class...Ts> overloaded(Ts ...) -> overloaded<Ts...>;
 
 
-template <typename ReturnType, typename Pointer, typename Visitor>
-ReturnType try_invoke(Visitor& v,Pointer p){
-    if constexpr(std::is_convertible_v<decltype(std::invoke(v,*p)),ReturnType>){
-        return std::invoke(v,*p);
+//Visitor lambdas either return something convertible to ReturnType, or return void because they always throw
+template <typename ReturnType, typename Visitor, typename Arg>
+ReturnType try_invoke(Visitor& v, const Arg& arg){
+    using Result = std::invoke_result_t<Visitor&, const Arg&>;
+    if constexpr(std::is_convertible_v<Result,ReturnType>){
+        return std::invoke(v,arg);
     }else{
-        std::invoke(v,*p);//Give this function a chance to throw an exception
-        throw std::runtime_error("Tried to call visit helper on "+p->to_string()+" returning incompatible return type");
+        static_assert(std::is_void_v<Result>, "Type visitor lambda returns a type not convertible to the visitor's return type");
+        std::invoke(v,arg);
+        assert(false && "Type visitor lambda returned without a value");
+        __builtin_unreachable();
     }
 }
 
@@ -284,18 +492,7 @@ auto visit(Visitor&& v, const CType& t){
 
 template <typename ReturnType, typename Visitor>
 ReturnType DerivedType::visit(Visitor&& v) const{
-    if(std::holds_alternative<std::unique_ptr<PointerType>>(type)){
-        auto pointer = std::get<std::unique_ptr<PointerType>>(type).get();
-        if(auto p = dynamic_cast<ArrayType*>(pointer)){
-            return try_invoke<ReturnType>(v,p);
-        }else{
-            return try_invoke<ReturnType>(v,pointer);
-        }
-    }else{
-        return std::visit(overloaded{
-            [&v](const auto& t)->ReturnType{return try_invoke<ReturnType>(v,t.get());}
-        }, type);
-    }
+    return std::visit([&v](const auto& t)->ReturnType{return try_invoke<ReturnType>(v,*t);}, type->node);
 }
 
 template<typename ReturnType, typename...Ts>
@@ -303,27 +500,13 @@ struct type_visitor{
     overloaded<Ts...> inner_visitor;
     template <typename T>
     ReturnType operator()(const T& a){
-        if constexpr(std::is_convertible_v<std::invoke_result_t<overloaded<Ts...>,T>,ReturnType>){
-            return inner_visitor(a);
-        }else{
-            inner_visitor(a);
-            throw std::runtime_error("Tried to call type visitor on lambda returning incompatible return type");
-        }
+        return try_invoke<ReturnType>(inner_visitor,a);
     }
     ReturnType operator()(const BasicType& basic_type){
-        if constexpr(std::is_convertible_v<decltype(std::visit(inner_visitor,basic_type)),ReturnType>){
-            return std::visit(inner_visitor,basic_type);
-        }else{
-            std::visit(inner_visitor,basic_type);
-            throw std::runtime_error("Tried to call basic type visitor on lambda returning incompatible return type");
-        }
+        return std::visit([this](const auto& t)->ReturnType{return try_invoke<ReturnType>(inner_visitor,t);}, basic_type);
     }
     ReturnType operator()(const DerivedType& derived_type){
-        if constexpr(std::is_convertible_v<decltype(derived_type.visit<ReturnType>(inner_visitor)),ReturnType>){
-            return derived_type.visit<ReturnType>(inner_visitor);
-        }else{
-            throw std::runtime_error("Tried to call type visitor on "+type::to_string(derived_type)+" with function returning incompatible return type");
-        }
+        return derived_type.visit<ReturnType>(inner_visitor);
     }
 };
 
@@ -333,47 +516,5 @@ type_visitor<ReturnType, Ts...> make_visitor(Ts... args){
 }
 
 
-template<typename T>
-bool is_type(const CType& type){
-    if constexpr(std::is_same_v<T,ArrayType>){
-        try{
-            return type::is_type<PointerType>(type)
-                && dynamic_cast<ArrayType*>(std::get<std::unique_ptr<PointerType>>(std::get<DerivedType>(type.type).type).get());
-        }catch(std::exception& e){
-            throw std::runtime_error("Failed to check if "+to_string(type)+ " is array type");
-        }
-    }else{
-        return std::visit(make_visitor<bool>(
-            [](const auto& type){return std::is_convertible_v<std::decay_t<decltype(type)>,T>;}
-        ), type.type);
-    }
-}
-
-template<typename T>
-T get(const CType& type){
-    try{
-        if constexpr(std::is_same_v<T,ArrayType>){
-            auto pointer = std::get<std::unique_ptr<PointerType>>(std::get<DerivedType>(type.type).type).get();
-            if(auto p = dynamic_cast<ArrayType*>(pointer)){
-                return *p;
-            }
-        }else{
-            if constexpr(std::is_convertible_v<T,DerivedType>){
-                return *std::get<std::unique_ptr<T>>(std::get<DerivedType>(type.type).type).get();
-            }else if constexpr (std::is_same_v<T,IType> || std::is_same_v<T,FType>){
-                return std::get<T>(std::get<BasicType>(type.type));
-            }else{
-                return std::get<T>(type.type);
-            }
-        }
-    }catch(std::exception& e){
-        throw std::runtime_error("Incorrect type for type::get, cannot get "+std::string(typeid(T).name())+" from "+to_string(type)
-            +"\n"+ e.what()+std::string("\n branch: ")+std::to_string(std::is_convertible_v<T,DerivedType>));
-    }
-    throw std::runtime_error("Incorrect type for type::get, cannot get "+std::string(typeid(T).name())+" from "+to_string(type));
-}
-
-
-
 }
 #endif
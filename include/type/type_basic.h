@@ -25,8 +25,8 @@ int byte_size(const BasicType& type);
 //Printing
 std::string to_string(IType type);
 std::string to_string(FType type);
-std::string ir_type(IType type);
-std::string ir_type(FType type);
+std::string_view ir_type(IType type);
+std::string_view ir_type(FType type);
 } //namespace type
 
 #endif
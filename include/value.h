@@ -1,23 +1,147 @@
 #ifndef _VALUE_
 #define _VALUE_
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "type.h"
+#include "ir_writer.h"
 namespace value{
+class Value;
+//Text of a value, which is only produced when it is written to a stream
+class Spelling{
+    const Value& v;
+public:
+    explicit Spelling(const Value& v) : v(v) {}
+    std::string str() const;
+    friend std::ostream& operator<<(std::ostream& output, Spelling s);
+    friend ir_writer::Writer& operator<<(ir_writer::Writer& output, Spelling s);
+};
 class Value{
-    //The name of the corresponding SSA register, with global or local indicator
-    const std::string value;
-    const type::CType type;
 public:
-    Value(std::string value, type::CType type) : value(value), type(type) {}
-    std::string get_value() const{
-        return value;
-    }
-    /*std::string get_value_name() const{
-        return value.substr(1);
-    }*/
-    type::CType get_type() const{
+    enum class Kind : std::uint8_t{
+        //%number
+        Temp,
+        //%name.number
+        Local,
+        //@name
+        Global,
+        //name, which is the literal text
+        Literal
+    };
+private:
+    //Names are interned by the context which made the value, so they are never copied
+    const std::string* name;
+    std::uint32_t number;
+    Kind kind;
+    type::CType type;
+public:
+    Value(Kind kind, std::uint32_t number, const std::string* name, type::CType type) 
+        : name(name), number(number), kind(kind), type(type) {}
+    //The same register or constant, with another type
+    Value(const Value& v, type::CType type) : name(v.name), number(v.number), kind(v.kind), type(type) {}
+    //The name of the corresponding SSA register, with global or local indicator
+    Spelling get_value() const{
+        return Spelling(*this);
+    }
+    Kind get_kind() const{
+        return kind;
+    }
+    //Name interned by the context, or the text of a literal; not meaningful for temporaries
+    const std::string* get_name() const{
+        return name;
+    }
+    std::uint32_t get_number() const{
+        return number;
+    }
+    const type::CType& get_type() const{
         return type;
     }
+    template<typename Output>
+    void print(Output& output) const{
+        switch(kind){
+            case Kind::Temp:
+                output << '%' << number;
+                break;
+            case Kind::Local:
+                output << '%' << *name << '.' << number;
+                break;
+            case Kind::Global:
+                output << '@' << *name;
+                break;
+            case Kind::Literal:
+                output << *name;
+                break;
+        }
+    }
+};
+inline std::ostream& operator<<(std::ostream& output, Spelling s){
+    s.v.print(output);
+    return output;
+}
+inline ir_writer::Writer& operator<<(ir_writer::Writer& output, Spelling s){
+    s.v.print(output);
+    return output;
+}
+inline std::string Spelling::str() const{
+    auto ss = std::ostringstream();
+    v.print(ss);
+    return ss.str();
+}
+
+//Values allocated in fixed size chunks, so a value keeps its address until it is released
+//Values are released in the reverse order of allocation, either back to a mark or all at once,
+//and released chunks are kept for reuse until the pool is destroyed
+class ValuePool{
+    static constexpr std::size_t chunk_size = 256;
+    using Slot = std::aligned_storage_t<sizeof(Value), alignof(Value)>;
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    std::size_t count = 0;
+    Value* slot(std::size_t i) const{
+        return std::launder(reinterpret_cast<Value*>(&chunks[i / chunk_size][i % chunk_size]));
+    }
+public:
+    ValuePool() = default;
+    ValuePool(const ValuePool&) = delete;
+    ValuePool& operator=(const ValuePool&) = delete;
+    ~ValuePool(){
+        release(0);
+    }
+    template<class... Args>
+    Value* make(Args&&... args){
+        if(count == chunks.size() * chunk_size){
+            chunks.push_back(std::make_unique<Slot[]>(chunk_size));
+        }
+        auto v = new (&chunks[count / chunk_size][count % chunk_size]) Value(std::forward<Args>(args)...);
+        count++;
+        return v;
+    }
+    //Number of live values, which can be passed to release as a mark
+    std::size_t size() const noexcept{
+        return count;
+    }
+    std::size_t capacity() const noexcept{
+        return chunks.size() * chunk_size;
+    }
+    //The i-th most recently allocated live value
+    Value* back(std::size_t i = 0) const{
+        assert(i < count && "Value pool index out of range");
+        return slot(count - i - 1);
+    }
+    //Destroys every value allocated after the mark
+    void release(std::size_t mark){
+        assert(mark <= count && "Value pool released past its end");
+        while(count > mark){
+            count--;
+            slot(count)->~Value();
+        }
+    }
 };
 } //namespace value
 #endif
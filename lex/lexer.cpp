@@ -47,9 +47,13 @@ TokenStream::TokenStream(std::vector<token::Token> tokens){
 }
 
 Lexer::Lexer(std::istream& input){
-    tokenizer = std::make_unique<Tokenizer>(input);
-    assert(tokenizer && "Failed to construct tokenizer");
-    preprocessor = std::make_unique<Preprocessor>(*tokenizer);
+    source = std::make_unique<Tokenizer>(input);
+    assert(source && "Failed to construct tokenizer");
+    preprocessor = std::make_unique<Preprocessor>(*source);
+}
+Lexer::Lexer(std::vector<token::Token> tokenized){
+    source = std::make_unique<TokenStream>(std::move(tokenized));
+    preprocessor = std::make_unique<Preprocessor>(*source);
 }
 Lexer::~Lexer() = default;
 
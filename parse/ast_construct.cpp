@@ -117,15 +117,15 @@ Constant::Constant(const token::Token& tok) : Expr(tok){
                 case 'l':
                 case 'L':
                     literal.pop_back();
-                    type = type::from_str("long double");
+                    type = type::FType::LDouble;
                     break;
                 case 'f':
                 case 'F':
                     literal.pop_back();
-                    type = type::from_str("float");
+                    type = type::FType::Float;
                     break;
                 default:
-                    type = type::from_str("double");
+                    type = type::FType::Double;
                     assert(std::isdigit(literal.back()));
 
             }
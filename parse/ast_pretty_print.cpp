@@ -106,6 +106,11 @@ void FunctionDef::pretty_print(int depth) const{
     FunctionDecl::pretty_print(depth);
     AST::print_whitespace(depth);
     std::cout<< "FUNCTION DEF BODY: " << std::endl;
+    if(!function_body){
+        AST::print_whitespace(depth + 2);
+        std::cout<< "UNPARSED (" << unparsed_body.size() << " TOKENS)" << std::endl;
+        return;
+    }
     function_body->pretty_print(depth + 2);
 }
 void Conditional::pretty_print(int depth) const{
@@ -7,8 +7,47 @@
 #include <cassert>
 #include <string_view>
 #include <map>
+#include <atomic>
+#include <thread>
+#include <exception>
 namespace parse{
 namespace{
+//Parses the bodies split off from their definitions, and returns the error
+//(if any) from the first body in source order which failed to parse
+std::exception_ptr parse_function_bodies(const std::vector<ast::FunctionDef*>& defs, unsigned int threads,
+        const type::TypeContext& types){
+    auto errors = std::vector<std::exception_ptr>(defs.size());
+    auto next_def = std::atomic<std::size_t>{0};
+    auto worker = [&](){
+        auto arena = types.arena_scope();
+        for(auto i = next_def++; i < defs.size(); i = next_def++){
+            try{
+                auto l = lexer::TokenStream(std::move(defs.at(i)->unparsed_body));
+                defs.at(i)->unparsed_body.clear();
+                defs.at(i)->function_body = parse_compound_stmt(l);
+            }catch(...){
+                errors.at(i) = std::current_exception();
+            }
+        }
+    };
+    if(threads == 0){
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    auto workers = std::vector<std::thread>{};
+    for(unsigned int i = 1; i < threads && i < defs.size(); i++){
+        workers.emplace_back(worker);
+    }
+    worker();
+    for(auto& t : workers){
+        t.join();
+    }
+    for(const auto& e : errors){
+        if(e){
+            return e;
+        }
+    }
+    return nullptr;
+}
 } //anon namespace
 
 //Check and throw default unexpected token exception
@@ -30,6 +69,26 @@ std::unique_ptr<ast::AmbiguousBlock> parse_ambiguous_block(lexer::TokenStream& l
     return std::make_unique<ast::AmbiguousBlock>(std::move(toks));
 }
 
+//Consumes a brace enclosed token sequence, returning it (braces included) without parsing it
+std::vector<token::Token> collect_braced_tokens(lexer::TokenStream& l){
+    check_token_type(l.peek_token(), token::TokenType::LBrace);
+    auto toks = std::vector<token::Token>{};
+    int depth = 0;
+    do{
+        auto next = l.get_token();
+        if(next.type == token::TokenType::END){
+            throw parse_error::ParseError("Unmatched left brace", toks.front());
+        }
+        if(next.type == token::TokenType::LBrace){
+            depth++;
+        }else if(next.type == token::TokenType::RBrace){
+            depth--;
+        }
+        toks.push_back(std::move(next));
+    }while(depth > 0);
+    return toks;
+}
+
 std::unique_ptr<ast::BlockItem> parse_block_item(lexer::TokenStream& l){
     if(type::is_specifier(l.peek_token().value)){
         return parse_decl_list(l);
@@ -41,15 +100,38 @@ std::unique_ptr<ast::BlockItem> parse_block_item(lexer::TokenStream& l){
     }
 }
 
-std::unique_ptr<ast::Program> construct_ast(lexer::TokenStream& l){
-    type::CType::reset_tables();
+std::unique_ptr<ast::Program> construct_ast(lexer::TokenStream& l, const ParseOptions& options){
+    auto types = type::TypeContext();
+    auto arena = types.arena_scope();
     auto next = l.peek_token();
     auto global_decls = std::vector<std::unique_ptr<ast::ExtDecl>>{};
-    while(next.type != token::TokenType::END){
-        global_decls.push_back(parse_ext_decl(l));
-        next = l.peek_token();
+    if(options.parse_threads == 1){
+        while(next.type != token::TokenType::END){
+            global_decls.push_back(parse_ext_decl(l, options));
+            next = l.peek_token();
+        }
+        return std::make_unique<ast::Program>(std::move(global_decls), std::move(types));
+    }
+    //External declarations are parsed in order, with function bodies only brace matched,
+    //and then the bodies are parsed in parallel into their (already ordered) definitions
+    auto unparsed_definitions = std::vector<ast::FunctionDef*>{};
+    std::exception_ptr decl_error = nullptr;
+    try{
+        while(next.type != token::TokenType::END){
+            global_decls.push_back(parse_ext_decl(l, options, &unparsed_definitions));
+            next = l.peek_token();
+        }
+    }catch(...){
+        //Errors in earlier function bodies take precedence
+        decl_error = std::current_exception();
+    }
+    if(auto body_error = parse_function_bodies(unparsed_definitions, options.parse_threads, types)){
+        std::rethrow_exception(body_error);
+    }
+    if(decl_error){
+        std::rethrow_exception(decl_error);
     }
-    return std::make_unique<ast::Program>(std::move(global_decls));
+    return std::make_unique<ast::Program>(std::move(global_decls), std::move(types));
 }
 
 } //namespace parse
@@ -173,7 +173,9 @@ namespace{
                     std::optional<int> size = std::nullopt;
                     if(l.peek_token().type != token::TokenType::RBrack){
                         auto expr = parse_expr(l);
-                        auto temp_st = symbol::GlobalTable();
+                        //Array sizes are integer constant expressions, which can't declare or refer to tags
+                        auto temp_types = type::TypeContext();
+                        auto temp_st = symbol::GlobalTable(temp_types);
                         expr->analyze(&temp_st);
                         if(!std::holds_alternative<long long int>(expr->constant_value)){
                             throw sem_error::TypeError("Invalid constant integer expr for array size", expr->tok);
@@ -291,7 +293,8 @@ std::unique_ptr<ast::DeclList> parse_decl_list(lexer::TokenStream& l){
 }
 
 std::unique_ptr<ast::FunctionDef> parse_function_def(lexer::TokenStream& l, std::vector<Declarator> params, 
-    Declarator func, std::vector<std::unique_ptr<ast::TypeDecl>> tags){
+    Declarator func, std::vector<std::unique_ptr<ast::TypeDecl>> tags, const ParseOptions& options,
+    std::vector<ast::FunctionDef*>* unparsed_definitions){
     auto param_decls = std::vector<std::unique_ptr<ast::VarDecl>>{};
     for(const auto& param_declarator: params){
         if(!param_declarator.first.has_value()){
@@ -302,12 +305,25 @@ std::unique_ptr<ast::FunctionDef> parse_function_def(lexer::TokenStream& l, std:
         }
         param_decls.push_back(std::make_unique<ast::VarDecl>(param_declarator.first.value(),param_declarator.second));
     }
+    if(options.lazy_function_bodies && func.second.storage == std::optional<type::SSpecifier>(type::SSpecifier::Static)){
+        //Static functions can only be referenced from this translation unit,
+        //so the body is only parsed once analysis finds a reference to it
+        return std::make_unique<ast::FunctionDef>(func.first.value(), type::get<type::FuncType>(func.second), 
+            std::move(param_decls), collect_braced_tokens(l), std::move(tags));
+    }
+    if(unparsed_definitions){
+        auto def = std::make_unique<ast::FunctionDef>(func.first.value(), type::get<type::FuncType>(func.second), 
+            std::move(param_decls), collect_braced_tokens(l), std::move(tags));
+        unparsed_definitions->push_back(def.get());
+        return def;
+    }
     auto function_body = parse_compound_stmt(l);
     return std::make_unique<ast::FunctionDef>(func.first.value(), type::get<type::FuncType>(func.second), 
         std::move(param_decls), std::move(function_body), std::move(tags));
 }
 
-std::unique_ptr<ast::ExtDecl> parse_ext_decl(lexer::TokenStream& l){
+std::unique_ptr<ast::ExtDecl> parse_ext_decl(lexer::TokenStream& l, const ParseOptions& options,
+    std::vector<ast::FunctionDef*>* unparsed_definitions){
     while(l.peek_token().type == token::TokenType::Semicolon){
         l.get_token();
     }
@@ -329,7 +345,7 @@ std::unique_ptr<ast::ExtDecl> parse_ext_decl(lexer::TokenStream& l){
             if(!params.has_value()){
                 throw parse_error::ParseError("Unexpected beginning of function definition", l.peek_token());
             }
-            return parse_function_def(l, params.value(), declarator, std::move(type_decls));
+            return parse_function_def(l, params.value(), declarator, std::move(type_decls), options, unparsed_definitions);
         }
         //if((!declarator.first.has_value()) && (type_decls.size() == 0)){
         if((!declarator.first.has_value())){
@@ -2,11 +2,11 @@
 #include "type.h"
 #include "parse_error.h"
 #include "sem_error.h"
+#include "operators.h"
 #include <iostream>
 #include <algorithm>
 #include <cassert>
 #include <string_view>
-#include <map>
 namespace parse{
 namespace{
 
@@ -16,27 +16,6 @@ namespace{
     constexpr int unary_op_binding_power = 40;
     //Higher prescedence than comma, lower than assignment
     constexpr int func_call_arg_binding_power = 3;
-    //left binding is less than right binding for left associativity (+, -)
-    //and vice versa for right associativity
-    std::map<token::TokenType, std::pair<int, int>> binary_op_binding_power = {{
-        {token::TokenType::Star, {25,26}}, {token::TokenType::Div, {25,26}},
-        {token::TokenType::Mod, {25,26}}, 
-        {token::TokenType::Plus,{23,24}}, {token::TokenType::Minus,{23,24}}, 
-        {token::TokenType::LShift,{21,22}}, {token::TokenType::RShift,{21,22}}, 
-        {token::TokenType::Less, {19,20}}, {token::TokenType::Greater, {19,20}},
-        {token::TokenType::LEq, {19,20}}, {token::TokenType::GEq, {19,20}},
-        {token::TokenType::Equal, {17,18}}, {token::TokenType::NEqual, {17,18}},
-        {token::TokenType::Amp, {15,16}},
-        {token::TokenType::BitwiseXor, {13,14}}, {token::TokenType::BitwiseOr, {11,12}},
-        {token::TokenType::And, {9,10}}, {token::TokenType::Or, {7,8}},
-        {token::TokenType::Assign, {5,4}},
-        {token::TokenType::LSAssign, {5,4}},{token::TokenType::RSAssign, {5,4}},
-        {token::TokenType::BOAssign, {5,4}},{token::TokenType::BXAssign, {5,4}},
-        {token::TokenType::ModAssign, {5,4}},{token::TokenType::BAAssign, {5,4}},
-        {token::TokenType::MultAssign, {5,4}},{token::TokenType::DivAssign, {5,4}},
-        {token::TokenType::PlusAssign, {5,4}},{token::TokenType::MinusAssign, {5,4}},
-        {token::TokenType::Comma, {1,2}},
-    }};
 
 std::unique_ptr<ast::InitializerList> parse_initializer_list(lexer::TokenStream& l){
     auto inits = std::vector<std::unique_ptr<ast::Initializer>>{};
@@ -46,7 +25,7 @@ std::unique_ptr<ast::InitializerList> parse_initializer_list(lexer::TokenStream&
         if(l.peek_token().type == token::TokenType::LBrace){
             inits.push_back(parse_initializer_list(l));
         }else{
-            inits.push_back(parse_expr(l,binary_op_binding_power.at(token::TokenType::Assign).second));
+            inits.push_back(parse_expr(l,operators::binary_operator(token::TokenType::Assign).right_binding_power()));
         }
         if(token::matches_type(l.peek_token(),token::TokenType::RBrace)){
             break;
@@ -176,7 +155,7 @@ std::unique_ptr<ast::Decl> parse_init_decl(lexer::TokenStream& l, Declarator dec
             auto assign = parse_initializer_list(l);
             return std::make_unique<ast::VarDecl>(var_name, declarator.second, std::move(assign));
         }else{
-            auto assign = parse_expr(l,binary_op_binding_power.at(token::TokenType::Assign).second);
+            auto assign = parse_expr(l,operators::binary_operator(token::TokenType::Assign).right_binding_power());
             return std::make_unique<ast::VarDecl>(var_name, declarator.second, std::move(assign));
         }
     }else{
@@ -192,7 +171,7 @@ std::unique_ptr<ast::Decl> parse_init_decl(lexer::TokenStream& l, Declarator dec
 }
 std::unique_ptr<ast::BinaryOp> parse_binary_op(lexer::TokenStream& l, std::unique_ptr<ast::Expr> left, int min_bind_power){
     auto op_token = l.get_token();
-    if(binary_op_binding_power.find(op_token.type) == binary_op_binding_power.end()){
+    if(!operators::binary_operator(op_token.type).is_binary()){
         throw parse_error::ParseError("Not valid binary operator",op_token);
     }
     auto right = parse_expr(l, min_bind_power);
@@ -289,14 +268,14 @@ std::unique_ptr<ast::Expr> parse_expr(lexer::TokenStream& l, int min_bind_power)
             expr_ptr = parse_postfix(l, std::move(expr_ptr));
             continue;
         }
-        if(binary_op_binding_power.find(potential_op_token.type) == binary_op_binding_power.end()){
+        const auto& op = operators::binary_operator(potential_op_token.type);
+        if(!op.is_binary()){
             break; //Not an operator
         }
-        auto binding_power = binary_op_binding_power.at(potential_op_token.type);
-        if(binding_power.first < min_bind_power){
+        if(op.left_binding_power() < min_bind_power){
             break;
         }
-        expr_ptr = parse_binary_op(l, std::move(expr_ptr), binding_power.second);
+        expr_ptr = parse_binary_op(l, std::move(expr_ptr), op.right_binding_power());
     }
     return expr_ptr;
 }
@@ -157,7 +157,7 @@ std::pair<type::CType,std::vector<std::unique_ptr<ast::TypeDecl>>> parse_specifi
 
     auto next_tok = l.peek_token();
     auto storage_specifier = std::optional<type::SSpecifier>{std::nullopt};
-    auto type_qualifiers = std::unordered_set<type::TQualifier>{};
+    auto type_qualifiers = type::QualifierSet{};
     while(type::is_specifier(next_tok.value) || next_tok.type == token::TokenType::Identifier){
         if(next_tok.type == token::TokenType::Identifier){
             if(type_specifier_list.size() > 0 || base_type.has_value()){
@@ -206,9 +206,7 @@ std::pair<type::CType,std::vector<std::unique_ptr<ast::TypeDecl>>> parse_specifi
     if(storage_specifier.has_value()){
         base_type.value().storage = storage_specifier.value();
     }
-    for(auto& tq : type_qualifiers){
-        base_type.value().qualifiers.insert(tq);
-    }
+    base_type.value().qualifiers = type_qualifiers;
     return std::make_pair(base_type.value(),std::move(tags));
 }
 } //namespace parse
@@ -2,6 +2,8 @@
 #include "parse.h"
 #include "type.h"
 #include "sem_error.h"
+#include "operators.h"
+#include "time_trace.h"
 #include <array>
 #include <sstream>
 namespace ast{
@@ -13,19 +15,6 @@ struct overloaded : Ts...{
 
 template<class...Ts> overloaded(Ts ...) -> overloaded<Ts...>;
 
-const auto assignment_op = std::map<token::TokenType,token::TokenType>{{
-    {token::TokenType::Assign, token::TokenType::Assign},
-    {token::TokenType::PlusAssign, token::TokenType::Plus},
-    {token::TokenType::MinusAssign, token::TokenType::Minus},
-    {token::TokenType::MultAssign, token::TokenType::Star},
-    {token::TokenType::DivAssign, token::TokenType::Div},
-    {token::TokenType::ModAssign, token::TokenType::Mod},
-    {token::TokenType::LSAssign, token::TokenType::LShift},
-    {token::TokenType::RSAssign, token::TokenType::RShift},
-    {token::TokenType::BAAssign, token::TokenType::Amp},
-    {token::TokenType::BOAssign, token::TokenType::BitwiseOr},
-    {token::TokenType::BXAssign, token::TokenType::BitwiseXor},
-}};
 bool is_func_designator(const ast::AST* node){
     auto var = dynamic_cast<const ast::Variable*>(node);
     return var && type::is_type<type::PointerType>(var->type)
@@ -114,34 +103,34 @@ std::array<type::CType,3> analyze_bin_op(type::CType left, type::CType right, to
         case token::TokenType::And:
         case token::TokenType::Or:
             if(type::is_scalar(left) && type::is_scalar(right)){
-                return std::array<type::CType, 3>{type::from_str("int"), left, right};
+                return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), left, right};
             }
             throw sem_error::TypeError("Operand of scalar type required",tok);
         case token::TokenType::Equal:
         case token::TokenType::NEqual:
             if(type::is_arith(left) && type::is_arith(right)){
                 auto convert_type = type::usual_arithmetic_conversions(left, right);
-                return std::array<type::CType, 3>{type::from_str("int"), convert_type, convert_type};
+                return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), convert_type, convert_type};
             }
             if(type::is_type<type::PointerType>(left) && type::is_type<type::IType>(right)){
-                return std::array<type::CType, 3>{type::from_str("int"), left, left};
+                return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), left, left};
             }
             if(type::is_type<type::IType>(left) && type::is_type<type::PointerType>(right)){
-                return std::array<type::CType, 3>{type::from_str("int"), right, right};
+                return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), right, right};
             }
             if(type::is_type<type::PointerType>(left) && type::is_type<type::PointerType>(right)){
                 auto l = type::get<type::PointerType>(left);
                 auto r = type::get<type::PointerType>(right);
                 if(l.pointed_type() == type::CType(type::VoidType())){
-                    return std::array<type::CType, 3>{type::from_str("int"), l, l};
+                    return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), l, l};
                 }
                 if(r.pointed_type() == type::CType(type::VoidType())){
-                    return std::array<type::CType, 3>{type::from_str("int"), r, r};
+                    return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), r, r};
                 }
                 if(!type::is_compatible(l.pointed_type(),r.pointed_type())){
                     throw sem_error::TypeError("Pointer types being compared for equality must be to compatible types",tok);
                 }else{
-                    return std::array<type::CType, 3>{type::from_str("int"), l, r};
+                    return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), l, r};
                 }
             }
             throw sem_error::TypeError("Invalid types \""+type::to_string(left)+"\" and \""
@@ -153,7 +142,7 @@ std::array<type::CType,3> analyze_bin_op(type::CType left, type::CType right, to
             if(type::is_arith(left) && type::is_arith(right)){
                 //Check that they are real types
                 auto convert_type = type::usual_arithmetic_conversions(left, right);
-                return std::array<type::CType, 3>{type::from_str("int"), convert_type, convert_type};
+                return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), convert_type, convert_type};
             }
             if(type::is_type<type::PointerType>(left) && type::is_type<type::PointerType>(right)){
                 auto l = type::get<type::PointerType>(left);
@@ -161,7 +150,7 @@ std::array<type::CType,3> analyze_bin_op(type::CType left, type::CType right, to
                 if(!type::is_compatible(l.pointed_type(),r.pointed_type())){
                     throw sem_error::TypeError("Pointer types being compared for equality must be to compatible types",tok);
                 }else{
-                    return std::array<type::CType, 3>{type::from_str("int"), l, r};
+                    return std::array<type::CType, 3>{type::basic_ctype(type::IType::Int), l, r};
                 }
             }
             throw sem_error::TypeError("Invalid types \""+type::to_string(left)+"\" and \""
@@ -354,9 +343,9 @@ ConstantExprType compute_binary_constant(ConstantExprType left, ConstantExprType
     __builtin_unreachable();
 }
 template <typename T>
-T lookup_tag(type::CType t, token::Token tok){
+T lookup_tag(type::CType t, token::Token tok, const type::TypeContext& types){
     try{
-        return type::get<T>(type::CType::get_tag(type::get<T>(t).tag));
+        return type::get<T>(types.get_tag(type::get<T>(t)));
     }catch(std::exception& e){
         throw sem_error::STError("Could not find struct with name "+type::get<T>(t).tag,tok);
     }
@@ -452,7 +441,7 @@ void VarDecl::analyze(symbol::STable* st) {
     }
     //Add symbol to symbol table, check that not already present
     try{
-        st->add_symbol(this->name,this->type, this->assignment.has_value());
+        this->symbol_id = st->add_symbol(this->name,this->type, this->assignment.has_value());
     }catch(std::runtime_error& e){
         throw sem_error::STError(e.what(),this->tok);
     }
@@ -494,7 +483,7 @@ void InitializerList::initializer_analyze(type::CType& variable_type, symbol::ST
             initializers.at(i)->initializer_analyze(element_type, st);
         }
     }else if(type::is_type<type::StructType>(variable_type)){
-        auto s_type = lookup_tag<type::StructType>(variable_type, tok);
+        auto s_type = lookup_tag<type::StructType>(variable_type, tok, st->types());
         if(s_type.members.size() < length){
             length = s_type.members.size();
         }
@@ -502,7 +491,7 @@ void InitializerList::initializer_analyze(type::CType& variable_type, symbol::ST
             initializers.at(i)->initializer_analyze(s_type.members.at(i), st);
         }
     }else if(type::is_type<type::UnionType>(variable_type)){
-        auto u_type = lookup_tag<type::UnionType>(variable_type, tok);
+        auto u_type = lookup_tag<type::UnionType>(variable_type, tok, st->types());
         if(u_type.members.size() > 0){
             initializers.front()->initializer_analyze(u_type.members.front(), st);
         }
@@ -516,20 +505,23 @@ void InitializerList::initializer_analyze(type::CType& variable_type, symbol::ST
 void Variable::analyze(symbol::STable* st) {
     this->analyzed = true;
     //Check that the variable name actually exists in a symbol table
-    if(!st->has_symbol(this->variable_name)){
+    auto declaration = st->find_symbol(this->variable_name);
+    if(declaration == nullptr){
         throw sem_error::STError("Variable not found in symbol table",this->tok);
     }
-    auto type_in_table = st->symbol_type(this->variable_name);
+    this->symbol_id = declaration->id;
+    auto type_in_table = declaration->type;
     if(type::is_type<type::VoidType>(type_in_table)){
         throw sem_error::STError("Variable cannot have void type",this->tok);
     }
     if(type::is_type<type::FuncType>(type_in_table)){
+        st->add_reference(this->variable_name);
         this->type = type::PointerType(type_in_table);
         return;
     }
     this->type = type_in_table;
-    if(st->resolves_to_constant(this->variable_name)){
-        this->constant_value = st->get_constant_value(this->variable_name);
+    if(declaration->kind == symbol::Bindings::Kind::Constant){
+        this->constant_value = declaration->constant_value;
     }
 }
 void Conditional::analyze(symbol::STable* st){
@@ -564,13 +556,13 @@ void Sizeof::analyze(symbol::STable* st) {
     this->analyzed = true;
     this->arg->analyze(st);
     this->type = type::IType::LLong;
-    this->constant_value = type::size(arg->type);
+    this->constant_value = type::size(arg->type, st->types());
 }
 void Alignof::analyze(symbol::STable* st) {
     this->analyzed = true;
     this->arg->analyze(st);
     this->type = type::IType::LLong;
-    this->constant_value = type::align(arg->type);
+    this->constant_value = type::align(arg->type, st->types());
 }
 void FuncCall::analyze(symbol::STable* st) {
     this->analyzed = true;
@@ -588,25 +580,24 @@ void FuncCall::analyze(symbol::STable* st) {
     if(type::is_type<type::PointerType>(original_type)){
         original_type = type::get<type::PointerType>(original_type).pointed_type();
     }
-    try{
-        auto f_type = type::get<type::FuncType>(original_type);
-        if(!f_type.params_match(arg_types)){
-            auto error_str = "Cannot call function of type \""+type::to_string(f_type)+"\" on types of provided arguments:\n";
-            for(const auto& arg : arg_types){
-                error_str += type::to_string(arg)+"\n";
-            }
-            throw sem_error::TypeError(error_str,this->tok);
-        }
-        this->type = f_type.return_type();
-    }catch(std::runtime_error& e){ //Won't catch the STError
+    if(!type::is_type<type::FuncType>(original_type)){
         throw sem_error::STError("Function call with expression not referring to a function or function pointer",this->tok);
     }
+    const auto& f_type = type::get<type::FuncType>(original_type);
+    if(!f_type.params_match(arg_types)){
+        auto error_str = "Cannot call function of type \""+type::to_string(f_type)+"\" on types of provided arguments:\n";
+        for(const auto& arg : arg_types){
+            error_str += type::to_string(arg)+"\n";
+        }
+        throw sem_error::TypeError(error_str,this->tok);
+    }
+    this->type = f_type.return_type();
 }
 void MemberAccess::analyze(symbol::STable* st) {
     this->analyzed = true;
     this->arg->analyze(st);
     if(type::is_type<type::StructType>(this->arg->type)){
-        auto s_type = lookup_tag<type::StructType>(this->arg->type, tok);
+        auto s_type = lookup_tag<type::StructType>(this->arg->type, tok, st->types());
         try{
             this->type = s_type.members.at(s_type.indices.at(this->index));
         }catch(std::exception& e){
@@ -615,7 +606,7 @@ void MemberAccess::analyze(symbol::STable* st) {
         return;
     }
     if(type::is_type<type::UnionType>(this->arg->type)){
-        auto u_type = lookup_tag<type::UnionType>(this->arg->type, tok);
+        auto u_type = lookup_tag<type::UnionType>(this->arg->type, tok, st->types());
         try{
             this->type = u_type.members.at(u_type.indices.at(this->index));
         }catch(std::exception& e){
@@ -760,7 +751,7 @@ void UnaryOp::analyze(symbol::STable* st) {
             if(!type::is_scalar(this->arg->type)){
                 throw sem_error::TypeError("Operand of scalar type required",this->arg->tok);
             }
-            this->type = type::from_str("int");
+            this->type = type::basic_ctype(type::IType::Int);
             std::visit(type::overloaded{
                 [&](std::monostate ){},
                 [&](auto val){this->constant_value = !val;},
@@ -785,7 +776,8 @@ void BinaryOp::analyze(symbol::STable* st){
     this->analyzed = true;
     this->left->analyze(st);
     this->right->analyze(st);
-    if(assignment_op.find(this->tok.type) == assignment_op.end()){
+    const auto& op = operators::binary_operator(this->tok.type);
+    if(!op.is_assignment()){
         //Non-assignment case
         auto types = analyze_bin_op(this->left->type,this->right->type,this->tok.type, this->tok);
         this->constant_value = compute_binary_constant(this->left->constant_value, this->right->constant_value, this->tok.type);
@@ -817,8 +809,8 @@ void BinaryOp::analyze(symbol::STable* st){
 
         this->new_left_type = this->left->type;
         this->new_right_type = this->right->type;
-        if(this->tok.type != token::TokenType::Assign){
-            auto types = analyze_bin_op(this->left->type,this->right->type,assignment_op.at(this->tok.type), this->tok);
+        if(op.is_compound_assignment()){
+            auto types = analyze_bin_op(this->left->type,this->right->type,op.compound_base, this->tok);
             this->new_left_type=types[1];
             this->new_right_type=types[2];
         }
@@ -905,8 +897,12 @@ void BreakStmt::analyze(symbol::STable* st){
     }
 }
 void Program::analyze(symbol::STable* st) {
+    auto global = dynamic_cast<symbol::GlobalTable*>(st);
+    assert(global && "Program must be analyzed with the global symbol table");
+    assert(&global->types() == &types && "Program must be analyzed with its own type context");
     for(auto& decl : decls){
         decl->analyze(st);
+        global->analyze_referenced_definitions();
     }
 }
 void ForStmt::analyze(symbol::STable* st){
@@ -916,19 +912,19 @@ void ForStmt::analyze(symbol::STable* st){
 
     std::visit(overloaded{
         [](std::monostate){/*Do nothing*/},
-        [stmt_table](auto& ast_node){
-            ast_node->analyze(stmt_table);
+        [&stmt_table](auto& ast_node){
+            ast_node->analyze(stmt_table.get());
             }
     },this->init_clause);
-    control_expr->analyze(stmt_table);
+    control_expr->analyze(stmt_table.get());
     if(!type::is_scalar(this->control_expr->type)){
         throw sem_error::TypeError("Condition of scalar type required in for statement control expression",this->control_expr->tok);
     }
     if(this->post_expr.has_value()){
-        this->post_expr.value()->analyze(stmt_table);
+        this->post_expr.value()->analyze(stmt_table.get());
     }
     stmt_table->in_loop = true;
-    this->body->analyze(stmt_table);
+    this->body->analyze(stmt_table.get());
 }
 void CaseStmt::analyze(symbol::STable* st){
     auto bt = dynamic_cast<symbol::BlockTable*>(st);
@@ -973,7 +969,7 @@ void SwitchStmt::analyze(symbol::STable* st){
     assert(bt && "Case statement outside of block");
     this->control_type = type::integer_promotions(this->control_expr->type);
     auto stmt_table = bt->new_switch_scope_child();
-    switch_body->analyze(stmt_table);
+    switch_body->analyze(stmt_table.get());
     case_table = stmt_table->transfer_switch_table();
 }
 void WhileStmt::analyze(symbol::STable* st){
@@ -985,7 +981,7 @@ void WhileStmt::analyze(symbol::STable* st){
     assert(bt && "While statement outside of block");
     auto stmt_table = bt->new_block_scope_child();
     stmt_table->in_loop = true;
-    body->analyze(stmt_table);
+    body->analyze(stmt_table.get());
 }
 void DoStmt::analyze(symbol::STable* st){
     control_expr->analyze(st);
@@ -996,12 +992,15 @@ void DoStmt::analyze(symbol::STable* st){
     assert(bt && "Case statement outside of block");
     auto stmt_table = bt->new_block_scope_child();
     stmt_table->in_loop = true;
-    body->analyze(stmt_table);
+    body->analyze(stmt_table.get());
 }
 void CompoundStmt::analyze(symbol::STable* st){
     auto bt = dynamic_cast<symbol::BlockTable*>(st);
     assert(bt && "Case statement outside of block");
     auto stmt_table = bt->new_block_scope_child();
+    this->analyze_stmts(stmt_table.get());
+}
+void CompoundStmt::analyze_stmts(symbol::BlockTable* stmt_table){
     for(auto& stmt : stmt_body){
         stmt->analyze(stmt_table);
     }
@@ -1030,7 +1029,7 @@ void FunctionDecl::analyze(symbol::STable* st){
     }
     //Add to global symbol table
     try{
-        st->add_symbol(this->name,this->type);
+        this->symbol_id = st->add_symbol(this->name,this->type);
     }catch(std::runtime_error& e){
         throw sem_error::STError(e.what(),this->tok);
     }
@@ -1050,7 +1049,7 @@ void FunctionDef::analyze(symbol::STable* st) {
         throw sem_error::FlowError("Function definition inside function",this->tok);
     }
     try{
-        st->add_symbol(this->name,this->type, true);
+        this->symbol_id = st->add_symbol(this->name,this->type, true);
     }catch(std::runtime_error& e){
         throw sem_error::STError(e.what(),this->tok);
     }
@@ -1060,13 +1059,34 @@ void FunctionDef::analyze(symbol::STable* st) {
         }
     }
     auto global = dynamic_cast<symbol::GlobalTable*>(st);
+    if(!function_body){
+        global->defer_definition(this->name, [this, global](){this->analyze_body(global);});
+        return;
+    }
+    this->analyze_body(global);
+}
+void FunctionDef::analyze_body(symbol::GlobalTable* global) {
+    auto span = time_trace::Scope("Analyze function", this->name, this->tok.loc);
+    if(!function_body){
+        lexer::TokenStream l(std::move(this->unparsed_body));
+        this->unparsed_body.clear();
+        function_body = parse::parse_compound_stmt(l);
+    }
+    auto f_type = type::get<type::FuncType>(this->type);
     auto function_table = global->new_function_scope_child(f_type.return_type());
     for(const auto& decl : params){
-        decl->analyze(function_table);
+        decl->analyze(function_table.get());
     }
-    function_body->analyze(function_table);
+    //Parameters share a scope with the outermost block of the body, so they are
+    //added to that block after it is analyzed to check that none are redeclared
+    auto body_table = function_table->new_block_scope_child();
+    function_body->analyze_stmts(body_table.get());
     for(const auto& decl : params){
-        decl->analyze(function_table->most_recent_child());
+        try{
+            body_table->add_symbol(decl->name, decl->type);
+        }catch(std::runtime_error& e){
+            throw sem_error::STError(e.what(),decl->tok);
+        }
     }
     std::optional<token::Token> error_tok;
     if((error_tok = function_table->unmatched_label())!= std::nullopt){
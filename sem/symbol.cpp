@@ -1,5 +1,6 @@
 #include "symbol.h"
 #include <iostream>
+#include <utility>
 namespace symbol{
 template <class... Ts>
 struct overloaded : Ts...{
@@ -7,14 +8,115 @@ struct overloaded : Ts...{
 };
 
 template<class...Ts> overloaded(Ts ...) -> overloaded<Ts...>;
+//How a tag is first declared, before any definition of it is added
+template<typename T>
+T incomplete_tag(const std::string& mangled_tag, type::TagId id){
+    if constexpr(std::is_same_v<T, type::EnumType>){
+        return T{mangled_tag};
+    }else{
+        return T(mangled_tag, id);
+    }
+}
+bool Bindings::hidden(std::size_t depth, std::size_t position) const noexcept{
+    //Only the file scope outlives a deferred definition, so declarations in any other scope are always visible
+    return depth == 0 && position >= visible_globals;
+}
+Bindings::NameId Bindings::intern(const std::string& name){
+    auto [found, inserted] = names.try_emplace(name, symbols.size());
+    if(inserted){
+        symbols.emplace_back();
+        tags.emplace_back();
+    }
+    return found->second;
+}
+std::optional<Bindings::NameId> Bindings::name_id(const std::string& name) const{
+    auto found = names.find(name);
+    if(found == names.end()){
+        return std::nullopt;
+    }
+    return found->second;
+}
+const Bindings::Symbol* Bindings::find(NameId name) const{
+    const auto& chain = symbols[name];
+    if(chain.empty() || hidden(chain.back().depth, chain.back().position)){
+        return nullptr;
+    }
+    return &chain.back();
+}
+const Bindings::Symbol* Bindings::find(const std::string& name) const{
+    auto id = name_id(name);
+    return id ? this->find(*id) : nullptr;
+}
+const Bindings::Symbol* Bindings::find(const std::string& name, std::size_t depth) const{
+    auto symbol = this->find(name);
+    //Declarations of closed scopes have been unwound, so one at this depth belongs to the current scope
+    if(symbol == nullptr || symbol->depth != depth){
+        return nullptr;
+    }
+    return symbol;
+}
+SymbolId Bindings::declare(NameId name, Symbol symbol){
+    symbol.id = symbol_count++;
+    symbol.position = undo_log.size();
+    auto& chain = symbols[name];
+    chain.push_back(std::move(symbol));
+    undo_log.push_back(Declaration{name, false});
+    return chain.back().id;
+}
+SymbolId Bindings::declare(const std::string& name, Symbol symbol){
+    return this->declare(intern(name), std::move(symbol));
+}
+std::optional<type::TagId> Bindings::find_tag(NameId name) const{
+    const auto& chain = tags[name];
+    if(chain.empty() || hidden(chain.back().depth, chain.back().position)){
+        return std::nullopt;
+    }
+    return chain.back().id;
+}
+std::optional<type::TagId> Bindings::find_tag(const std::string& name) const{
+    auto id = name_id(name);
+    return id ? this->find_tag(*id) : std::nullopt;
+}
+std::optional<type::TagId> Bindings::find_tag(const std::string& name, std::size_t depth) const{
+    auto id = name_id(name);
+    if(!id || tags[*id].empty() || tags[*id].back().depth != depth){
+        return std::nullopt;
+    }
+    return this->find_tag(*id);
+}
+void Bindings::declare_tag(NameId name, Tag tag){
+    tag.position = undo_log.size();
+    tags[name].push_back(tag);
+    undo_log.push_back(Declaration{name, true});
+}
+void Bindings::declare_tag(const std::string& name, Tag tag){
+    this->declare_tag(intern(name), tag);
+}
+std::size_t Bindings::mark() const noexcept{
+    return undo_log.size();
+}
+void Bindings::unwind(std::size_t mark){
+    while(undo_log.size() > mark){
+        auto last = undo_log.back();
+        if(last.is_tag){
+            tags[last.name].pop_back();
+        }else{
+            symbols[last.name].pop_back();
+        }
+        undo_log.pop_back();
+    }
+}
+std::size_t Bindings::hide_globals_from(std::size_t mark) noexcept{
+    return std::exchange(visible_globals, mark);
+}
 std::set<std::optional<unsigned long long int>>* BlockTable::get_switch() const{
     if(switch_cases != nullptr) return switch_cases.get();
     BlockTable* p = dynamic_cast<BlockTable*>(parent);
     if(p == nullptr) return nullptr;
     return p->get_switch();
 }
-STable* STable::most_recent_child(){
-    return children.back().get();
+type::TypeContext& STable::types() const noexcept{
+    return *type_context;
 }
 bool BlockTable::in_switch() const{
     return get_switch() != nullptr;
@@ -33,11 +135,13 @@ void BlockTable::add_case(std::optional<unsigned long long int> case_val){
         throw std::runtime_error("Case already defined for this switch statement");
     }
 }
-BlockTable* BlockTable::new_block_scope_child(){
-    children.push_back(std::make_unique<BlockTable>(this->global, this->current_func, this));
-    return dynamic_cast<BlockTable*>(children.back().get());
+BlockTable::~BlockTable(){
+    bindings->unwind(bindings_mark);
 }
-BlockTable* BlockTable::new_switch_scope_child(){
+std::unique_ptr<BlockTable> BlockTable::new_block_scope_child(){
+    return std::make_unique<BlockTable>(this->global, this->current_func, this);
+}
+std::unique_ptr<BlockTable> BlockTable::new_switch_scope_child(){
     auto child = new_block_scope_child();
     child->switch_cases = std::make_unique<std::set<std::optional<unsigned long long int>>>();
     return child;
@@ -45,10 +149,8 @@ BlockTable* BlockTable::new_switch_scope_child(){
 std::unique_ptr<std::set<std::optional<unsigned long long int>>> BlockTable::transfer_switch_table(){
     return std::move(switch_cases);
 }
-FuncTable* GlobalTable::new_function_scope_child(type::CType t){
-    children.push_back(std::make_unique<FuncTable>(this, t));
-    //Check that we're not already in a function
-    return dynamic_cast<FuncTable*>(children.back().get());
+std::unique_ptr<FuncTable> GlobalTable::new_function_scope_child(type::CType t){
+    return std::make_unique<FuncTable>(this, t);
 }
 std::optional<token::Token> BlockTable::unmatched_label() const{
     for(const auto& map_pair : current_func->function_labels){
@@ -72,43 +174,84 @@ void BlockTable::add_label(const std::string& name){
     }
     current_func->function_labels.insert_or_assign(name,std::nullopt);
 }
-void STable::add_typedef(std::string name, type::CType type){
-    auto insertion_success = typedefs.insert(name).second;
-    if(insertion_success == false){
-        if(type != sym_map.at(name).first){
-            throw std::runtime_error("Typedef "+name+" of incompatible type already present in symbol table");
+void STable::declare_missing_tags(const type::CType& type){
+    auto declare = [&](const std::string& tag, auto incomplete){
+        auto id = this->find_tag(tag);
+        if(!id || !this->types().tag_declared(*id)){
+            this->add_tag(tag, incomplete);
         }
-    }else{
-        if(sym_map.find(name) != sym_map.end()){
+    };
+    type::visit(type::make_visitor<void>(
+        [](type::BasicType){},
+        [](type::VoidType){},
+        [&](const type::FuncType& t){
+            this->declare_missing_tags(t.return_type());
+            if(t.has_prototype()){
+                for(const auto& param : t.param_types()){
+                    this->declare_missing_tags(param);
+                }
+            }
+        },
+        [&](const type::PointerType& t){
+            this->declare_missing_tags(t.pointed_type());
+        },
+        [&](const type::ArrayType& t){
+            this->declare_missing_tags(t.pointed_type());
+        },
+        [&](const type::StructType& t){
+            declare(t.tag, type::StructType(t.tag));
+        },
+        [&](const type::UnionType& t){
+            declare(t.tag, type::UnionType(t.tag));
+        },
+        [](const type::UnevaluatedTypedef&){}
+    ), type);
+}
+void STable::add_typedef(std::string name, type::CType type){
+    //A typedef can name a tag before it is defined, which declares the tag in this scope
+    this->declare_missing_tags(type);
+    type = this->mangle_type_or_throw(type);
+    auto existing = bindings->find(name, depth);
+    if(existing != nullptr){
+        if(existing->kind != Bindings::Kind::Typedef){
             throw std::runtime_error("Symbol "+name+" already defined as variable, cannot be redefined as typedef");
         }
+        if(type != existing->type){
+            throw std::runtime_error("Typedef "+name+" of incompatible type already present in symbol table");
+        }
+        return;
     }
-    sym_map.emplace(name,std::make_pair(type,true));
+    bindings->declare(name, Bindings::Symbol{type, true, Bindings::Kind::Typedef, 0, depth});
 }
-void STable::add_symbol(std::string name, type::CType type, bool has_def){
+SymbolId STable::add_symbol(std::string name, type::CType type, bool has_def){
     //Symbol checking
-    if(sym_map.find(name) != sym_map.end()){
-        auto existing_decl = sym_map.at(name);
+    auto existing_decl = bindings->find(name, depth);
+    if(existing_decl != nullptr){
         if(this->parent != nullptr){
             //There cannot be an existing declaration of a local variable;
             //Since we know that there exists a declaration, the current symbol table must be the global symbol table
             //Or we have an error
             throw std::runtime_error("Symbol "+name+" of incompatible type already present in non-global symbol table");
         }
-        if(has_def && existing_decl.second){
-            if(typedefs.count(name) > 0){
+        if(has_def && existing_decl->has_def){
+            if(existing_decl->kind == Bindings::Kind::Typedef){
                 throw std::runtime_error("Symbol "+name+" already defined as typedef");
             }else{
                 throw std::runtime_error("Symbol "+name+" already defined");
             }
         }
-        if(!type::is_compatible(existing_decl.first, type)){
+        if(!type::is_compatible(existing_decl->type, type)){
             throw std::runtime_error("Symbol "+name+" of incompatible type already present in symbol table");
         }else{
             //type = type::make_composite(type, existing_type);
         }
+        //The first declaration in a scope is the one that is kept
+        return existing_decl->id;
     }
-    sym_map.emplace(name,std::make_pair(type,has_def));
+    return bindings->declare(name, Bindings::Symbol{type, has_def, Bindings::Kind::Variable, 0, depth});
+}
+const Bindings::Symbol* STable::find_symbol(const std::string& name) const{
+    return bindings->find(name);
 }
 void GlobalTable::add_extern_decl(const std::string& name, const type::CType& type) {
     if(external_type_map.find(name) != external_type_map.end()){
@@ -124,17 +267,55 @@ void GlobalTable::add_extern_decl(const std::string& name, const type::CType& ty
 void BlockTable::add_extern_decl(const std::string& name, const type::CType& type) {
     global->add_extern_decl(name, type);
 }
-type::CType STable::get_tag(std::string unmangled_tag) const{
-    return type::CType::get_tag(this->mangle_name(unmangled_tag));
+void GlobalTable::add_reference(const std::string& name) {
+    if(!referenced_symbols.insert(name).second){
+        return;
+    }
+    auto deferred = deferred_definitions.find(name);
+    if(deferred != deferred_definitions.end()){
+        referenced_definitions.push_back(std::move(deferred->second));
+        deferred_definitions.erase(deferred);
+    }
 }
-std::string BlockTable::mangle_name(std::string name) const noexcept{
-    if(this->tags.find(name) != this->tags.end()){
-        return  name + "."+std::to_string(this->tags.at(name));
+void BlockTable::add_reference(const std::string& name) {
+    global->add_reference(name);
+}
+void GlobalTable::defer_definition(const std::string& name, std::function<void()> analyze_definition){
+    //The definition is analyzed against the file scope as it is now, rather than as it is when it is first referenced,
+    //so that deferring it never accepts a program analyzing it straight away would not
+    analyze_definition = [this, visible = bindings->mark(), analyze = std::move(analyze_definition)](){
+        auto previous = bindings->hide_globals_from(visible);
+        try{
+            analyze();
+        }catch(...){
+            bindings->hide_globals_from(previous);
+            throw;
+        }
+        bindings->hide_globals_from(previous);
+    };
+    if(referenced_symbols.find(name) != referenced_symbols.end()){
+        referenced_definitions.push_back(std::move(analyze_definition));
+    }else{
+        deferred_definitions.emplace(name, std::move(analyze_definition));
+    }
+}
+void GlobalTable::analyze_referenced_definitions(){
+    //Analyzing a definition can reference (and so queue) further definitions
+    while(!referenced_definitions.empty()){
+        auto analyze_definition = std::move(referenced_definitions.front());
+        referenced_definitions.pop_front();
+        analyze_definition();
     }
-    return parent->mangle_name(name);
 }
-std::string GlobalTable::mangle_name(std::string name) const noexcept{
-    return name;
+type::CType STable::get_tag(std::string unmangled_tag) const{
+    auto id = this->find_tag(unmangled_tag);
+    if(!id){
+        throw std::runtime_error("Unmangled tag "+unmangled_tag+" not found in symbol table");
+    }
+    return this->types().get_tag(*id);
+}
+std::optional<type::TagId> STable::find_tag(const std::string& name) const{
+    return bindings->find_tag(name);
 }
 type::CType STable::mangle_type_or_throw(type::CType type) const{
     return type::visit(type::make_visitor<type::CType>(
@@ -163,48 +344,53 @@ type::CType STable::mangle_type_or_throw(type::CType type) const{
             }
         },
         [&](const type::StructType& t){
-            auto mangled_tag = this->mangle_name(t.tag);
-            if(!type::CType::tag_declared(mangled_tag)){
-                throw std::runtime_error("Mangled tag "+mangled_tag+" not found in symbol table");
+            auto id = this->find_tag(t.tag);
+            if(!id || !this->types().tag_declared(*id)){
+                throw std::runtime_error("Mangled tag "+t.tag+" not found in symbol table");
             }
+            const auto& mangled_tag = this->types().tag_name(*id);
             if(t.is_complete()){
                 auto mangled_members = t.members;
                 for(auto& member : mangled_members){
                     member = this->mangle_type_or_throw(member);
                 }
-                return type::StructType(mangled_tag, mangled_members,t.indices);
+                return type::StructType(mangled_tag, mangled_members,t.indices, id);
             }else{
-                return type::StructType(mangled_tag);
+                return type::StructType(mangled_tag, id);
             }
         },
         [&](const type::UnionType& t){
-            auto mangled_tag = this->mangle_name(t.tag);
-            if(!type::CType::tag_declared(mangled_tag)){
-                throw std::runtime_error("Mangled tag "+mangled_tag+" not found in symbol table");
+            auto id = this->find_tag(t.tag);
+            if(!id || !this->types().tag_declared(*id)){
+                throw std::runtime_error("Mangled tag "+t.tag+" not found in symbol table");
             }
+            const auto& mangled_tag = this->types().tag_name(*id);
             if(t.is_complete()){
                 auto mangled_members = t.members;
                 for(auto& member : mangled_members){
                     member = this->mangle_type_or_throw(member);
                 }
-                return type::UnionType(mangled_tag, mangled_members,t.indices);
+                return type::UnionType(mangled_tag, mangled_members,t.indices, id);
             }else{
-                return type::UnionType(mangled_tag);
+                return type::UnionType(mangled_tag, id);
             }
         },
         [&](const type::UnevaluatedTypedef& t){
-            auto actual_type = this->symbol_type(t.get_name());
-            return mangle_type_or_throw(actual_type);
+            return this->symbol_type(t.get_name());
         }
     ), type);
 }
 void GlobalTable::add_tag(std::string unmangled_tag, type::TagType type){
     std::visit(type::overloaded{
         [&](const auto& t){
-            auto mangled_tag = this->mangle_name(unmangled_tag);
-            type::CType::add_tag(mangled_tag, std::decay_t<decltype(t)>{mangled_tag});
+            //Global tags are not mangled
+            auto id = this->types().intern_tag(unmangled_tag);
+            if(!bindings->find_tag(unmangled_tag, depth)){
+                bindings->declare_tag(unmangled_tag, Bindings::Tag{id, depth});
+            }
+            this->types().add_tag(id, incomplete_tag<std::decay_t<decltype(t)>>(unmangled_tag, id));
             if constexpr(!std::is_same_v<std::decay_t<decltype(t)>,type::EnumType>){
-                type::CType::add_tag(mangled_tag, type::get<std::decay_t<decltype(t)>>(this->mangle_type_or_throw(t)));
+                this->types().add_tag(id, type::get<std::decay_t<decltype(t)>>(this->mangle_type_or_throw(t)));
             }
         },
     }, type);
@@ -212,83 +398,56 @@ void GlobalTable::add_tag(std::string unmangled_tag, type::TagType type){
 void BlockTable::add_tag(std::string tag, type::TagType type){
     std::visit(type::overloaded{
         [&](const auto& t){
-            if(tags.find(tag) == tags.end()){
-                this->global->local_tag_count[tag] += 1; 
-                this->tags.emplace(tag, this->global->local_tag_count[tag]);
+            //Tags declared in a block are mangled with a per-name count to keep them distinct
+            auto id = bindings->find_tag(tag, depth);
+            if(!id){
+                auto count = ++this->global->local_tag_count[tag];
+                id = this->types().intern_tag(tag + "." + std::to_string(count));
+                bindings->declare_tag(tag, Bindings::Tag{*id, depth});
             }
-            auto mangled_tag = this->mangle_name(tag);
-            type::CType::add_tag(mangled_tag, std::decay_t<decltype(t)>{mangled_tag});
+            this->types().add_tag(*id, incomplete_tag<std::decay_t<decltype(t)>>(this->types().tag_name(*id), *id));
 
             if constexpr(!std::is_same_v<std::decay_t<decltype(t)>,type::EnumType>){
                 //Must add the mangled tag first in order to properly mangle the struct
                 auto mangled_struct = type::get<std::decay_t<decltype(t)>>(this->mangle_type_or_throw(t));
-                type::CType::add_tag(mangled_tag, mangled_struct);
+                this->types().add_tag(*id, mangled_struct);
             }
         },
     }, type);
 }
 bool STable::resolves_to_typedef(std::string name) const{
-    //Find the inner most symbol table which contains name, and returns true if it is a typedef name in that scope
-    const STable* to_search = this;
-    while(to_search != nullptr){
-        if(to_search->sym_map.find(name) != to_search->sym_map.end()){
-            return to_search->typedefs.count(name) > 0;
-        }
-        to_search = to_search->parent;
-    }
-    return false;
+    //Find the inner most declaration of name, and returns true if it is a typedef name
+    auto symbol = bindings->find(name);
+    return symbol != nullptr && symbol->kind == Bindings::Kind::Typedef;
 }
 void STable::add_constant(std::string name, int val){
-    if(sym_map.find(name) != sym_map.end()){
+    if(bindings->find(name, depth) != nullptr){
         throw std::runtime_error("Variable "+name+" of already present in symbol table, cannot add as constant with value "+std::to_string(val));
     }
-    constants.emplace(name, val);
-    sym_map.emplace(name,std::make_pair(type::IType::Int,true));
+    bindings->declare(name, Bindings::Symbol{type::IType::Int, true, Bindings::Kind::Constant, val, depth});
 }
 bool STable::resolves_to_constant(std::string name) const{
-    //Find the inner most symbol table which contains name, and returns true if it is a constant name in that scope
-    const STable* to_search = this;
-    while(to_search != nullptr){
-        if(to_search->sym_map.find(name) != to_search->sym_map.end()){
-            return to_search->constants.find(name) != to_search->constants.end();
-        }
-        to_search = to_search->parent;
-    }
-    return false;
+    //Find the inner most declaration of name, and returns true if it is a constant name
+    auto symbol = bindings->find(name);
+    return symbol != nullptr && symbol->kind == Bindings::Kind::Constant;
 }
 int STable::get_constant_value(std::string name) const{
-    //Find the inner most symbol table which contains name, and returns true if it is a constant name in that scope
-    const STable* to_search = this;
-    while(to_search != nullptr){
-        if(to_search->sym_map.find(name) != to_search->sym_map.end()){
-            return to_search->constants.at(name);
-        }
-        to_search = to_search->parent;
+    auto symbol = bindings->find(name);
+    if(symbol == nullptr || symbol->kind != Bindings::Kind::Constant){
+        throw std::runtime_error("Symbol for constant value "+name+" not found in symbol table");
     }
-    throw std::runtime_error("Symbol for constant value "+name+" not found in symbol table");
-    __builtin_unreachable();
+    return symbol->constant_value;
 }
 bool STable::has_symbol(std::string name){
-    STable* to_search = this;
-    while(to_search != nullptr){
-        if(to_search->sym_map.find(name) != to_search->sym_map.end()){
-            return true;
-        }
-        to_search = to_search->parent;
-    }
-    return false;
+    return bindings->find(name) != nullptr;
 }
 
 type::CType STable::symbol_type(std::string name) const{
-    const STable* to_search = this;
-    while(to_search != nullptr){
-        if(to_search->sym_map.find(name) != to_search->sym_map.end()){
-            return to_search->sym_map.at(name).first;
-        }
-        to_search = to_search->parent;
+    auto symbol = bindings->find(name);
+    if(symbol == nullptr){
+        throw std::runtime_error("Symbol "+name+" not found in symbol table");
     }
-    throw std::runtime_error("Symbol "+name+" not found in symbol table");
-    __builtin_unreachable();
+    return symbol->type;
 }
 type::CType BlockTable::return_type(){
     assert(current_func && "Somehow have block outside of function");
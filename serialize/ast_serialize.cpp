@@ -0,0 +1,599 @@
+#include "serialize.h"
+#include "ast.h"
+#include <stdexcept>
+namespace serialize{
+enum class NodeKind : std::uint8_t{
+    Null, Program, NullStmt, TypedefDecl, TagDecl, EnumVarDecl, DeclList, FunctionDecl, VarDecl, FunctionDef,
+    DoStmt, WhileStmt, ForStmt, IfStmt, CaseStmt, DefaultStmt, SwitchStmt, CompoundStmt,
+    LabeledStmt, GotoStmt, ContinueStmt, BreakStmt, ReturnStmt, AmbiguousBlock,
+    Conditional, Variable, StrLiteral, Constant, MemberAccess, ArrayAccess, Alignof, Sizeof,
+    FuncCall, Postfix, UnaryOp, BinaryOp, InitializerList
+};
+namespace{
+void write_kind(Writer& w, NodeKind kind){
+    w.write_byte(static_cast<std::uint8_t>(kind));
+}
+//The parts of an expression filled in by analysis
+void write_expr_state(Writer& w, const ast::Expr& expr){
+    w.write_type(expr.type);
+    w.write_bool(expr.analyzed);
+    w.write_constant(expr.constant_value);
+}
+void read_expr_state(Reader& r, ast::Expr& expr){
+    expr.type = r.read_type();
+    expr.analyzed = r.read_bool();
+    expr.constant_value = r.read_constant();
+}
+template<typename T>
+void write_nodes(Writer& w, const std::vector<std::unique_ptr<T>>& nodes){
+    w.write_uint(nodes.size());
+    for(const auto& node : nodes){
+        w.write_node(node.get());
+    }
+}
+//Types read back are checked before type::get, which assumes the type is right
+template<typename T>
+type::get_result_t<T> expect_type(const type::CType& type, const std::string& what){
+    if(!type::is_type<T>(type)){
+        malformed("expected "+what);
+    }
+    return type::get<T>(type);
+}
+template<typename T>
+void write_optional_node(Writer& w, const std::optional<std::unique_ptr<T>>& node){
+    w.write_node(node.has_value() ? node.value().get() : nullptr);
+}
+} //anon namespace
+
+void Writer::write_node(const ast::AST* node){
+    if(!node){
+        write_kind(*this, NodeKind::Null);
+        return;
+    }
+    node->serialize(*this);
+}
+void Writer::write_initializer(const ast::Initializer* init){
+    if(!init){
+        write_kind(*this, NodeKind::Null);
+        return;
+    }
+    init->initializer_serialize(*this);
+}
+
+std::unique_ptr<ast::Initializer> Reader::read_initializer(){
+    if(position < data.size() && static_cast<NodeKind>(data[position]) == NodeKind::InitializerList){
+        position++;
+        auto tok = read_token();
+        auto inits = std::vector<std::unique_ptr<ast::Initializer>>(read_count());
+        for(auto& init : inits){
+            init = read_initializer();
+        }
+        return std::make_unique<ast::InitializerList>(tok, std::move(inits));
+    }
+    return read_node_as<ast::Expr>();
+}
+
+std::unique_ptr<ast::AST> Reader::read_node(){
+    auto read_nodes = [this](auto type_tag){
+        using T = typename decltype(type_tag)::element_type;
+        auto nodes = std::vector<std::unique_ptr<T>>(read_count());
+        for(auto& node : nodes){
+            node = read_node_as<T>();
+        }
+        return nodes;
+    };
+    auto read_optional_node = [this](auto type_tag){
+        using T = typename decltype(type_tag)::element_type;
+        auto node = read_node_as<T>();
+        auto result = std::optional<std::unique_ptr<T>>();
+        if(node){
+            result = std::move(node);
+        }
+        return result;
+    };
+    auto kind = static_cast<NodeKind>(read_byte());
+    switch(kind){
+        case NodeKind::Null:
+            return nullptr;
+        case NodeKind::Program:
+            return std::make_unique<ast::Program>(read_nodes(std::unique_ptr<ast::ExtDecl>()));
+        case NodeKind::NullStmt:
+            return std::make_unique<ast::NullStmt>();
+        case NodeKind::TypedefDecl:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::TypedefDecl>(tok, read_type());
+            }
+        case NodeKind::TagDecl:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::TagDecl>(tok, read_tag_type());
+            }
+        case NodeKind::EnumVarDecl:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::EnumVarDecl>(tok, read_node_as<ast::Expr>());
+            }
+        case NodeKind::DeclList:
+            {
+                auto tags = read_nodes(std::unique_ptr<ast::TypeDecl>());
+                auto analyzed = read_bool();
+                auto node = std::make_unique<ast::DeclList>(read_nodes(std::unique_ptr<ast::Decl>()), std::move(tags));
+                node->analyzed = analyzed;
+                return node;
+            }
+        case NodeKind::FunctionDecl:
+            {
+                auto tok = read_token();
+                auto type = read_type();
+                auto node = std::make_unique<ast::FunctionDecl>(tok, expect_type<type::FuncType>(type, "function type"));
+                node->type = type;
+                node->analyzed = read_bool();
+                node->symbol_id = read_uint();
+                return node;
+            }
+        case NodeKind::VarDecl:
+            {
+                auto tok = read_token();
+                auto type = read_type();
+                auto analyzed = read_bool();
+                auto symbol_id = read_uint();
+                auto init = read_initializer();
+                auto assignment = std::optional<std::unique_ptr<ast::Initializer>>();
+                if(init){
+                    assignment = std::move(init);
+                }
+                auto node = std::make_unique<ast::VarDecl>(tok, type, std::move(assignment));
+                node->analyzed = analyzed;
+                node->symbol_id = symbol_id;
+                return node;
+            }
+        case NodeKind::FunctionDef:
+            {
+                auto tags = read_nodes(std::unique_ptr<ast::TypeDecl>());
+                auto tok = read_token();
+                auto type = read_type();
+                auto analyzed = read_bool();
+                auto symbol_id = read_uint();
+                auto params = read_nodes(std::unique_ptr<ast::VarDecl>());
+                auto body = read_node_as<ast::CompoundStmt>();
+                auto body_tokens = read_tokens();
+                auto f_type = expect_type<type::FuncType>(type, "function type");
+                auto node = body ?
+                    std::make_unique<ast::FunctionDef>(tok, f_type, std::move(params), std::move(body), std::move(tags))
+                    : std::make_unique<ast::FunctionDef>(tok, f_type, std::move(params), std::move(body_tokens), std::move(tags));
+                node->type = type;
+                node->FunctionDecl::analyzed = analyzed;
+                node->symbol_id = symbol_id;
+                return node;
+            }
+        case NodeKind::DoStmt:
+            {
+                auto control = read_node_as<ast::Expr>();
+                return std::make_unique<ast::DoStmt>(std::move(control), read_node_as<ast::Stmt>());
+            }
+        case NodeKind::WhileStmt:
+            {
+                auto control = read_node_as<ast::Expr>();
+                return std::make_unique<ast::WhileStmt>(std::move(control), read_node_as<ast::Stmt>());
+            }
+        case NodeKind::ForStmt:
+            {
+                auto init_clause = ast::ForStmt::InitClauseTypes();
+                switch(read_byte()){
+                    case 0:
+                        break;
+                    case 1:
+                        init_clause = read_node_as<ast::DeclList>();
+                        break;
+                    case 2:
+                        init_clause = read_node_as<ast::Expr>();
+                        break;
+                    case 3:
+                        init_clause = read_node_as<ast::AmbiguousBlock>();
+                        break;
+                    default:
+                        malformed("unknown for loop initializer");
+                }
+                auto control = read_node_as<ast::Expr>();
+                auto post = read_optional_node(std::unique_ptr<ast::Expr>());
+                return std::make_unique<ast::ForStmt>(std::move(init_clause), std::move(control),
+                    std::move(post), read_node_as<ast::Stmt>());
+            }
+        case NodeKind::IfStmt:
+            {
+                auto cond = read_node_as<ast::Expr>();
+                auto if_body = read_node_as<ast::Stmt>();
+                return std::make_unique<ast::IfStmt>(std::move(cond), std::move(if_body),
+                    read_optional_node(std::unique_ptr<ast::Stmt>()));
+            }
+        case NodeKind::CaseStmt:
+            {
+                auto tok = read_token();
+                auto label = read_node_as<ast::Expr>();
+                return std::make_unique<ast::CaseStmt>(tok, std::move(label), read_node_as<ast::Stmt>());
+            }
+        case NodeKind::DefaultStmt:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::DefaultStmt>(tok, read_node_as<ast::Stmt>());
+            }
+        case NodeKind::SwitchStmt:
+            {
+                auto control = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::SwitchStmt>(std::move(control), read_node_as<ast::Stmt>());
+                node->control_type = expect_type<type::BasicType>(read_type(), "switch control type");
+                if(read_bool()){
+                    node->case_table = std::make_unique<std::set<std::optional<unsigned long long int>>>();
+                    auto case_count = read_uint();
+                    for(std::uint64_t i = 0; i < case_count; i++){
+                        if(read_bool()){
+                            node->case_table->insert(read_uint());
+                        }else{
+                            node->case_table->insert(std::nullopt);
+                        }
+                    }
+                }
+                return node;
+            }
+        case NodeKind::CompoundStmt:
+            return std::make_unique<ast::CompoundStmt>(read_nodes(std::unique_ptr<ast::BlockItem>()));
+        case NodeKind::LabeledStmt:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::LabeledStmt>(tok, read_node_as<ast::Stmt>());
+            }
+        case NodeKind::GotoStmt:
+            return std::make_unique<ast::GotoStmt>(read_token());
+        case NodeKind::ContinueStmt:
+            return std::make_unique<ast::ContinueStmt>(read_token());
+        case NodeKind::BreakStmt:
+            return std::make_unique<ast::BreakStmt>(read_token());
+        case NodeKind::ReturnStmt:
+            {
+                auto tok = read_token();
+                return std::make_unique<ast::ReturnStmt>(tok, read_optional_node(std::unique_ptr<ast::Expr>()));
+            }
+        case NodeKind::AmbiguousBlock:
+            {
+                auto node = std::make_unique<ast::AmbiguousBlock>(read_tokens());
+                node->parsed_item = read_node_as<ast::BlockItem>();
+                return node;
+            }
+        case NodeKind::Conditional:
+            {
+                auto tok = read_token();
+                auto cond = read_node_as<ast::Expr>();
+                auto true_expr = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::Conditional>(tok, std::move(cond), std::move(true_expr), read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::Variable:
+            {
+                auto node = std::make_unique<ast::Variable>(read_token());
+                node->symbol_id = read_uint();
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::StrLiteral:
+            {
+                auto node = std::make_unique<ast::StrLiteral>(std::vector<token::Token>{read_token()});
+                node->literal = read_string();
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::Constant:
+            {
+                auto node = std::make_unique<ast::Constant>(read_token());
+                node->literal = read_string();
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::MemberAccess:
+            {
+                auto tok = read_token();
+                auto arg = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::MemberAccess>(tok, std::move(arg), read_string());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::ArrayAccess:
+            {
+                auto tok = read_token();
+                auto arg = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::ArrayAccess>(tok, std::move(arg), read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::Alignof:
+            {
+                auto tok = read_token();
+                auto node = std::make_unique<ast::Alignof>(tok, read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::Sizeof:
+            {
+                auto tok = read_token();
+                auto node = std::make_unique<ast::Sizeof>(tok, read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::FuncCall:
+            {
+                auto tok = read_token();
+                auto func = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::FuncCall>(tok, std::move(func), read_nodes(std::unique_ptr<ast::Expr>()));
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::Postfix:
+            {
+                auto tok = read_token();
+                auto node = std::make_unique<ast::Postfix>(tok, read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::UnaryOp:
+            {
+                auto tok = read_token();
+                auto node = std::make_unique<ast::UnaryOp>(tok, read_node_as<ast::Expr>());
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::BinaryOp:
+            {
+                auto tok = read_token();
+                auto left = read_node_as<ast::Expr>();
+                auto node = std::make_unique<ast::BinaryOp>(tok, std::move(left), read_node_as<ast::Expr>());
+                node->new_left_type = read_type();
+                node->new_right_type = read_type();
+                read_expr_state(*this, *node);
+                return node;
+            }
+        case NodeKind::InitializerList:
+            malformed("initializer list outside of initializer");
+    }
+    malformed("unknown node kind");
+}
+}//namespace serialize
+
+namespace ast{
+using serialize::NodeKind;
+using serialize::write_kind;
+using serialize::write_expr_state;
+using serialize::write_nodes;
+using serialize::write_optional_node;
+
+void Program::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Program);
+    write_nodes(w, decls);
+}
+void NullStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::NullStmt);
+}
+void TypedefDecl::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::TypedefDecl);
+    w.write_token(tok);
+    w.write_type(type);
+}
+void TagDecl::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::TagDecl);
+    w.write_token(tok);
+    w.write_tag_type(type);
+}
+void EnumVarDecl::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::EnumVarDecl);
+    w.write_token(tok);
+    w.write_node(initializer.get());
+}
+void DeclList::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::DeclList);
+    write_nodes(w, tag_decls);
+    w.write_bool(analyzed);
+    write_nodes(w, decls);
+}
+void FunctionDecl::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::FunctionDecl);
+    w.write_token(tok);
+    w.write_type(type);
+    w.write_bool(analyzed);
+    w.write_uint(symbol_id);
+}
+void VarDecl::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::VarDecl);
+    w.write_token(tok);
+    w.write_type(type);
+    w.write_bool(analyzed);
+    w.write_uint(symbol_id);
+    w.write_initializer(assignment.has_value() ? assignment.value().get() : nullptr);
+}
+void FunctionDef::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::FunctionDef);
+    write_nodes(w, tag_decls);
+    w.write_token(tok);
+    w.write_type(type);
+    w.write_bool(FunctionDecl::analyzed);
+    w.write_uint(symbol_id);
+    write_nodes(w, params);
+    w.write_node(function_body.get());
+    w.write_tokens(unparsed_body);
+}
+void DoStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::DoStmt);
+    w.write_node(control_expr.get());
+    w.write_node(body.get());
+}
+void WhileStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::WhileStmt);
+    w.write_node(control_expr.get());
+    w.write_node(body.get());
+}
+void ForStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::ForStmt);
+    w.write_byte(init_clause.index());
+    std::visit(type::overloaded{
+        [](std::monostate){},
+        [&](const auto& node){w.write_node(node.get());}
+    }, init_clause);
+    w.write_node(control_expr.get());
+    write_optional_node(w, post_expr);
+    w.write_node(body.get());
+}
+void IfStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::IfStmt);
+    w.write_node(if_condition.get());
+    w.write_node(if_body.get());
+    write_optional_node(w, else_body);
+}
+void CaseStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::CaseStmt);
+    w.write_token(tok);
+    w.write_node(label.get());
+    w.write_node(stmt.get());
+}
+void DefaultStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::DefaultStmt);
+    w.write_token(tok);
+    w.write_node(stmt.get());
+}
+void SwitchStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::SwitchStmt);
+    w.write_node(control_expr.get());
+    w.write_node(switch_body.get());
+    w.write_type(control_type);
+    w.write_bool(case_table != nullptr);
+    if(case_table){
+        w.write_uint(case_table->size());
+        for(const auto& case_val : *case_table){
+            w.write_bool(case_val.has_value());
+            if(case_val.has_value()){
+                w.write_uint(case_val.value());
+            }
+        }
+    }
+}
+void CompoundStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::CompoundStmt);
+    write_nodes(w, stmt_body);
+}
+void LabeledStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::LabeledStmt);
+    w.write_token(ident_tok);
+    w.write_node(stmt.get());
+}
+void GotoStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::GotoStmt);
+    w.write_token(ident_tok);
+}
+void ContinueStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::ContinueStmt);
+    w.write_token(tok);
+}
+void BreakStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::BreakStmt);
+    w.write_token(tok);
+}
+void ReturnStmt::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::ReturnStmt);
+    w.write_token(tok);
+    write_optional_node(w, return_expr);
+}
+void AmbiguousBlock::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::AmbiguousBlock);
+    w.write_tokens(unparsed_tokens);
+    w.write_node(parsed_item.get());
+}
+void Conditional::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Conditional);
+    w.write_token(tok);
+    w.write_node(cond.get());
+    w.write_node(true_expr.get());
+    w.write_node(false_expr.get());
+    write_expr_state(w, *this);
+}
+void Variable::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Variable);
+    w.write_token(tok);
+    w.write_uint(symbol_id);
+    write_expr_state(w, *this);
+}
+void StrLiteral::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::StrLiteral);
+    w.write_token(tok);
+    w.write_string(literal);
+    write_expr_state(w, *this);
+}
+void Constant::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Constant);
+    w.write_token(tok);
+    w.write_string(literal);
+    write_expr_state(w, *this);
+}
+void MemberAccess::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::MemberAccess);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    w.write_string(index);
+    write_expr_state(w, *this);
+}
+void ArrayAccess::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::ArrayAccess);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    w.write_node(index.get());
+    write_expr_state(w, *this);
+}
+void Alignof::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Alignof);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    write_expr_state(w, *this);
+}
+void Sizeof::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Sizeof);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    write_expr_state(w, *this);
+}
+void FuncCall::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::FuncCall);
+    w.write_token(tok);
+    w.write_node(func.get());
+    write_nodes(w, args);
+    write_expr_state(w, *this);
+}
+void Postfix::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::Postfix);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    write_expr_state(w, *this);
+}
+void UnaryOp::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::UnaryOp);
+    w.write_token(tok);
+    w.write_node(arg.get());
+    write_expr_state(w, *this);
+}
+void BinaryOp::serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::BinaryOp);
+    w.write_token(tok);
+    w.write_node(left.get());
+    w.write_node(right.get());
+    w.write_type(new_left_type);
+    w.write_type(new_right_type);
+    write_expr_state(w, *this);
+}
+void Expr::initializer_serialize(serialize::Writer& w) const{
+    this->serialize(w);
+}
+void InitializerList::initializer_serialize(serialize::Writer& w) const{
+    write_kind(w, NodeKind::InitializerList);
+    w.write_token(tok);
+    w.write_uint(initializers.size());
+    for(const auto& init : initializers){
+        w.write_initializer(init.get());
+    }
+}
+} //namespace ast
@@ -0,0 +1,436 @@
+#include "serialize.h"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+namespace serialize{
+enum class TypeKind : std::uint8_t{
+    Void, Int, Float, Typedef, Func, Pointer, Array, Struct, Union, Enum
+};
+namespace{
+//Bumped whenever the encoding (or the information analysis leaves in the AST) changes
+constexpr std::string_view format_magic = "STEPCAST";
+constexpr std::uint64_t format_version = 4;
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes){
+    for(unsigned char c : bytes){
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+std::uint64_t fnv1a(std::uint64_t hash, std::uint64_t n){
+    for(int i = 0; i < 8; i++){
+        hash ^= (n >> (8*i)) & 0xff;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+} //anon namespace
+
+void Writer::write_byte(std::uint8_t b){
+    buffer.push_back(static_cast<char>(b));
+}
+void Writer::write_bool(bool b){
+    write_byte(b ? 1 : 0);
+}
+void Writer::write_uint(std::uint64_t n){
+    //LEB128
+    do{
+        std::uint8_t b = n & 0x7f;
+        n >>= 7;
+        write_byte(n ? (b | 0x80) : b);
+    }while(n);
+}
+void Writer::write_int(std::int64_t n){
+    //Zigzag encoding keeps small negative numbers short
+    write_uint((static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63));
+}
+void Writer::write_string(const std::string& s){
+    auto existing = string_ids.find(s);
+    if(existing != string_ids.end()){
+        write_uint(existing->second + 1);
+        return;
+    }
+    write_uint(0);
+    write_uint(s.size());
+    buffer.append(s);
+    string_ids.emplace(s, string_ids.size());
+}
+void Writer::write_token(const token::Token& tok){
+    write_byte(static_cast<std::uint8_t>(tok.type));
+    write_string(tok.value);
+    write_int(tok.loc.start_line);
+    write_int(tok.loc.start_col);
+    write_int(tok.loc.end_line);
+    write_int(tok.loc.end_col);
+    write_string(tok.sourceline);
+}
+void Writer::write_tokens(const std::vector<token::Token>& toks){
+    write_uint(toks.size());
+    for(const auto& tok : toks){
+        write_token(tok);
+    }
+}
+void Writer::write_type(const type::CType& t){
+    type::visit(type::make_visitor<void>(
+        [&](type::VoidType){write_byte(static_cast<std::uint8_t>(TypeKind::Void));},
+        [&](type::IType i){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Int));
+            write_byte(static_cast<std::uint8_t>(i));
+        },
+        [&](type::FType f){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Float));
+            write_byte(static_cast<std::uint8_t>(f));
+        },
+        [&](const type::UnevaluatedTypedef& u){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Typedef));
+            write_string(u.get_name());
+        },
+        [&](const type::FuncType& f){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Func));
+            write_type(f.return_type());
+            write_bool(f.has_prototype());
+            if(f.has_prototype()){
+                auto params = f.param_types();
+                write_uint(params.size());
+                for(const auto& p : params){
+                    write_type(p);
+                }
+                write_bool(f.is_variadic());
+            }
+        },
+        [&](const type::PointerType& p){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Pointer));
+            write_type(p.pointed_type());
+        },
+        [&](const type::ArrayType& a){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Array));
+            write_type(a.pointed_type());
+            write_bool(a.is_complete());
+            if(a.is_complete()){
+                write_int(a.size());
+            }
+        },
+        [&](const type::StructType& s){
+            write_tag_type(s);
+        },
+        [&](const type::UnionType& u){
+            write_tag_type(u);
+        }
+    ), t);
+    write_byte(t.storage.has_value() ? static_cast<std::uint8_t>(t.storage.value()) + 1 : 0);
+    write_byte(t.qualifiers.mask());
+}
+void Writer::write_tag_type(const type::TagType& tag_type){
+    std::visit(type::overloaded{
+        [&](const type::EnumType& e){
+            write_byte(static_cast<std::uint8_t>(TypeKind::Enum));
+            write_string(e.tag);
+        },
+        [&](const auto& t){
+            constexpr bool is_union = std::is_same_v<std::decay_t<decltype(t)>, type::UnionType>;
+            write_byte(static_cast<std::uint8_t>(is_union ? TypeKind::Union : TypeKind::Struct));
+            write_string(t.tag);
+            write_bool(t.complete);
+            if(!t.complete){
+                return;
+            }
+            write_uint(t.members.size());
+            for(const auto& m : t.members){
+                write_type(m);
+            }
+            write_uint(t.indices.size());
+            for(const auto& index : t.indices){
+                write_string(index.first);
+                write_int(index.second);
+            }
+            if constexpr(is_union){
+                write_bool(t.largest_computed);
+                if(t.largest_computed){
+                    write_type(t.largest);
+                }
+            }
+        }
+    }, tag_type);
+}
+void Writer::write_constant(const ast::ConstantExprType& constant){
+    write_byte(constant.index());
+    std::visit(type::overloaded{
+        [](std::monostate){},
+        [&](long long int i){write_int(i);},
+        [&](long double d){
+            //Hex formatting round trips exactly
+            char digits[64];
+            std::snprintf(digits, sizeof(digits), "%La", d);
+            write_string(digits);
+        }
+    }, constant);
+}
+void malformed(const std::string& what){
+    throw std::runtime_error("Malformed serialized AST: "+what);
+}
+
+const std::string& Writer::data() const{
+    return buffer;
+}
+
+std::uint8_t Reader::read_byte(){
+    if(position >= data.size()){
+        malformed("unexpected end of data");
+    }
+    return static_cast<std::uint8_t>(data[position++]);
+}
+bool Reader::read_bool(){
+    return read_byte() != 0;
+}
+std::uint64_t Reader::read_uint(){
+    std::uint64_t n = 0;
+    for(int shift = 0; shift < 64; shift += 7){
+        auto b = read_byte();
+        n |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if(!(b & 0x80)){
+            return n;
+        }
+    }
+    malformed("integer too long");
+}
+std::uint64_t Reader::read_count(){
+    auto count = read_uint();
+    if(count > data.size() - position){
+        malformed("count longer than data");
+    }
+    return count;
+}
+std::int64_t Reader::read_int(){
+    auto n = read_uint();
+    return static_cast<std::int64_t>((n >> 1) ^ (~(n & 1) + 1));
+}
+std::string Reader::read_string(){
+    auto id = read_uint();
+    if(id > 0){
+        if(id > strings.size()){
+            malformed("unknown string reference");
+        }
+        return strings.at(id-1);
+    }
+    auto length = read_uint();
+    if(length > data.size() - position){
+        malformed("string longer than data");
+    }
+    strings.emplace_back(data.substr(position, length));
+    position += length;
+    return strings.back();
+}
+token::Token Reader::read_token(){
+    auto tok = token::Token{};
+    auto type = read_byte();
+    if(type > static_cast<std::uint8_t>(token::TokenType::NEWLINE)){
+        malformed("unknown token type");
+    }
+    tok.type = static_cast<token::TokenType>(type);
+    tok.value = read_string();
+    tok.loc.start_line = read_int();
+    tok.loc.start_col = read_int();
+    tok.loc.end_line = read_int();
+    tok.loc.end_col = read_int();
+    tok.sourceline = read_string();
+    return tok;
+}
+std::vector<token::Token> Reader::read_tokens(){
+    auto count = read_count();
+    auto toks = std::vector<token::Token>{};
+    for(std::uint64_t i = 0; i < count; i++){
+        toks.push_back(read_token());
+    }
+    return toks;
+}
+type::CType Reader::read_type(){
+    auto t = type::CType();
+    auto kind = static_cast<TypeKind>(read_byte());
+    switch(kind){
+        case TypeKind::Void:
+            break;
+        case TypeKind::Int:
+            {
+                auto i = read_byte();
+                if(i > static_cast<std::uint8_t>(type::IType::Bool)){
+                    malformed("unknown integer type");
+                }
+                t = type::IType(i);
+            }
+            break;
+        case TypeKind::Float:
+            {
+                auto f = read_byte();
+                if(f > static_cast<std::uint8_t>(type::FType::LDouble)){
+                    malformed("unknown floating type");
+                }
+                t = type::FType(f);
+            }
+            break;
+        case TypeKind::Typedef:
+            t = type::UnevaluatedTypedef(read_string());
+            break;
+        case TypeKind::Func:
+            {
+                auto ret = read_type();
+                if(!read_bool()){
+                    t = type::FuncType(ret);
+                    break;
+                }
+                auto params = std::vector<type::CType>(read_count());
+                for(auto& p : params){
+                    p = read_type();
+                }
+                t = type::FuncType(ret, std::move(params), read_bool());
+            }
+            break;
+        case TypeKind::Pointer:
+            t = type::PointerType(read_type());
+            break;
+        case TypeKind::Array:
+            {
+                auto element = read_type();
+                auto size = std::optional<int>();
+                if(read_bool()){
+                    size = read_int();
+                }
+                t = type::ArrayType(element, size);
+            }
+            break;
+        case TypeKind::Struct:
+            t = std::get<type::StructType>(read_tag_body(kind));
+            break;
+        case TypeKind::Union:
+            t = std::get<type::UnionType>(read_tag_body(kind));
+            break;
+        default:
+            malformed("unknown type kind");
+    }
+    auto storage = read_byte();
+    if(storage > 0){
+        t.storage = static_cast<type::SSpecifier>(storage - 1);
+    }
+    t.qualifiers = type::QualifierSet(read_byte());
+    return t;
+}
+type::TagType Reader::read_tag_type(){
+    return read_tag_body(static_cast<TypeKind>(read_byte()));
+}
+type::TagType Reader::read_tag_body(TypeKind kind){
+    if(kind == TypeKind::Enum){
+        return type::EnumType{read_string()};
+    }
+    if(kind != TypeKind::Struct && kind != TypeKind::Union){
+        malformed("expected tag type");
+    }
+    auto tag = read_string();
+    if(!read_bool()){
+        if(kind == TypeKind::Struct){
+            return type::StructType(tag);
+        }
+        return type::UnionType(tag);
+    }
+    auto members = std::vector<type::CType>(read_count());
+    for(auto& m : members){
+        m = read_type();
+    }
+    auto indices = std::map<std::string, int>{};
+    auto index_count = read_uint();
+    for(std::uint64_t i = 0; i < index_count; i++){
+        auto name = read_string();
+        indices.emplace(name, read_int());
+    }
+    if(kind == TypeKind::Struct){
+        return type::StructType(tag, std::move(members), std::move(indices));
+    }
+    auto union_type = type::UnionType(tag, std::move(members), std::move(indices));
+    if(read_bool()){
+        union_type.largest = read_type();
+        union_type.largest_computed = true;
+    }
+    return union_type;
+}
+ast::ConstantExprType Reader::read_constant(){
+    switch(read_byte()){
+        case 0:
+            return std::monostate();
+        case 1:
+            return static_cast<long long int>(read_int());
+        case 2:
+            return std::strtold(read_string().c_str(), nullptr);
+        default:
+            malformed("unknown constant kind");
+    }
+}
+bool Reader::at_end() const{
+    return position == data.size();
+}
+
+std::uint64_t hash_tokens(const std::vector<token::Token>& tokens, std::uint64_t seed){
+    std::uint64_t hash = fnv1a(0xcbf29ce484222325ULL, seed);
+    for(const auto& tok : tokens){
+        hash = fnv1a(hash, static_cast<std::uint64_t>(tok.type));
+        hash = fnv1a(hash, tok.value.size());
+        hash = fnv1a(hash, tok.value);
+        //Locations end up in anonymous tag names and diagnostics
+        hash = fnv1a(hash, static_cast<std::uint64_t>(tok.loc.start_line));
+        hash = fnv1a(hash, static_cast<std::uint64_t>(tok.loc.start_col));
+    }
+    return hash;
+}
+
+std::string cache_key(const std::vector<token::Token>& tokens, std::uint64_t options){
+    auto w = Writer();
+    w.write_uint(options);
+    w.write_tokens(tokens);
+    return w.data();
+}
+
+std::string save_program(const ast::Program& program, std::string_view key){
+    auto w = Writer();
+    for(char c : format_magic){
+        w.write_byte(c);
+    }
+    w.write_uint(format_version);
+    w.write_string(std::string(key));
+    const auto& tags = program.types.tag_table();
+    w.write_uint(tags.size());
+    for(const auto& tag : tags){
+        w.write_string(tag.first);
+        w.write_type(tag.second);
+    }
+    w.write_node(&program);
+    return w.data();
+}
+
+std::unique_ptr<ast::Program> load_program(std::string_view data, std::string_view key){
+    auto r = Reader(data);
+    for(char c : format_magic){
+        if(r.read_byte() != static_cast<std::uint8_t>(c)){
+            malformed("not a serialized AST");
+        }
+    }
+    if(r.read_uint() != format_version){
+        malformed("unsupported format version");
+    }
+    if(r.read_string() != key){
+        throw std::runtime_error("Serialized AST was saved for other input");
+    }
+    auto types = type::TypeContext();
+    auto arena = types.arena_scope();
+    auto tags = std::map<std::string, type::CType>{};
+    auto tag_count = r.read_uint();
+    for(std::uint64_t i = 0; i < tag_count; i++){
+        auto name = r.read_string();
+        tags.emplace(name, r.read_type());
+    }
+    auto program = r.read_node_as<ast::Program>();
+    if(!program || !r.at_end()){
+        malformed("expected a single program");
+    }
+    program->types = std::move(types);
+    program->types.restore_tags(std::move(tags));
+    return program;
+}
+}//namespace serialize
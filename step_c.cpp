@@ -1,52 +1,293 @@
 #include "lexer.h"
+#include "tokenizer.h"
 #include "parse.h"
 #include "ast.h"
+#include "serialize.h"
+#include "bitcode_writer.h"
+#include "time_trace.h"
+#ifdef STEPC_LLVM_BACKEND
+#include "llvm_backend.h"
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#endif
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <cassert>
 #include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <optional>
+#include <charconv>
+#include <string_view>
+
+namespace{
+//Lexes the whole input up front, tokenizing it before preprocessing so each can be timed
+std::vector<token::Token> lex_all(std::istream& input){
+    auto tokenized = std::vector<token::Token>{};
+    {
+        auto span = time_trace::Scope("Tokenize");
+        auto tokenizer = lexer::Tokenizer(input);
+        do{
+            tokenized.push_back(tokenizer.get_token());
+        }while(tokenized.back().type != token::TokenType::END);
+    }
+    auto span = time_trace::Scope("Preprocess");
+    auto l = lexer::Lexer(std::move(tokenized));
+    auto tokens = std::vector<token::Token>{};
+    do{
+        tokens.push_back(l.get_token());
+    }while(tokens.back().type != token::TokenType::END);
+    return tokens;
+}
+//Returns the cached analyzed AST at the given path, or nullptr if there is no usable one
+//An entry saved under another key (from a hash collision or a copied file) is not usable
+std::unique_ptr<ast::Program> load_cached_program(const std::string& path, const std::string& key){
+    auto cache = std::ifstream(path, std::ios::binary);
+    if(!cache.is_open()){
+        return nullptr;
+    }
+    auto span = time_trace::Scope("Load AST cache");
+    auto data = std::stringstream{};
+    data << cache.rdbuf();
+    try{
+        return serialize::load_program(data.str(), key);
+    }catch(std::exception& e){
+        return nullptr;
+    }
+}
+void save_cached_program(const std::string& path, const std::string& key, const ast::Program& program){
+    auto data = serialize::save_program(program, key);
+    //Write then rename, so a concurrent compile never sees a partial entry
+    auto temp_path = path + ".tmp";
+    {
+        auto cache = std::ofstream(temp_path, std::ios::binary);
+        cache.write(data.data(), data.size());
+        if(!cache){
+            return;
+        }
+    }
+    std::rename(temp_path.c_str(), path.c_str());
+}
+void print_usage(){
+    std::cout << "usage: step_c.out [--lazy-function-bodies] [--parallel-parse[=threads]] [--parallel-codegen[=threads]] [--ast-cache=dir] [--stats] [--time-trace[=file]] [--time-trace-granularity=microseconds] [--backend=text|bitcode|llvm] input_file.c"<<std::endl;
+}
+//The non-negative number making up the whole text, if it is one
+std::optional<unsigned int> parse_count(std::string_view text){
+    unsigned int value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if(text.empty() || error != std::errc() || end != text.data() + text.size()){
+        return std::nullopt;
+    }
+    return value;
+}
+}//namespace
 
 int main(int argc, char* argv[]){
-    assert(argc == 2);
-    auto file_name = std::string(argv[1]);
+    auto parse_options = parse::ParseOptions();
+    auto file_name = std::string();
+    auto cache_dir = std::string();
+    bool print_stats = false;
+    //Whether a Chrome trace of the compile is written, and where (next to the input if no file is given)
+    bool write_trace = false;
+    auto trace_file = std::string();
+    auto trace_granularity = std::chrono::microseconds(500);
+    //Number of threads generating function bodies, 0 using every core
+    unsigned int codegen_threads = 1;
+    //Whether clang is handed printed textual IR, bitcode from our own writer, or bitcode built through the LLVM API
+    enum class Backend{Text, Bitcode, Llvm};
+    auto backend = Backend::Text;
+    for(int i = 1; i < argc; i++){
+        auto arg = std::string(argv[i]);
+        if(arg == "--lazy-function-bodies"){
+            parse_options.lazy_function_bodies = true;
+        }else if(arg == "--parallel-parse"){
+            parse_options.parse_threads = 0;
+        }else if(arg.rfind("--parallel-parse=", 0) == 0){
+            auto threads = parse_count(std::string_view(arg).substr(std::string("--parallel-parse=").size()));
+            if(!threads){
+                std::cout << "invalid thread count in "<<arg<<std::endl;
+                print_usage();
+                return 1;
+            }
+            parse_options.parse_threads = *threads;
+        }else if(arg == "--parallel-codegen"){
+            codegen_threads = 0;
+        }else if(arg.rfind("--parallel-codegen=", 0) == 0){
+            auto threads = parse_count(std::string_view(arg).substr(std::string("--parallel-codegen=").size()));
+            if(!threads){
+                std::cout << "invalid thread count in "<<arg<<std::endl;
+                print_usage();
+                return 1;
+            }
+            codegen_threads = *threads;
+        }else if(arg.rfind("--ast-cache=", 0) == 0){
+            cache_dir = arg.substr(std::string("--ast-cache=").size());
+        }else if(arg == "--stats"){
+            print_stats = true;
+        }else if(arg == "--time-trace"){
+            write_trace = true;
+        }else if(arg.rfind("--time-trace=", 0) == 0){
+            write_trace = true;
+            trace_file = arg.substr(std::string("--time-trace=").size());
+        }else if(arg.rfind("--time-trace-granularity=", 0) == 0){
+            auto granularity = parse_count(std::string_view(arg).substr(std::string("--time-trace-granularity=").size()));
+            if(!granularity){
+                std::cout << "invalid granularity in "<<arg<<std::endl;
+                print_usage();
+                return 1;
+            }
+            trace_granularity = std::chrono::microseconds(*granularity);
+        }else if(arg == "--backend=text"){
+            backend = Backend::Text;
+        }else if(arg == "--backend=bitcode"){
+            backend = Backend::Bitcode;
+        }else if(arg == "--backend=llvm"){
+#ifdef STEPC_LLVM_BACKEND
+            backend = Backend::Llvm;
+#else
+            std::cout << "step_c was built without the LLVM backend"<<std::endl;
+            return 1;
+#endif
+        }else if(arg.rfind("--", 0) == 0){
+            std::cout << "unknown option "<<arg<<std::endl;
+            return 1;
+        }else if(file_name.empty()){
+            file_name = arg;
+        }else{
+            std::cout << "only one input file may be given"<<std::endl;
+            return 1;
+        }
+    }
+    if(file_name.empty()){
+        print_usage();
+        return 1;
+    }
     auto input = std::ifstream(file_name);
     if(!input.is_open()){
         std::cout << "could not find file "<<file_name<<std::endl;
         return 1;
     }
-    lexer::Lexer l(input);
+    if(write_trace){
+        time_trace::enable(file_name, trace_granularity);
+    }
     std::unique_ptr<ast::Program> program_ast = nullptr;
+    auto cache_file = std::string();
+    auto cache_key = std::string();
+    bool analyzed = false;
     try{
-        program_ast = parse::construct_ast(l);
+        if(cache_dir.empty() && !write_trace){
+            //Tokens are lexed as the parser asks for them
+            lexer::Lexer l(input);
+            program_ast = parse::construct_ast(l, parse_options);
+        }else{
+            auto tokens = lex_all(input);
+            if(!cache_dir.empty()){
+                //The cache is keyed by the preprocessed tokens (and options changing the AST)
+                char key[17];
+                std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(
+                    serialize::hash_tokens(tokens, parse_options.lazy_function_bodies)));
+                cache_file = cache_dir + "/" + key + ".ast";
+                cache_key = serialize::cache_key(tokens, parse_options.lazy_function_bodies);
+                program_ast = load_cached_program(cache_file, cache_key);
+                analyzed = program_ast != nullptr;
+            }
+            if(!program_ast){
+                auto span = time_trace::Scope("Parse");
+                auto token_stream = lexer::TokenStream(std::move(tokens));
+                program_ast = parse::construct_ast(token_stream, parse_options);
+            }
+        }
     }catch(std::exception& e){
         std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
         std::cout<<e.what()<<std::endl;
         return 1;
     }
-    auto global_context = context::Context();
+    auto global_context = context::Context(codegen_threads);
 
     if(file_name.substr(file_name.size() - 2, file_name.size()) != ".c"){
         std::cout << "unknown file extension "<<file_name<<std::endl;
         return 1;
     }
     auto program_name = file_name.substr(0,file_name.size() - 2);
-    auto clang_command = "clang -o"+program_name+" "+program_name+".ll";
-    auto rm_llvm_ir = "rm "+program_name+".ll";
+    auto ir_file = program_name + (backend == Backend::Text ? ".ll" : ".bc");
+    auto clang_command = "clang -o"+program_name+" "+ir_file;
+    auto rm_llvm_ir = "rm "+ir_file;
 
-    try{
-        program_ast->analyze();
-    }catch(std::exception& e){
-        std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
-        std::cout<<e.what()<<std::endl;
-        return 1;
+    if(!analyzed){
+        try{
+            auto span = time_trace::Scope("Analyze");
+            program_ast->analyze();
+        }catch(std::exception& e){
+            std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
+            std::cout<<e.what()<<std::endl;
+            return 1;
+        }
+        if(!cache_file.empty()){
+            save_cached_program(cache_file, cache_key, *program_ast);
+        }
     }
     //program_ast->pretty_print(0);
+    auto codegen_span = std::optional<time_trace::Scope>(std::in_place, "Codegen");
+    if(backend == Backend::Text){
+        try{
+            auto llvm_output = std::ofstream(program_name +".ll");
+            program_ast->codegen(llvm_output, global_context); //Should output program_name .ll
+        }catch(std::exception& e){
+            //The IR is written as it is generated, so remove what was written before the error
+            std::remove((program_name +".ll").c_str());
+            std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
+            std::cout<<e.what()<<std::endl;
+            return 1;
+        }
+    }else if(backend == Backend::Bitcode){
+        try{
+            program_ast->codegen(global_context);
+            auto span = time_trace::Scope("Write bitcode");
+            //Encoded in full before the file is opened, so a module which cannot be encoded leaves no file behind
+            auto bitcode = std::ostringstream();
+            bitcode_writer::write(global_context.module(), bitcode);
+            auto bitcode_output = std::ofstream(ir_file, std::ios::binary);
+            bitcode_output << bitcode.str(); //Should output program_name .bc
+        }catch(std::exception& e){
+            std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
+            std::cout<<e.what()<<std::endl;
+            return 1;
+        }
+    }else{
+#ifdef STEPC_LLVM_BACKEND
+        try{
+            program_ast->codegen(global_context);
+            auto span = time_trace::Scope("Write bitcode");
+            auto llvm_context = llvm::LLVMContext();
+            auto module = llvm_backend::build_module(global_context.module(), llvm_context);
+            llvm_backend::write_bitcode(*module, ir_file); //Should output program_name .bc
+        }catch(std::exception& e){
+            std::cout<<std::endl<<"Error compiling program "<<file_name<<std::endl;
+            std::cout<<e.what()<<std::endl;
+            return 1;
+        }
+#endif
+    }
+    codegen_span.reset();
+    if(print_stats){
+        //One JSON object per function, in the order they were generated
+        for(const auto& f : global_context.stats()){
+            std::cout << "{\"function\":\"" << f.name << "\""
+                << ",\"values\":" << f.values
+                << ",\"peak_values\":" << f.peak_values
+                << ",\"peak_bytes\":" << f.peak_bytes
+                << "}" << std::endl;
+        }
+    }
     {
-    auto llvm_output = std::ofstream(program_name +".ll");
-    program_ast->codegen(llvm_output, global_context); //Should output program_name .ll
+        auto span = time_trace::Scope("Clang");
+        std::system(clang_command.c_str()); //Should output binary
     }
-    std::system(clang_command.c_str()); //Should output binary
     system(rm_llvm_ir.c_str()); 
+    if(write_trace){
+        auto trace_output = std::ofstream(trace_file.empty() ? program_name + ".json" : trace_file);
+        time_trace::write(trace_output);
+    }
 }
@@ -0,0 +1,954 @@
+#include "catch2/catch.hpp"
+#include "lexer.h"
+#include "parse.h"
+#include "type.h"
+#include "conversions.h"
+#include "lexer_error.h"
+#include "parse_error.h"
+#include "sem_error.h"
+#include "serialize.h"
+#include "bitcode_writer.h"
+#include "tokenizer.h"
+#include "time_trace.h"
+#ifdef STEPC_LLVM_BACKEND
+#include "llvm_backend.h"
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+#endif
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+namespace{
+parse::ParseOptions lazy_options(){
+    auto options = parse::ParseOptions();
+    options.lazy_function_bodies = true;
+    return options;
+}
+//Command running an LLVM tool which reads and writes opaque pointers, or an empty string if it is not installed
+std::string llvm_tool(const std::string& name){
+    if(std::system(("command -v "+name+"-14 >/dev/null 2>&1").c_str()) == 0){
+        return name+"-14 -opaque-pointers";
+    }
+    if(std::system(("command -v "+name+" >/dev/null 2>&1").c_str()) == 0){
+        return name;
+    }
+    return "";
+}
+//Disassembly without the lines naming the file it was read from
+std::string read_disassembly(const std::filesystem::path& path){
+    auto input = std::ifstream(path);
+    auto result = std::string();
+    for(auto line = std::string(); std::getline(input, line);){
+        if(line.rfind("; ModuleID", 0) != 0 && line.rfind("source_filename", 0) != 0){
+            result += line + "\n";
+        }
+    }
+    return result;
+}
+}//namespace
+
+TEST_CASE("lazy parsing skips unreferenced static functions"){
+    auto source = std::string(
+R"(
+static int helper(int a){
+    return a +* ;
+}
+int main(){
+    return 0;
+}
+)");
+    auto ss = std::stringstream(source);
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l, lazy_options());
+    program_pointer->analyze();
+    auto helper = dynamic_cast<ast::FunctionDef*>(program_pointer->decls.front().get());
+    REQUIRE(helper);
+    REQUIRE(helper->function_body == nullptr);
+
+    auto eager_ss = std::stringstream(source);
+    lexer::Lexer eager_l(eager_ss);
+    REQUIRE_THROWS_AS(parse::construct_ast(eager_l), parse_error::ParseError);
+}
+TEST_CASE("lazy parsing analyzes referenced static functions"){
+    auto ss = std::stringstream(
+R"(
+static int odd(int a);
+int main(){
+    return odd(3);
+}
+static int even(int a){
+    if(a == 0) return 1;
+    return odd(a-1);
+}
+static int odd(int a){
+    if(a == 0) return 0;
+    return even(a-1);
+}
+static int unused(void){
+    return 2;
+}
+)");
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l, lazy_options());
+    program_pointer->analyze();
+    for(const auto& decl : program_pointer->decls){
+        if(auto def = dynamic_cast<ast::FunctionDef*>(decl.get())){
+            REQUIRE((def->function_body == nullptr) == (def->name == "unused"));
+        }
+    }
+}
+TEST_CASE("lazy parsing reports errors in referenced static functions"){
+    auto ss = std::stringstream(
+R"(
+static int helper(void){
+    return undeclared;
+}
+int main(){
+    return helper();
+}
+)");
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l, lazy_options());
+    REQUIRE_THROWS_AS(program_pointer->analyze(), sem_error::STError);
+}
+TEST_CASE("lazy parsing only sees declarations before the definition"){
+    auto later = std::string("static int f(void){ return x; }\nint x = 3;\nint main(){ return f(); }\n");
+    auto earlier = std::string("int x = 3;\nstatic int f(int n){ return n ? f(n - 1) : x; }\nint main(){ return f(2); }\n");
+    for(auto options : {parse::ParseOptions(), lazy_options()}){
+        auto later_ss = std::stringstream(later);
+        lexer::Lexer later_l(later_ss);
+        auto rejected = parse::construct_ast(later_l, options);
+        REQUIRE_THROWS_AS(rejected->analyze(), sem_error::STError);
+
+        auto earlier_ss = std::stringstream(earlier);
+        lexer::Lexer earlier_l(earlier_ss);
+        auto accepted = parse::construct_ast(earlier_l, options);
+        REQUIRE_NOTHROW(accepted->analyze());
+    }
+}
+TEST_CASE("parallel parsing keeps declarations in source order"){
+    auto ss = std::stringstream(
+R"(
+typedef int number;
+struct pair{int a; int b;};
+number sum(struct pair p){
+    return p.a + p.b;
+}
+int global = 3;
+number twice(int a){
+    number result = a;
+    result *= 2;
+    return result;
+}
+int main(){
+    struct pair p = {1, 2};
+    return sum(p) + twice(global);
+}
+)");
+    lexer::Lexer l(ss);
+    auto options = parse::ParseOptions();
+    options.parse_threads = 4;
+    auto program_pointer = parse::construct_ast(l, options);
+    program_pointer->analyze();
+    auto names = std::vector<std::string>{};
+    for(const auto& decl : program_pointer->decls){
+        if(auto def = dynamic_cast<ast::FunctionDef*>(decl.get())){
+            REQUIRE(def->function_body != nullptr);
+            names.push_back(def->name);
+        }
+    }
+    REQUIRE(names == std::vector<std::string>{"sum", "twice", "main"});
+}
+TEST_CASE("parallel parsing reports the first error in source order"){
+    auto ss = std::stringstream(
+R"(
+int f(void){
+    return 1 +;
+}
+int g(void){
+    return 2;
+}
+int 3h;
+)");
+    lexer::Lexer l(ss);
+    auto options = parse::ParseOptions();
+    options.parse_threads = 2;
+    try{
+        parse::construct_ast(l, options);
+        FAIL("Expected parse error");
+    }catch(parse_error::ParseError& e){
+        REQUIRE(std::string(e.what()).find("At line 3 ") != std::string::npos);
+    }
+}
+TEST_CASE("serialized ASTs round trip"){
+    auto ss = std::stringstream(
+R"(
+struct point{int x; double y;};
+union number{int i; float f;};
+enum color{RED, GREEN = 4};
+int table[3] = {1, 2, 3};
+int main(){
+    struct point p = {1, 2.5};
+    union number n;
+    n.i = GREEN;
+    switch(p.x){
+        case 1:
+            p.y += 1.0;
+        default:
+            break;
+    }
+    for(int i = 0; i < 3; i++){
+        n.i += table[i] * sizeof(p);
+    }
+    return n.i > 3 ? 1 : 0;
+}
+)");
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l);
+    program_pointer->analyze();
+    auto data = serialize::save_program(*program_pointer);
+    auto loaded = serialize::load_program(data);
+    REQUIRE(loaded->decls.size() == program_pointer->decls.size());
+    REQUIRE(serialize::save_program(*loaded) == data);
+    REQUIRE(loaded->types.tag_declared("point"));
+}
+TEST_CASE("malformed serialized ASTs are rejected"){
+    auto ss = std::stringstream("int main(){return 0;}");
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l);
+    program_pointer->analyze();
+    auto data = serialize::save_program(*program_pointer);
+    REQUIRE_THROWS_AS(serialize::load_program(data.substr(0, data.size()-1)), std::runtime_error);
+    REQUIRE_THROWS_AS(serialize::load_program("not an ast"), std::runtime_error);
+    //Counts are checked against the data left before anything is allocated
+    auto empty_stream = std::stringstream("");
+    lexer::Lexer empty_lexer(empty_stream);
+    auto empty = serialize::save_program(*parse::construct_ast(empty_lexer));
+    REQUIRE(empty.back() == '\0');
+    REQUIRE_THROWS_WITH(serialize::load_program(empty.substr(0, empty.size()-1) + "\xFF\xFF\xFF\xFF\x0F"), Catch::Contains("count longer than data"));
+    //As are the kinds of the types nodes are built from
+    auto declaration_stream = std::stringstream("int f(void);");
+    lexer::Lexer declaration_lexer(declaration_stream);
+    auto declaration = parse::construct_ast(declaration_lexer);
+    declaration->analyze();
+    auto decl_list = dynamic_cast<ast::DeclList*>(declaration->decls.at(0).get());
+    REQUIRE(decl_list);
+    decl_list->decls.at(0)->type = type::IType::Int;
+    REQUIRE_THROWS_WITH(serialize::load_program(serialize::save_program(*declaration)), Catch::Contains("expected function type"));
+}
+TEST_CASE("token hashes depend on token contents"){
+    auto tokens_of = [](std::string source){
+        auto ss = std::stringstream(source);
+        lexer::Lexer l(ss);
+        auto tokens = std::vector<token::Token>{};
+        do{
+            tokens.push_back(l.get_token());
+        }while(tokens.back().type != token::TokenType::END);
+        return tokens;
+    };
+    REQUIRE(serialize::hash_tokens(tokens_of("int main(){return 0;}"))
+        == serialize::hash_tokens(tokens_of("int main(){return 0;}")));
+    REQUIRE(serialize::hash_tokens(tokens_of("int main(){return 0;}"))
+        != serialize::hash_tokens(tokens_of("int main(){return 1;}")));
+}
+TEST_CASE("cached ASTs only load under the key they were saved with"){
+    auto tokens_of = [](std::string source){
+        auto ss = std::stringstream(source);
+        lexer::Lexer l(ss);
+        auto tokens = std::vector<token::Token>{};
+        do{
+            tokens.push_back(l.get_token());
+        }while(tokens.back().type != token::TokenType::END);
+        return tokens;
+    };
+    auto tokens = tokens_of("int main(){return 0;}");
+    auto key = serialize::cache_key(tokens, false);
+    auto stream = lexer::TokenStream(tokens);
+    auto program = parse::construct_ast(stream);
+    program->analyze();
+    auto data = serialize::save_program(*program, key);
+    REQUIRE(serialize::load_program(data, key));
+    //As for an entry whose name collides, or which was copied from another program's entry
+    REQUIRE_THROWS_AS(serialize::load_program(data, serialize::cache_key(tokens_of("int main(){return 1;}"), false)),
+        std::runtime_error);
+    REQUIRE_THROWS_AS(serialize::load_program(data, serialize::cache_key(tokens, true)), std::runtime_error);
+}
+TEST_CASE("interned types share storage"){
+    auto int_type = type::CType(type::IType::Int);
+    auto pointer = type::CType(type::PointerType(int_type));
+    auto same_pointer = type::CType(type::PointerType(int_type));
+    REQUIRE(pointer == same_pointer);
+    REQUIRE(&type::get<type::PointerType>(pointer) == &type::get<type::PointerType>(same_pointer));
+    REQUIRE(pointer != type::CType(type::PointerType(type::IType::Char)));
+
+    //Equality ignores array sizes and qualifiers, but the sizes are kept
+    auto sized = type::CType(type::ArrayType(int_type, 4));
+    auto unsized = type::CType(type::ArrayType(int_type, std::nullopt));
+    REQUIRE(sized == unsized);
+    REQUIRE(type::get<type::ArrayType>(sized).size() == 4);
+    REQUIRE(!type::get<type::ArrayType>(unsized).is_complete());
+    auto const_int = int_type;
+    const_int.qualifiers.insert(type::TQualifier::Const);
+    REQUIRE(const_int.qualifiers.contains(type::TQualifier::Const));
+    REQUIRE(!const_int.qualifiers.contains(type::TQualifier::Volatile));
+    REQUIRE(type::CType(type::PointerType(const_int)) == pointer);
+    REQUIRE(type::get<type::PointerType>(type::PointerType(const_int)).pointed_type().qualifiers.contains(type::TQualifier::Const));
+}
+TEST_CASE("each program interns its types in its own arena"){
+    auto source = std::string("struct s{int a;};\nint* p;\nstruct s* q;\nint main(){return 0;}\n");
+    auto first_ss = std::stringstream(source);
+    auto second_ss = std::stringstream(source);
+    lexer::Lexer first_l(first_ss);
+    lexer::Lexer second_l(second_ss);
+    auto first = parse::construct_ast(first_l);
+    auto second = parse::construct_ast(second_l);
+    first->analyze();
+    second->analyze();
+    auto declared_type = [](const ast::Program& program, std::size_t i){
+        auto decls = dynamic_cast<ast::DeclList*>(program.decls.at(i).get());
+        REQUIRE(decls);
+        return decls->decls.front()->type;
+    };
+    auto first_pointer = declared_type(*first, 1);
+    auto second_pointer = declared_type(*second, 1);
+    REQUIRE(&type::get<type::PointerType>(first_pointer) != &type::get<type::PointerType>(second_pointer));
+    //Types of different arenas (or of the shared arena) are still compared by structure
+    REQUIRE(first_pointer == second_pointer);
+    REQUIRE(first_pointer == type::CType(type::PointerType(type::IType::Int)));
+    REQUIRE(declared_type(*first, 2) == declared_type(*second, 2));
+    REQUIRE(declared_type(*first, 2) != first_pointer);
+    REQUIRE(type::CType(type::PointerType(type::StructType("s"))) == declared_type(*second, 2));
+    //A type whose structure the arena has never seen is not equal to any of its types
+    REQUIRE(declared_type(*first, 2) != type::CType(type::PointerType(type::StructType("unseen"))));
+    REQUIRE(first_pointer != type::CType(type::PointerType(type::PointerType(type::StructType("unseen")))));
+    //Types built from the types of a program outside of any arena scope go into the same arena
+    auto first_double = type::CType(type::PointerType(first_pointer));
+    auto second_double = type::CType(type::PointerType(second_pointer));
+    REQUIRE(&type::get<type::PointerType>(first_double) != &type::get<type::PointerType>(second_double));
+    REQUIRE(first_double == second_double);
+    {
+        auto arena = first->types.arena_scope();
+        REQUIRE(&type::get<type::PointerType>(type::PointerType(type::IType::Int)) == &type::get<type::PointerType>(first_pointer));
+    }
+}
+TEST_CASE("type kinds"){
+    auto int_type = type::CType(type::IType::Int);
+    auto pointer = type::CType(type::PointerType(int_type));
+    auto array = type::CType(type::ArrayType(int_type, 4));
+    REQUIRE(int_type.kind() == type::TypeKind::Int);
+    REQUIRE(type::CType(type::FType::Double).kind() == type::TypeKind::Float);
+    REQUIRE(type::CType().kind() == type::TypeKind::Void);
+    REQUIRE(pointer.kind() == type::TypeKind::Pointer);
+    REQUIRE(array.kind() == type::TypeKind::Array);
+
+    //Arrays can be used wherever pointers can, but not the other way around
+    REQUIRE(type::is_type<type::PointerType>(array));
+    REQUIRE(!type::is_type<type::ArrayType>(pointer));
+    REQUIRE(type::get<type::PointerType>(array).pointed_type() == int_type);
+    REQUIRE(type::is_type<type::DerivedType>(array));
+    REQUIRE(!type::is_type<type::DerivedType>(int_type));
+    REQUIRE(type::is_type<type::BasicType>(int_type));
+    REQUIRE(!type::is_type<type::FType>(int_type));
+}
+TEST_CASE("struct and union layouts"){
+    auto ss = std::stringstream(
+R"(
+struct mixed{char a; int b; char c; double d;};
+union number{char c; double d; int i;};
+int main(){
+    struct mixed m;
+    union number n;
+    return sizeof(m) + sizeof(n);
+}
+)");
+    lexer::Lexer l(ss);
+    auto program_pointer = parse::construct_ast(l);
+    program_pointer->analyze();
+    const auto& types = program_pointer->types;
+    const auto& mixed = type::layout(types.get_tag("mixed"), types);
+    REQUIRE(mixed.offsets == std::vector<long long int>{0, 4, 8, 16});
+    REQUIRE(mixed.size == 24);
+    REQUIRE(mixed.align == 8);
+    REQUIRE(type::size(type::StructType("mixed"), types) == 24);
+    const auto& number = type::layout(type::UnionType("number"), types);
+    REQUIRE(number.size == 8);
+    REQUIRE(number.largest_member == 1);
+    REQUIRE_THROWS(type::layout(type::StructType("undefined"), types));
+}
+TEST_CASE("programs keep separate tag tables"){
+    auto first_ss = std::stringstream("struct s{char c;};\nint main(){struct s x; return sizeof(x);}\n");
+    auto second_ss = std::stringstream("struct s{double d; double e;};\nint main(){struct s x; return sizeof(x);}\n");
+    lexer::Lexer first_l(first_ss);
+    lexer::Lexer second_l(second_ss);
+    auto first = parse::construct_ast(first_l);
+    auto second = parse::construct_ast(second_l);
+    first->analyze();
+    second->analyze();
+    REQUIRE(type::size(type::StructType("s"), first->types) == 1);
+    REQUIRE(type::size(type::StructType("s"), second->types) == 16);
+}
+TEST_CASE("tags are interned per scope"){
+    auto ss = std::stringstream("struct s{char c;};\ntypedef struct s s_t;\n"
+        "int main(){struct s{double d;}; s_t x; struct s y; return sizeof(x) + sizeof(y);}\n");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    auto global = program->types.find_tag("s");
+    auto block = program->types.find_tag("s.1");
+    REQUIRE(global.has_value());
+    REQUIRE(block.has_value());
+    REQUIRE(*global != *block);
+    REQUIRE(program->types.tag_name(*block) == "s.1");
+    REQUIRE(type::size(type::StructType("s"), program->types) == 1);
+    REQUIRE(type::size(type::StructType("s.1"), program->types) == 8);
+    //Declared tags carry their id, and an id which names another tag is not trusted
+    const auto& block_type = type::get<type::StructType>(program->types.get_tag(*block));
+    REQUIRE(block_type.id == block);
+    REQUIRE(program->types.find_tag(block_type) == block);
+    REQUIRE(program->types.find_tag(type::StructType("s.1", *global)) == block);
+    REQUIRE(type::size(type::StructType("s", *block), program->types) == 1);
+    //The typedef refers to the global tag even where a block tag shadows it
+    auto out = std::stringstream();
+    context::Context c;
+    program->codegen(out, c);
+    REQUIRE(out.str().find("alloca %s\n") != std::string::npos);
+}
+TEST_CASE("typedefs can name tags defined later"){
+    auto ss = std::stringstream("typedef struct s s_t;\nstruct s{int a; int b;};\n"
+        "int main(){typedef struct q q_t; struct q{double d;}; s_t x; q_t y; x.a = 1; y.d = 2.0; return x.a + sizeof(y);}\n");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    REQUIRE(type::size(type::StructType("s"), program->types) == 8);
+    REQUIRE(type::size(type::StructType("q.1"), program->types) == 8);
+    auto out = std::stringstream();
+    context::Context c;
+    program->codegen(out, c);
+    REQUIRE(out.str().find("alloca %s\n") != std::string::npos);
+    REQUIRE(out.str().find("alloca %q.1\n") != std::string::npos);
+}
+TEST_CASE("declarations are removed when their scope closes"){
+    auto shadowed = std::stringstream(
+R"(
+typedef int t;
+int main(){
+    t x = 1;
+    {
+        long t = 2;
+        {
+            struct t{char c;} s;
+            s.c = 3;
+            x = x + t + s.c;
+        }
+    }
+    t y = x;
+    return y;
+}
+)");
+    lexer::Lexer shadowed_l(shadowed);
+    auto program = parse::construct_ast(shadowed_l);
+    REQUIRE_NOTHROW(program->analyze());
+
+    auto out_of_scope = std::stringstream("int main(){\n{int inner = 1;}\nreturn inner;\n}\n");
+    lexer::Lexer out_of_scope_l(out_of_scope);
+    auto out_of_scope_program = parse::construct_ast(out_of_scope_l);
+    REQUIRE_THROWS_AS(out_of_scope_program->analyze(), sem_error::STError);
+
+    auto redeclared_param = std::stringstream("int f(int a){\nint a = 2;\nreturn a;\n}\n");
+    lexer::Lexer redeclared_param_l(redeclared_param);
+    auto redeclared_param_program = parse::construct_ast(redeclared_param_l);
+    REQUIRE_THROWS_AS(redeclared_param_program->analyze(), sem_error::STError);
+}
+TEST_CASE("bindings intern each name once"){
+    symbol::Bindings bindings;
+    REQUIRE(!bindings.name_id("t"));
+    auto outer = bindings.mark();
+    bindings.declare("t", symbol::Bindings::Symbol{type::IType::Int, true, symbol::Bindings::Kind::Typedef, 0, 0});
+    auto id = bindings.name_id("t");
+    REQUIRE(id);
+    REQUIRE(bindings.intern("t") == *id);
+    REQUIRE(bindings.intern("u") != *id);
+
+    auto inner = bindings.mark();
+    bindings.declare(*id, symbol::Bindings::Symbol{type::IType::Long, true, symbol::Bindings::Kind::Variable, 0, 1});
+    bindings.declare_tag(*id, symbol::Bindings::Tag{3, 1});
+    REQUIRE(bindings.find(*id)->kind == symbol::Bindings::Kind::Variable);
+    REQUIRE(bindings.find("t", 1) != nullptr);
+    REQUIRE(bindings.find_tag("t", 1) == type::TagId{3});
+    REQUIRE(!bindings.find_tag("t", 0));
+
+    bindings.unwind(inner);
+    REQUIRE(bindings.find(*id)->kind == symbol::Bindings::Kind::Typedef);
+    REQUIRE(!bindings.find_tag(*id));
+    bindings.unwind(outer);
+    REQUIRE(bindings.find("t") == nullptr);
+    REQUIRE(bindings.name_id("t") == id);
+}
+TEST_CASE("statement temporaries are released"){
+    auto source = std::string("int f(int a){\nreturn a + 1;\n}\nint main(){\nint a = 1;\n");
+    for(int i = 0; i < 100; i++){
+        source += "a = a * 3 + f(a);\n";
+    }
+    source += "return a;\n}\n";
+    auto ss = std::stringstream(source);
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    auto out = std::stringstream();
+    context::Context c;
+    program->codegen(out, c);
+    REQUIRE(c.stats().size() == 2);
+    REQUIRE(c.stats().at(0).name == "f");
+    const auto& main_stats = c.stats().at(1);
+    REQUIRE(main_stats.name == "main");
+    REQUIRE(main_stats.values > 400);
+    REQUIRE(main_stats.peak_values < 10);
+}
+TEST_CASE("variables are bound to their declarations"){
+    auto source = std::string("int x = 5;\nint main(){\nint y = x;\nint x = 1;\n{\nint x = 2;\ny = y + x;\n}\nreturn x + y;\n}\n");
+    auto ss = std::stringstream(source);
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    auto out = std::stringstream();
+    context::Context c;
+    program->codegen(out, c);
+    auto ir = out.str();
+    REQUIRE(ir.find("load i32, ptr @x\n") != std::string::npos);
+    REQUIRE(ir.find("load i32, ptr %x.2\n") != std::string::npos);
+    REQUIRE(ir.find("load i32, ptr %x.1\n") != std::string::npos);
+    //Symbol ids are kept by the AST cache
+    auto loaded = serialize::load_program(serialize::save_program(*program));
+    auto loaded_out = std::stringstream();
+    context::Context loaded_c;
+    loaded->codegen(loaded_out, loaded_c);
+    REQUIRE(loaded_out.str() == ir);
+}
+TEST_CASE("value pools keep addresses until release"){
+    using value::Value;
+    value::ValuePool pool;
+    auto first = pool.make(Value::Kind::Temp, 0, nullptr, type::IType::Int);
+    auto values = std::vector<value::Value*>{first};
+    for(int i = 1; i < 1000; i++){
+        values.push_back(pool.make(Value::Kind::Temp, i, nullptr, type::IType::Int));
+    }
+    REQUIRE(first->get_value().str() == "%0");
+    REQUIRE(pool.back() == values.back());
+    REQUIRE(pool.back(999) == first);
+    auto capacity = pool.capacity();
+    pool.release(1);
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.back() == first);
+    //Released chunks are reused
+    pool.make(Value::Kind::Temp, 1, nullptr, type::FType::Double);
+    REQUIRE(pool.capacity() == capacity);
+    REQUIRE(pool.back()->get_type() == type::CType(type::FType::Double));
+}
+TEST_CASE("values and labels are spelled when printed"){
+    using value::Value;
+    auto name = std::string("x");
+    REQUIRE(Value(Value::Kind::Temp, 7, nullptr, type::IType::Int).get_value().str() == "%7");
+    REQUIRE(Value(Value::Kind::Local, 2, &name, type::IType::Int).get_value().str() == "%x.2");
+    REQUIRE(Value(Value::Kind::Global, 0, &name, type::IType::Int).get_value().str() == "@x");
+    auto cast = Value(Value(Value::Kind::Global, 0, &name, type::IType::Int), type::PointerType(type::IType::Int));
+    REQUIRE(cast.get_value().str() == "@x");
+    REQUIRE(cast.get_type() == type::CType(type::PointerType(type::IType::Int)));
+
+    auto spelling = [](basicblock::Label label){
+        auto ss = std::stringstream();
+        ss << label;
+        return ss.str();
+    };
+    REQUIRE(spelling(basicblock::Label(basicblock::LabelKind::FunctionEnter, 0)) == "function.enter");
+    REQUIRE(spelling(basicblock::Label(basicblock::LabelKind::ForPost, 3)) == "forpost.3");
+    REQUIRE(spelling(basicblock::Label(basicblock::LabelKind::SwitchControl, 4)) == "afterswitchcontrol.4");
+    REQUIRE(spelling(basicblock::Label::switch_case(4, -1)) == "case.4.-1");
+    REQUIRE(spelling(basicblock::Label(basicblock::LabelKind::CaseDefault, 4)) == "case.4.default");
+    REQUIRE(spelling(basicblock::Label::user(&name)) == "x.label");
+}
+TEST_CASE("IR writer buffers its output"){
+    auto ss = std::stringstream();
+    {
+        auto writer = ir_writer::Writer(ss);
+        writer << "store i32 " << -42 << ", ptr %x." << 3ull << '\n';
+        REQUIRE(ss.str().empty());
+        REQUIRE(writer.buffered() == 24);
+        writer.flush();
+        REQUIRE(ss.str() == "store i32 -42, ptr %x.3\n");
+        //Text longer than the buffer goes straight to the stream
+        writer << std::string(3 << 20, 'a');
+        REQUIRE(ss.str().size() == 24 + (3 << 20));
+        writer << std::numeric_limits<long long>::min();
+    }
+    REQUIRE(ss.str().substr(24 + (3 << 20)) == "-9223372036854775808");
+}
+TEST_CASE("conversion tables"){
+    using type::IType;
+    using type::FType;
+    REQUIRE(type::usual_arithmetic_conversions(type::BasicType(IType::UShort), type::BasicType(IType::Bool)) == type::BasicType(IType::Int));
+    REQUIRE(type::usual_arithmetic_conversions(type::BasicType(IType::LLong), type::BasicType(IType::ULong)) == type::BasicType(IType::ULLong));
+    REQUIRE(type::usual_arithmetic_conversions(type::BasicType(FType::Float), type::BasicType(FType::Double)) == type::BasicType(FType::Double));
+    REQUIRE(std::string(conversions::conversion_opcode(IType::Long, IType::UShort)) == "zext");
+    REQUIRE(std::string(conversions::conversion_opcode(IType::Char, IType::Int)) == "trunc");
+    REQUIRE(std::string(conversions::conversion_opcode(FType::Float, IType::UInt)) == "uitofp");
+    REQUIRE(std::string(conversions::conversion_opcode(IType::Bool, FType::Double)) == "fcmp une");
+    REQUIRE(conversions::conversion_opcode(IType::ULLong, IType::Long) == nullptr);
+    REQUIRE(type::basic_ctype(IType::Bool) == type::CType(IType::Bool));
+    REQUIRE(&type::basic_ctype(FType::Double) == &type::basic_ctype(FType::Double));
+}
+TEST_CASE("codegen builds a module before printing"){
+    auto ss = std::stringstream("int g;\nint main(){\nint a = g;\nif(a)\nreturn 1;\nreturn 0;\n}\n");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    context::Context c;
+    program->codegen(c);
+    const auto& globals = c.module().globals;
+    REQUIRE(globals.size() == 2);
+    REQUIRE(std::holds_alternative<ir::Function>(globals.at(0)));
+    REQUIRE(std::holds_alternative<ir::GlobalVariable>(globals.at(1)));
+    const auto& main_function = std::get<ir::Function>(globals.at(0));
+    REQUIRE(main_function.params.empty());
+    REQUIRE(main_function.blocks.size() > 1);
+    const auto& entry = *main_function.blocks.front();
+    REQUIRE(entry.has_terminator());
+    REQUIRE(entry.get_instructions().at(0).get_kind() == basicblock::Instruction::Kind::Alloca);
+    REQUIRE(entry.get_instructions().at(1).get_kind() == basicblock::Instruction::Kind::Load);
+
+    auto out = std::stringstream();
+    auto writer = ir_writer::Writer(out);
+    ir::print(main_function, writer);
+    writer.flush();
+    REQUIRE(out.str().rfind("define dso_local i32 @main(){\nfunction.enter:\n  %a.0 = alloca i32\n", 0) == 0);
+}
+TEST_CASE("parallel codegen matches serial codegen"){
+    auto source = std::string("int printf(const char* format, ...);\n");
+    for(int i = 0; i < 40; i++){
+        auto n = std::to_string(i);
+        source += "int f"+n+"(int a){\nextern int counter;\nprintf(\"f"+n+" %d\\n\", a);\nprintf(\"hi\");\n";
+        source += "return a + counter + "+n+";\n}\n";
+    }
+    source += "int counter = 1;\nint main(){\nreturn f39(f0(1));\n}\n";
+    auto generate = [&](unsigned int threads){
+        auto ss = std::stringstream(source);
+        lexer::Lexer l(ss);
+        auto program = parse::construct_ast(l);
+        program->analyze();
+        auto out = std::stringstream();
+        context::Context c(threads);
+        program->codegen(out, c);
+        REQUIRE(c.stats().size() == 41);
+        REQUIRE(c.stats().at(1).name == "f1");
+        return out.str();
+    };
+    auto serial = generate(1);
+    //Strings are numbered in the order they are first used, and shared by later functions
+    REQUIRE(serial.find("@__const.f0.0 = ") != std::string::npos);
+    REQUIRE(serial.find("@__const.f0.1 = ") != std::string::npos);
+    REQUIRE(serial.find("@__const.f1.2 = ") != std::string::npos);
+    REQUIRE(serial.find("@__const.f39.40 = ") != std::string::npos);
+    REQUIRE(serial.find("@printf(ptr noundef @__const.f0.1)\n") != std::string::npos);
+    REQUIRE(serial.rfind("@printf(ptr noundef @__const.f0.1)\n") > serial.find("define dso_local i32 @f39("));
+    REQUIRE(generate(4) == serial);
+    REQUIRE(generate(0) == serial);
+}
+TEST_CASE("static initializers are written compactly"){
+    auto ss = std::stringstream(
+        "struct point{int x; int y;};\n"
+        "int zeros[1000] = {0, 0};\n"
+        "char bytes[6] = {104, 105, 34, 92, -1};\n"
+        "int grid[2][3] = {{0, 0, 0}, {4, 5, 6}};\n"
+        "struct point origin = {0};\n"
+        "double signs[2] = {0.0, -0.0};\n"
+        "union number{long l; char c;};\n"
+        "union number n = {7};\n"
+        "union byte{char c; long l;};\n"
+        "union byte b = {0};\n"
+        "union mixed{int i; char c[8]; double d;};\n"
+        "union mixed m = {65};\n"
+        "int main(){\nreturn grid[1][2];\n}\n");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    auto out = std::stringstream();
+    context::Context c;
+    program->codegen(out, c);
+    auto ir = out.str();
+    REQUIRE(ir.find("@zeros = dso_local global [1000 x i32] zeroinitializer\n") != std::string::npos);
+    REQUIRE(ir.find("@bytes = dso_local global [6 x i8] c\"hi\\22\\5C\\FF\\00\"\n") != std::string::npos);
+    REQUIRE(ir.find("@grid = dso_local global [2 x [3 x i32]] [ [3 x i32] zeroinitializer, [3 x i32] [ i32 4, i32 5, i32 6]]\n") != std::string::npos);
+    REQUIRE(ir.find("@origin = dso_local global %point zeroinitializer\n") != std::string::npos);
+    //A negative zero is not all zero bits
+    REQUIRE(ir.find("@signs = dso_local global [2 x double] [ double 0x0, double 0x8000000000000000]\n") != std::string::npos);
+    REQUIRE(ir.find("@n = dso_local global %number { i64 7}\n") != std::string::npos);
+    REQUIRE(ir.find("@b = dso_local global %byte zeroinitializer\n") != std::string::npos);
+    //A union initialized through a smaller member is stored as that member and padding, aligned as the union
+    REQUIRE(ir.find("@m = dso_local global {i32, [4 x i8]} { i32 65, [4 x i8] zeroinitializer}, align 8\n") != std::string::npos);
+    //Initializers are kept as trees of numbers until they are printed
+    const auto& globals = c.module().globals;
+    const auto& grid = std::get<ir::GlobalVariable>(globals.at(2)).initializer;
+    REQUIRE(grid.kind == ir::Constant::Kind::Aggregate);
+    REQUIRE(grid.elements.at(0).kind == ir::Constant::Kind::Zero);
+    REQUIRE(grid.elements.at(1).elements.at(2).kind == ir::Constant::Kind::Integer);
+    REQUIRE(grid.elements.at(1).elements.at(2).integer == 6);
+    const auto& signs = std::get<ir::GlobalVariable>(globals.at(4)).initializer;
+    REQUIRE(signs.elements.at(1).kind == ir::Constant::Kind::Float);
+    REQUIRE(std::signbit(signs.elements.at(1).floating));
+    const auto& mixed = std::get<ir::GlobalVariable>(globals.at(7));
+    REQUIRE(mixed.storage_type.has_value());
+    REQUIRE(mixed.align == 8);
+    REQUIRE(!std::get<ir::GlobalVariable>(globals.at(5)).storage_type.has_value());
+
+    auto nested = std::stringstream("union mixed{int i; double d;};\nunion mixed pair[2] = {{1}, {2}};\nint main(){\nreturn 0;\n}\n");
+    lexer::Lexer nested_l(nested);
+    auto nested_program = parse::construct_ast(nested_l);
+    nested_program->analyze();
+    auto nested_out = std::stringstream();
+    context::Context nested_c;
+    REQUIRE_THROWS_WITH(nested_program->codegen(nested_out, nested_c), Catch::Contains("inside an array or struct"));
+    REQUIRE(ir::parse_constant("0x8000000000000000").kind == ir::Constant::Kind::Float);
+    REQUIRE(ir::parse_constant("18446744073709551615").integer == -1);
+    REQUIRE(ir::parse_constant("c\"hi\\22\\5C\\FF\\00\"").text == std::string("hi\"\\\xFF\0", 6));
+}
+TEST_CASE("IR literals are exact"){
+    REQUIRE(type::ir_literal(-42LL, type::IType::Int) == "-42");
+    REQUIRE(type::ir_literal(std::numeric_limits<long long>::min(), type::IType::LLong) == "-9223372036854775808");
+    REQUIRE(type::ir_literal(16777217LL, type::FType::Float) == "0x4170000000000000");
+    REQUIRE(type::ir_literal(16777217LL, type::FType::Double) == "0x4170000010000000");
+    REQUIRE(type::ir_literal(1e-10L, type::FType::Double) == "0x3DDB7CDFD9D7BDBB");
+    REQUIRE(type::ir_literal(0.0L, type::FType::Double) == "0x0");
+    REQUIRE(type::ir_literal(-0.0L, type::FType::Double) == "0x8000000000000000");
+    REQUIRE(type::ir_literal(-2.75L, type::IType::Int) == "-2");
+    REQUIRE(type::ir_literal(std::string("1e-10"), type::FType::Double) == "0x3DDB7CDFD9D7BDBB");
+    REQUIRE(type::ir_literal(std::string("42"), type::IType::Int) == "42");
+
+    REQUIRE(type::ir_literal(std::string("")) == "c\"\"");
+    REQUIRE(type::ir_literal(std::string("plain text, it's fine?")) == "c\"plain text, it's fine?\"");
+    auto bytes = std::string("quote \" and backslash \\ tab\t\x7F\xC3\xA9", 31);
+    bytes.push_back('\0');
+    REQUIRE(type::ir_literal(bytes) == "c\"quote \\22 and backslash \\5C tab\\09\\7F\\C3\\A9\\00\"");
+    //Every byte value, so bytes needing escapes are found wherever they fall in a word
+    auto all = std::string();
+    auto expected = std::string("c\"");
+    for(int i = 0; i < 256; i++){
+        all.push_back(static_cast<char>(i));
+        if(i >= ' ' && i <= '~' && i != '"' && i != '\\'){
+            expected.push_back(static_cast<char>(i));
+        }else{
+            expected += "\\";
+            expected.push_back("0123456789ABCDEF"[i >> 4]);
+            expected.push_back("0123456789ABCDEF"[i & 15]);
+        }
+    }
+    REQUIRE(type::ir_literal(all) == expected + "\"");
+    REQUIRE(ir::parse_constant(expected + "\"").text == all);
+}
+TEST_CASE("time trace records phases and functions"){
+    auto source = std::string(
+R"(#define ONE 1
+int helper(int a){
+    return a * 2 + ONE;
+}
+int main(){
+    return helper(3);
+}
+)");
+    time_trace::enable("trace.c", std::chrono::microseconds(0));
+    auto tokenized = std::vector<token::Token>{};
+    {
+        auto span = time_trace::Scope("Tokenize");
+        auto ss = std::stringstream(source);
+        auto tokenizer = lexer::Tokenizer(ss);
+        do{
+            tokenized.push_back(tokenizer.get_token());
+        }while(tokenized.back().type != token::TokenType::END);
+    }
+    //Preprocessing tokens read ahead of time gives the same tokens as lexing the source directly
+    auto tokens = std::vector<token::Token>{};
+    auto l = lexer::Lexer(std::move(tokenized));
+    auto ss = std::stringstream(source);
+    auto direct = lexer::Lexer(ss);
+    do{
+        tokens.push_back(l.get_token());
+        auto expected = direct.get_token();
+        REQUIRE(tokens.back().type == expected.type);
+        REQUIRE(tokens.back().value == expected.value);
+    }while(tokens.back().type != token::TokenType::END);
+    auto stream = lexer::TokenStream(std::move(tokens));
+    auto program = parse::construct_ast(stream);
+    program->analyze();
+    auto out = std::stringstream();
+    context::Context c(2);
+    program->codegen(out, c);
+    auto trace = std::stringstream();
+    time_trace::write(trace);
+    time_trace::disable();
+    auto json = trace.str();
+    REQUIRE(json.rfind("{\"traceEvents\":[", 0) == 0);
+    REQUIRE(json.find("\"name\":\"Tokenize\"") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"Print IR\"") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"Analyze function\",\"args\":{\"detail\":\"helper\",\"file\":\"trace.c\",\"line\":2,\"col\":5}") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"Codegen function\",\"args\":{\"detail\":\"main\",\"file\":\"trace.c\",\"line\":5,\"col\":5}") != std::string::npos);
+    //Nothing is recorded once tracing is disabled
+    {
+        auto span = time_trace::Scope("Ignored");
+    }
+    auto empty = std::stringstream();
+    time_trace::write(empty);
+    REQUIRE(empty.str().find("\"ph\":\"X\"") == std::string::npos);
+}
+#ifdef STEPC_LLVM_BACKEND
+TEST_CASE("LLVM backend builds the module without textual IR"){
+    auto ss = std::stringstream(
+R"(
+int g = 3;
+_Bool flag = 1;
+long double scale = 1.5;
+int twice(int a){
+    return a * 2;
+}
+int main(){
+    char msg[3] = "hi";
+    int s = 0;
+    if(flag){
+        goto loop;
+    }
+    s = 50;
+loop:
+    for(int i = 0; i < 4; i++){
+        switch(i){
+            case -1:
+                s = 100;
+            case 1:
+                s += twice(g);
+                break;
+            default:
+                s++;
+        }
+    }
+    return s + msg[1];
+}
+)");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    context::Context c;
+    program->codegen(c);
+    llvm::LLVMContext llvm_context;
+    auto module = llvm_backend::build_module(c.module(), llvm_context);
+    REQUIRE(!llvm::verifyModule(*module, &llvm::errs()));
+    REQUIRE(module->getTargetTriple() == "x86_64-unknown-linux-gnu");
+    auto main_function = module->getFunction("main");
+    REQUIRE(main_function);
+    REQUIRE(!main_function->isDeclaration());
+    REQUIRE(module->getFunction("twice")->arg_size() == 1);
+    auto g = module->getGlobalVariable("g");
+    REQUIRE(g);
+    REQUIRE(llvm::cast<llvm::ConstantInt>(g->getInitializer())->getSExtValue() == 3);
+    REQUIRE(module->getGlobalVariable("flag")->getValueType()->isIntegerTy(1));
+    REQUIRE(module->getGlobalVariable("scale")->getValueType()->isDoubleTy());
+    REQUIRE(llvm::cast<llvm::ConstantFP>(module->getGlobalVariable("scale")->getInitializer())->isExactlyValue(1.5));
+    //Blocks are named as in the textual IR
+    bool has_label = false;
+    for(const auto& block : *main_function){
+        has_label = has_label || block.getName() == "loop.label";
+    }
+    REQUIRE(has_label);
+    bool has_switch = false;
+    for(const auto& block : *main_function){
+        if(auto s = llvm::dyn_cast<llvm::SwitchInst>(block.getTerminator())){
+            has_switch = true;
+            REQUIRE(s->getNumCases() == 2);
+            REQUIRE(s->findCaseValue(llvm::ConstantInt::get(llvm::cast<llvm::IntegerType>(s->getCondition()->getType()), -1, true)) != s->case_default());
+        }
+    }
+    REQUIRE(has_switch);
+}
+#endif
+TEST_CASE("bitcode writer matches the textual IR"){
+    auto ss = std::stringstream(
+R"(
+int printf(const char* format, ...);
+struct point{
+    int x;
+    int y;
+};
+union number{
+    int i;
+    double d;
+};
+struct point origin = {1, 2};
+int table[3] = {4, 5, 6};
+double scale = 2.5;
+struct point make(int x){
+    struct point p;
+    p.x = x;
+    p.y = table[2];
+    return p;
+}
+int main(){
+    union number n;
+    n.d = scale * 2;
+    float f = 1.5f;
+    int s = 0;
+    for(int i = 0; i < 4; i++){
+        switch(i){
+            case -1:
+                s = 100;
+            case 1:
+                s += make(i).y;
+                break;
+            default:
+                s++;
+        }
+    }
+    if(f > 1 && n.d != 0){
+        s = s + origin.y;
+    }
+    printf("%d\n", s);
+    return s;
+}
+)");
+    lexer::Lexer l(ss);
+    auto program = parse::construct_ast(l);
+    program->analyze();
+    context::Context c;
+    program->codegen(c);
+    auto bitcode = std::ostringstream();
+    bitcode_writer::write(c.module(), bitcode);
+    REQUIRE(bitcode.str().rfind("BC\xC0\xDE", 0) == 0);
+    REQUIRE(bitcode.str().size() % 4 == 0);
+
+    auto assembler = llvm_tool("llvm-as");
+    auto disassembler = llvm_tool("llvm-dis");
+    if(assembler.empty() || disassembler.empty()){
+        WARN("llvm-as or llvm-dis not found, not comparing the bitcode with the textual IR");
+        return;
+    }
+    auto dir = std::filesystem::temp_directory_path() / "stepc_bitcode_test";
+    std::filesystem::create_directories(dir);
+    {
+        auto text = std::ofstream(dir / "text.ll");
+        auto writer = ir_writer::Writer(text);
+        ir::print(c.module(), writer);
+    }
+    std::ofstream(dir / "written.bc", std::ios::binary) << bitcode.str();
+    //Both are disassembled by llvm-dis, so they must match exactly
+    REQUIRE(std::system((assembler+" "+(dir / "text.ll").string()+" -o "+(dir / "text.bc").string()).c_str()) == 0);
+    REQUIRE(std::system((disassembler+" "+(dir / "text.bc").string()+" -o "+(dir / "text.dis").string()).c_str()) == 0);
+    REQUIRE(std::system((disassembler+" "+(dir / "written.bc").string()+" -o "+(dir / "written.dis").string()).c_str()) == 0);
+    auto expected = read_disassembly(dir / "text.dis");
+    REQUIRE(expected.find("%point = type { i32, i32 }") != std::string::npos);
+    REQUIRE(read_disassembly(dir / "written.dis") == expected);
+    std::filesystem::remove_all(dir);
+}
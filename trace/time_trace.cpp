@@ -0,0 +1,119 @@
+#include "time_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <tuple>
+#include <vector>
+namespace time_trace{
+namespace{
+struct Event{
+    const char* name;
+    std::string detail;
+    location::Location loc;
+    bool has_location;
+    unsigned int tid;
+    long long start;
+    long long duration;
+};
+struct Recorder{
+    bool enabled = false;
+    std::string source_file;
+    std::chrono::microseconds granularity{0};
+    std::chrono::steady_clock::time_point begin;
+    std::mutex events_mutex;
+    std::vector<Event> events;
+};
+Recorder recorder;
+std::atomic<unsigned int> next_tid = 1;
+
+//Threads are numbered in the order they first open a span
+unsigned int thread_id(){
+    thread_local unsigned int tid = next_tid++;
+    return tid;
+}
+long long microseconds_since(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point time){
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - begin).count();
+}
+void write_string(std::ostream& output, const std::string& s){
+    output << '"';
+    for(unsigned char c : s){
+        if(c == '"' || c == '\\'){
+            output << '\\' << c;
+        }else if(c < ' '){
+            const char* hex = "0123456789abcdef";
+            output << "\\u00" << hex[c >> 4] << hex[c & 15];
+        }else{
+            output << c;
+        }
+    }
+    output << '"';
+}
+} //namespace
+
+void enable(std::string source_file, std::chrono::microseconds granularity){
+    recorder.source_file = std::move(source_file);
+    recorder.granularity = granularity;
+    recorder.begin = std::chrono::steady_clock::now();
+    recorder.enabled = true;
+}
+void disable(){
+    recorder.enabled = false;
+    auto lock = std::lock_guard(recorder.events_mutex);
+    recorder.events.clear();
+}
+bool enabled(){
+    return recorder.enabled;
+}
+
+Scope::Scope(const char* name) : name(name), detail(), loc(), active(recorder.enabled), has_location(false){
+    if(active){
+        start = std::chrono::steady_clock::now();
+    }
+}
+Scope::Scope(const char* name, const std::string& detail, const location::Location& loc)
+    : name(name), detail(), loc(loc), active(recorder.enabled), has_location(true){
+    if(active){
+        this->detail = detail;
+        start = std::chrono::steady_clock::now();
+    }
+}
+Scope::~Scope(){
+    if(!active || !recorder.enabled){
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    if(end - start < recorder.granularity){
+        return;
+    }
+    auto event = Event{name, std::move(detail), loc, has_location, thread_id(),
+        microseconds_since(recorder.begin, start), microseconds_since(start, end)};
+    auto lock = std::lock_guard(recorder.events_mutex);
+    recorder.events.push_back(std::move(event));
+}
+
+void write(std::ostream& output){
+    auto lock = std::lock_guard(recorder.events_mutex);
+    auto& events = recorder.events;
+    //Spans are recorded as they close, so inner spans come first
+    //Viewers nest spans starting at the same time in the order given, so outer ones are put first
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b){
+        return std::make_tuple(a.tid, a.start, -a.duration) < std::make_tuple(b.tid, b.start, -b.duration);
+    });
+    output << "{\"traceEvents\":[";
+    output << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"step_c\"}}";
+    for(const auto& e : events){
+        output << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+            << ",\"ts\":" << e.start << ",\"dur\":" << e.duration << ",\"name\":";
+        write_string(output, e.name);
+        if(e.has_location){
+            output << ",\"args\":{\"detail\":";
+            write_string(output, e.detail);
+            output << ",\"file\":";
+            write_string(output, recorder.source_file);
+            output << ",\"line\":" << e.loc.start_line << ",\"col\":" << e.loc.start_col << "}";
+        }
+        output << "}";
+    }
+    output << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+} //namespace time_trace
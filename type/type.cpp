@@ -2,6 +2,11 @@
 #include "type/type_func.h"
 #include "type/type_pointer.h"
 #include "type.h"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 namespace type{
 
 namespace{
@@ -27,39 +32,234 @@ std::map<TQualifier, std::string> type_qualifiers_to_string = {{
 }};
 
 } //namespace
-DerivedType::DerivedType(const DerivedType& other){
-    this->type = std::visit(overloaded{
-        [](const auto& p)-> DerivedPointers {return p->copy();}
-    }, other.type);
-}
-DerivedType& DerivedType::operator=(const DerivedType& other){
-    this->type = std::visit(overloaded{
-        [](const auto& p)-> DerivedPointers {return p->copy();}
-    }, other.type);
-    return *this;
+class TypeArena{
+public:
+    //Parsing and codegen may run on several threads, which mostly find types that are already interned
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<InternedType>> types;
+    std::unordered_map<std::string, std::size_t> equivalence_classes;
+};
+namespace{
+thread_local TypeArena* current_arena = nullptr;
+TypeArena& shared_arena(){
+    static TypeArena arena;
+    return arena;
 }
 
-bool DerivedType::operator ==(const DerivedType& other) const{
-    return std::visit(overloaded{
-        //Cases for non-array types are all the same
-        [&type2 = std::as_const(other.type)](const auto& type1){
-            if(!std::holds_alternative<std::decay_t<decltype(type1)>>(type2)){
-                return false;
-            }
-            const auto& t2 = std::get<std::decay_t<decltype(type1)>>(type2);
-            assert(type1 && t2 && "Invalid derived type containing nullptr");
-            if constexpr(std::is_same_v<std::decay_t<decltype(type1)>,std::unique_ptr<PointerType>>){
-                if(auto p = dynamic_cast<ArrayType*>(type1.get())){
-                    return *p == *dynamic_cast<ArrayType*>(std::get<std::unique_ptr<PointerType>>(type2).get());
-                }
+//Keys are byte strings: identity keys refer to child types by their interned address,
+//and equivalence keys by their equivalence class in the arena, leaving out what equality ignores
+//Children from another arena are given the class of their key in this arena,
+//which is what an equal type of this arena would have, so equivalence keys need the arena locked
+//Unless add_classes is set the arena is only read, and a child without a class is given one that no class has,
+//so the key matches no type of the arena
+void append_number(std::string& key, unsigned long long n){
+    key.append(reinterpret_cast<const char*>(&n), sizeof(n));
+}
+void append_string(std::string& key, const std::string& s){
+    append_number(key, s.size());
+    key += s;
+}
+std::size_t equivalence_class_in(const InternedType& t, TypeArena& arena, bool add_classes);
+void append_child(std::string& key, const CType& type, TypeArena* class_arena, bool add_classes){
+    bool identity = class_arena == nullptr;
+    visit(overloaded{
+        [&](VoidType){key += 'v';},
+        [&](const BasicType& t){
+            key += 'b';
+            key += static_cast<char>(t.index());
+            std::visit([&](auto b){key += static_cast<char>(b);}, t);
+        },
+        [&](const UnevaluatedTypedef& t){
+            key += 't';
+            append_string(key, t.get_name());
+        },
+        [&](const DerivedType& t){
+            key += 'd';
+            if(identity){
+                append_number(key, reinterpret_cast<std::uintptr_t>(t.identity()));
+            }else{
+                append_number(key, equivalence_class_in(*t.identity(), *class_arena, add_classes));
             }
-            return *type1 == *t2;
         },
-    }, this->type);
+    }, type);
+    if(identity){
+        key += static_cast<char>(type.qualifiers.mask());
+        key += static_cast<char>(type.storage.has_value() ? static_cast<int>(type.storage.value()) + 1 : 0);
+    }
+}
+void append_children(std::string& key, const std::vector<CType>& types, TypeArena* class_arena, bool add_classes){
+    append_number(key, types.size());
+    for(const auto& t : types){
+        append_child(key, t, class_arena, add_classes);
+    }
 }
-bool DerivedType::operator !=(const DerivedType& other) const{
+//Identity key if class_arena is null, and otherwise the equivalence key in that arena
+std::string type_key(const PointerType& t, TypeArena* class_arena, bool add_classes = true){
+    auto key = std::string("P");
+    append_child(key, t.pointed_type(), class_arena, add_classes);
+    return key;
+}
+std::string type_key(const ArrayType& t, TypeArena* class_arena, bool add_classes = true){
+    auto key = std::string("A");
+    if(!class_arena){
+        key += t.is_complete() ? 's' : 'u';
+        append_number(key, t.is_complete() ? t.size() : 0);
+    }
+    append_child(key, t.pointed_type(), class_arena, add_classes);
+    return key;
+}
+std::string type_key(const FuncType& t, TypeArena* class_arena, bool add_classes = true){
+    auto key = std::string("F");
+    append_child(key, t.return_type(), class_arena, add_classes);
+    key += t.has_prototype() ? 'p' : 'n';
+    if(t.has_prototype()){
+        key += t.is_variadic() ? 'v' : 'f';
+        append_children(key, t.param_types(), class_arena, add_classes);
+    }
+    return key;
+}
+//Structs and unions with the same tag are equal, whether or not they are complete
+template<typename T>
+std::string tag_key(char kind, const T& t, TypeArena* class_arena, bool add_classes = true){
+    auto key = std::string(1, kind);
+    append_string(key, t.tag);
+    if(!class_arena){
+        key += t.id ? 'm' : 'n';
+        append_number(key, t.id.value_or(0));
+        key += t.complete ? 'c' : 'i';
+        append_children(key, t.members, class_arena, add_classes);
+        append_number(key, t.indices.size());
+        for(const auto& name_index : t.indices){
+            append_string(key, name_index.first);
+            append_number(key, name_index.second);
+        }
+    }
+    return key;
+}
+std::string type_key(const StructType& t, TypeArena* class_arena, bool add_classes = true){
+    return tag_key('S', t, class_arena, add_classes);
+}
+std::string type_key(const UnionType& t, TypeArena* class_arena, bool add_classes = true){
+    auto key = tag_key('U', t, class_arena, add_classes);
+    if(!class_arena && t.largest_computed){
+        key += 'l';
+        append_child(key, t.largest, class_arena, add_classes);
+    }
+    return key;
+}
+//Expects the arena to be locked for writing
+std::size_t equivalence_class_of_key(std::string class_key, TypeArena& arena){
+    auto& classes = arena.equivalence_classes;
+    return classes.emplace(std::move(class_key), classes.size()).first->second;
+}
+//Expects the arena to be locked for reading
+std::optional<std::size_t> find_equivalence_class_of_key(const std::string& class_key, const TypeArena& arena){
+    auto found = arena.equivalence_classes.find(class_key);
+    if(found == arena.equivalence_classes.end()){
+        return std::nullopt;
+    }
+    return found->second;
+}
+//Expects the arena to be locked for writing if add_classes is set, and for reading otherwise
+std::size_t equivalence_class_in(const InternedType& t, TypeArena& arena, bool add_classes){
+    if(t.arena == &arena){
+        return t.equivalence_class;
+    }
+    auto class_key = std::visit([&](const auto& node){return type_key(*node, &arena, add_classes);}, t.node);
+    if(add_classes){
+        return equivalence_class_of_key(std::move(class_key), arena);
+    }
+    return find_equivalence_class_of_key(class_key, arena).value_or(std::numeric_limits<std::size_t>::max());
+}
+
+//Arena of the first derived type the node is built from, if any
+TypeArena* arena_of_children(const CType& child){
+    return visit(overloaded{
+        [](const DerivedType& t){return t.identity()->arena;},
+        [](const auto&)->TypeArena*{return nullptr;},
+    }, child);
+}
+TypeArena* arena_of_children(const std::vector<CType>& children){
+    for(const auto& child : children){
+        if(auto arena = arena_of_children(child)){
+            return arena;
+        }
+    }
+    return nullptr;
+}
+TypeArena* arena_of_children(const PointerType& t){
+    return arena_of_children(t.pointed_type());
+}
+TypeArena* arena_of_children(const ArrayType& t){
+    return arena_of_children(t.pointed_type());
+}
+TypeArena* arena_of_children(const FuncType& t){
+    if(auto arena = arena_of_children(t.return_type())){
+        return arena;
+    }
+    return t.has_prototype() ? arena_of_children(t.param_types()) : nullptr;
+}
+template<typename T>
+TypeArena* arena_of_children(const T& t){
+    return arena_of_children(t.members);
+}
+
+template<typename T>
+const InternedType* intern(const T& node){
+    auto arena_pointer = current_arena;
+    if(!arena_pointer){
+        //So that a type built from the types of a compilation is freed along with them
+        arena_pointer = arena_of_children(node);
+    }
+    auto& arena = arena_pointer ? *arena_pointer : shared_arena();
+    auto key = type_key(node, nullptr);
+    {
+        auto lock = std::shared_lock(arena.mutex);
+        auto it = arena.types.find(key);
+        if(it != arena.types.end()){
+            return it->second.get();
+        }
+    }
+    auto lock = std::unique_lock(arena.mutex);
+    //Another thread may have added the type since the lookup
+    auto it = arena.types.find(key);
+    if(it != arena.types.end()){
+        return it->second.get();
+    }
+    auto class_id = equivalence_class_of_key(type_key(node, &arena), arena);
+    auto entry = std::make_unique<InternedType>(std::make_unique<T>(node), class_id, &arena);
+    return arena.types.emplace(std::move(key), std::move(entry)).first->second.get();
+}
+} //namespace
+
+ArenaScope::ArenaScope(TypeArena& arena) noexcept : previous(current_arena){
+    current_arena = &arena;
+}
+ArenaScope::~ArenaScope(){
+    current_arena = previous;
+}
+
+DerivedType::DerivedType(const FuncType& f) : type(intern(f)) {}
+DerivedType::DerivedType(const PointerType& p) : type(intern(p)) {}
+DerivedType::DerivedType(const ArrayType& a) : type(intern(a)) {}
+DerivedType::DerivedType(const StructType& s) : type(intern(s)) {}
+DerivedType::DerivedType(const UnionType& u) : type(intern(u)) {}
+
+bool DerivedType::operator ==(const DerivedType& other) const noexcept{
+    if(type->arena == other.type->arena){
+        return type->equivalence_class == other.type->equivalence_class;
+    }
+    //Types of different compilations (or a compilation and the shared arena) are compared by structure
+    //An equal type of this arena would have the class of the other type's key, so one that has no class is not equal
+    auto lock = std::shared_lock(type->arena->mutex);
+    return type->equivalence_class == equivalence_class_in(*other.type, *type->arena, false);
+}
+bool DerivedType::operator !=(const DerivedType& other) const noexcept{
     return !this->operator==(other);
 }
+const InternedType* DerivedType::identity() const noexcept{
+    return type;
+}
 
 bool CType::operator ==(const CType& other) const{
     return this->type == other.type;
@@ -118,8 +318,10 @@ std::string to_string(const CType& type){
     if(type.storage.has_value()){
         s += storage_specifiers_to_string.at(type.storage.value()) +" ";
     }
-    for(const auto&tq : type.qualifiers){
-        s += type_qualifiers_to_string.at(tq) + " ";
+    for(const auto& tq : type_qualifiers_to_string){
+        if(type.qualifiers.contains(tq.first)){
+            s += tq.second + " ";
+        }
     }
     return s + visit(make_visitor<std::string>(
         [](VoidType v)->std::string{return "void";},
@@ -130,75 +332,149 @@ std::string to_string(const CType& type){
     ), type);
 }
 
-bool is_signed_int(CType type){
+bool is_signed_int(const CType& type){
     return is_type<BasicType>(type) && is_signed_int(get<BasicType>(type));
 }
-bool is_unsigned_int(CType type){
+bool is_unsigned_int(const CType& type){
     return is_type<BasicType>(type) && is_unsigned_int(get<BasicType>(type));
 }
-bool is_float(CType type){
+bool is_float(const CType& type){
     return type::is_type<type::FType>(type);
 }
-bool is_int(CType type){
+bool is_int(const CType& type){
     return type::is_type<type::IType>(type);
 }
-bool is_arith(CType type){
+bool is_arith(const CType& type){
     return type::is_type<type::BasicType>(type);
 }
-bool is_scalar(CType type){
+bool is_scalar(const CType& type){
     return type::is_type<type::BasicType>(type) || type::is_type<type::PointerType>(type);
 }
-BasicType usual_arithmetic_conversions(CType type1, CType type2){
-    try{
-        auto itype1 = get<BasicType>(type1);
-        auto itype2 = get<BasicType>(type2);
-        return usual_arithmetic_conversions(itype1, itype2);
-    }catch(std::exception& e){
+BasicType usual_arithmetic_conversions(const CType& type1, const CType& type2){
+    if(!is_arith(type1) || !is_arith(type2)){
         throw std::runtime_error("Failure to do integer promotions on types "+type::to_string(type1) + "and "+type::to_string(type2));
     }
+    return usual_arithmetic_conversions(get<BasicType>(type1), get<BasicType>(type2));
 }
 BasicType integer_promotions(const CType& type){
-    try{
-        auto itype = get<BasicType>(type);
-        return integer_promotions(itype);
-    }catch(std::exception& e){
+    if(!is_arith(type)){
         throw std::runtime_error("Failure to do integer promotions on type "+type::to_string(type));
     }
-}
-std::string ir_type(const CType& type){
-    return visit(make_visitor<std::string>(
-        [](VoidType v)->std::string{return "void";},
-        [](UnevaluatedTypedef v)->std::string{
+    return integer_promotions(get<BasicType>(type));
+}
+std::string_view InternedType::ir_type() const{
+    std::call_once(ir_type_computed, [this](){
+        ir_type_spelling = std::visit([](const auto& t){return t->ir_type();}, node);
+    });
+    return ir_type_spelling;
+}
+std::string_view ir_type(const CType& type){
+    return visit(overloaded{
+        [](VoidType v)->std::string_view{return "void";},
+        [](const UnevaluatedTypedef& v)->std::string_view{
             throw std::runtime_error("Cannot take ir type of unevaluated typedef");},
-        [](IType bt)->std::string{return ir_type(bt);},
-        [](FType bt)->std::string{return ir_type(bt);},
-        [](const auto& t){return t.ir_type();}
-    ), type);
+        [](const BasicType& bt)->std::string_view{
+            return std::visit([](auto t){return ir_type(t);}, bt);},
+        [](const DerivedType& t)->std::string_view{return t.identity()->ir_type();}
+    }, type);
 }
-long long int size(const CType& type){
+long long int size(const CType& type, const TypeContext& types){
     return visit(make_visitor<int>(
         [](VoidType v){return 0;},
         [](BasicType bt){return byte_size(bt);},
         [](const FuncType& ft){throw std::runtime_error("Cannot take size of function type");},
         [](const UnevaluatedTypedef& ft){throw std::runtime_error("Cannot take size of unevaluated typedef");},
         [](const PointerType& pt){return 8;},
-        [&](const ArrayType& at){return at.size()*type::size(at.pointed_type());},
-        [&](const StructType& st){return st.size(CType::tags);},
-        [&](const UnionType& st){return st.size(CType::tags);}
+        [&](const ArrayType& at){return at.size()*type::size(at.pointed_type(), types);},
+        [&](const StructType& st){return layout(type, types).size;},
+        [&](const UnionType& st){return layout(type, types).size;}
     ), type);
 }
-long long int align(const CType& type){
+long long int align(const CType& type, const TypeContext& types){
     return visit(make_visitor<int>(
         [](VoidType v){return 0;},
         [](BasicType bt){return byte_size(bt);},
         [](const FuncType& ft){throw std::runtime_error("Cannot take alignment of function type");},
         [](const UnevaluatedTypedef& ft){throw std::runtime_error("Cannot take alignment of unevaluated typedef");},
         [](const PointerType& pt){return 8;},
-        [&](const ArrayType& at){return type::align(at.pointed_type());},
-        [&](const StructType& st){return st.align(CType::tags);},
-        [&](const UnionType& st){return st.align(CType::tags);}
+        [&](const ArrayType& at){return type::align(at.pointed_type(), types);},
+        [&](const StructType& st){return layout(type, types).align;},
+        [&](const UnionType& st){return layout(type, types).align;}
     ), type);
 }
+namespace{
+Layout compute_layout(const StructType& t, const TypeContext& types){
+    auto layout = Layout{};
+    for(const auto& member : t.members){
+        auto member_size = type::size(member, types);
+        auto member_align = type::align(member, types);
+        if(layout.size % member_align != 0){
+            layout.size = ((layout.size/member_align) + 1) * member_align;
+        }
+        if(layout.align < member_align){
+            layout.align = member_align;
+        }
+        layout.offsets.push_back(layout.size);
+        layout.size += member_size;
+    }
+    if(layout.align != 0 && layout.size % layout.align != 0){
+        layout.size = ((layout.size/layout.align) + 1) * layout.align;
+    }
+    return layout;
+}
+Layout compute_layout(const UnionType& t, const TypeContext& types){
+    auto layout = Layout{};
+    for(std::size_t i = 0; i < t.members.size(); i++){
+        auto member_size = type::size(t.members.at(i), types);
+        if(member_size > layout.size){
+            layout.size = member_size;
+            layout.largest_member = i;
+        }
+        auto member_align = type::align(t.members.at(i), types);
+        if(member_align > layout.align){
+            layout.align = member_align;
+        }
+        layout.offsets.push_back(0);
+    }
+    if(layout.align != 0 && layout.size % layout.align != 0){
+        layout.size = ((layout.size/layout.align) + 1) * layout.align;
+    }
+    return layout;
+}
+template<typename T>
+const Layout& tag_layout(std::optional<Layout>& cached, const std::optional<CType>& definition, 
+    const TypeContext& types, const T& t, const std::string& kind){
+    if(cached){
+        return *cached;
+    }
+    if(t.is_complete()){
+        return cached.emplace(compute_layout(t, types));
+    }
+    if(!definition || !is_type<T>(*definition) || !get<T>(*definition).is_complete()){
+        throw std::runtime_error("Cannot take layout of incomplete or undefined "+kind+" "+t.tag);
+    }
+    return cached.emplace(compute_layout(get<T>(*definition), types));
+}
+} //namespace
+const Layout& layout(const CType& type, const TypeContext& types){
+    if(is_type<StructType>(type)){
+        const auto& t = get<StructType>(type);
+        auto id = types.find_tag(t);
+        if(id){
+            return tag_layout(types.tags[*id].layout, types.tags[*id].type, types, t, "struct");
+        }
+        throw std::runtime_error("Cannot take layout of incomplete or undefined struct "+t.tag);
+    }
+    if(is_type<UnionType>(type)){
+        const auto& t = get<UnionType>(type);
+        auto id = types.find_tag(t);
+        if(id){
+            return tag_layout(types.tags[*id].layout, types.tags[*id].type, types, t, "union");
+        }
+        throw std::runtime_error("Cannot take layout of incomplete or undefined union "+t.tag);
+    }
+    throw std::runtime_error("Cannot take layout of non struct or union type "+to_string(type));
+}
 bool is_complete(const CType& type){
     return visit(make_visitor<bool>(
         [](VoidType v){return false;},
@@ -211,32 +487,92 @@ bool is_complete(const CType& type){
         [](const UnionType& st){return st.is_complete();}
     ), type);
 }
-bool CType::tag_declared(std::string tag){
-    return CType::tags.find(tag) != CType::tags.end();
+TypeContext::TypeContext() : arena(std::make_shared<TypeArena>()) {}
+ArenaScope TypeContext::arena_scope() const noexcept{
+    return ArenaScope(*arena);
+}
+TagId TypeContext::intern_tag(const std::string& mangled_tag){
+    auto [it, inserted] = tag_ids.emplace(mangled_tag, tags.size());
+    if(inserted){
+        tags.push_back(Tag{mangled_tag, std::nullopt, std::nullopt});
+    }
+    return it->second;
 }
-CType CType::get_tag(std::string mangled_tag){
-    try{
-        return CType::tags.at(mangled_tag);
-    }catch(std::runtime_error& e){
+std::optional<TagId> TypeContext::find_tag(const std::string& mangled_tag) const{
+    auto found = tag_ids.find(mangled_tag);
+    if(found == tag_ids.end()){
+        return std::nullopt;
+    }
+    return found->second;
+}
+template<typename T>
+std::optional<TagId> TypeContext::tag_of(const T& type) const{
+    //An id from another context could name a different tag, so it is only trusted if the names agree
+    if(type.id && *type.id < tags.size() && tags[*type.id].name == type.tag){
+        return type.id;
+    }
+    return find_tag(type.tag);
+}
+std::optional<TagId> TypeContext::find_tag(const StructType& type) const{
+    return tag_of(type);
+}
+std::optional<TagId> TypeContext::find_tag(const UnionType& type) const{
+    return tag_of(type);
+}
+const std::string& TypeContext::tag_name(TagId id) const noexcept{
+    return tags[id].name;
+}
+bool TypeContext::tag_declared(TagId id) const noexcept{
+    return tags[id].type.has_value();
+}
+bool TypeContext::tag_declared(const std::string& mangled_tag) const{
+    auto id = find_tag(mangled_tag);
+    return id && tag_declared(*id);
+}
+const CType& TypeContext::get_tag(TagId id) const{
+    if(!tag_declared(id)){
+        throw std::runtime_error("Unmangled tag "+tags[id].name+" not found in symbol table");
+    }
+    return *tags[id].type;
+}
+const CType& TypeContext::get_tag(const std::string& mangled_tag) const{
+    auto id = find_tag(mangled_tag);
+    if(!id){
         throw std::runtime_error("Unmangled tag "+mangled_tag+" not found in symbol table");
     }
+    return get_tag(*id);
+}
+const CType& TypeContext::get_tag(const StructType& type) const{
+    auto id = find_tag(type);
+    if(!id){
+        throw std::runtime_error("Unmangled tag "+type.tag+" not found in symbol table");
+    }
+    return get_tag(*id);
+}
+const CType& TypeContext::get_tag(const UnionType& type) const{
+    auto id = find_tag(type);
+    if(!id){
+        throw std::runtime_error("Unmangled tag "+type.tag+" not found in symbol table");
+    }
+    return get_tag(*id);
 }
-void CType::add_tag(std::string tag, type::TagType type){
+void TypeContext::add_tag(TagId id, TagType type){
+    auto& entry = tags[id];
+    const auto& tag = entry.name;
     std::visit(type::overloaded{
         [&](EnumType t)->void{
-            if(CType::tags.find(tag) != CType::tags.end()){
-                auto existing = CType::tags.at(tag);
-                if(!type::is_type<IType>(existing)){
+            if(entry.type){
+                if(!type::is_type<IType>(*entry.type)){
                     throw std::runtime_error("Tag "+tag+" already declared with different type");
                 }
                 throw std::runtime_error("Enum "+tag+" already declared");
             }else{
-                CType::tags.emplace(tag, type::IType::Int);
+                entry.type = type::IType::Int;
             }
         },
         [&](auto t)->void{
-            if(CType::tags.find(tag) != CType::tags.end()){
-                auto existing = CType::tags.at(tag);
+            if(entry.type){
+                const auto& existing = *entry.type;
                 if(!type::is_type<decltype(t)>(existing)){
                     throw std::runtime_error("Tag "+tag+" already declared with different type");
                 }
@@ -249,10 +585,11 @@ void CType::add_tag(std::string tag, type::TagType type){
                                 throw std::runtime_error("Cannot use incomplete type in definition of type");
                             }
                         }
+                        entry.layout.reset();
                         if constexpr(std::is_same_v<decltype(t), type::UnionType>){
-                            t.compute_largest(CType::tags);
+                            t.compute_largest(*this);
                         }
-                        CType::tags[tag] = t;
+                        entry.type = t;
                     }
                 }
             }else{
@@ -263,23 +600,49 @@ void CType::add_tag(std::string tag, type::TagType type){
                         }
                     }
                     if constexpr(std::is_same_v<decltype(t), type::UnionType>){
-                        t.compute_largest(CType::tags);
+                        t.compute_largest(*this);
                     }
                 }
-                CType::tags.emplace(tag, t);
+                entry.type = t;
             }
         }
     }, type);
 }
-void CType::tag_ir_types(std::ostream& output){
-    for(const auto& name_type : CType::tags){
-        output<<"%"<<name_type.first<<" = type "<<type::ir_type(name_type.second)<<std::endl;
+void TypeContext::tag_ir_types(ir_writer::Writer& output) const{
+    auto declared = std::vector<const Tag*>{};
+    for(const auto& tag : tags){
+        if(tag.type){
+            declared.push_back(&tag);
+        }
+    }
+    std::sort(declared.begin(), declared.end(), [](const Tag* a, const Tag* b){return a->name < b->name;});
+    for(const auto tag : declared){
+        output<<"%"<<tag->name<<" = type "<<type::ir_type(*tag->type)<<'\n';
     }
 }
-
-std::map<std::string, type::CType> CType::tags = {};
-void CType::reset_tables() noexcept{
-    CType::tags = std::map<std::string, type::CType>{};
+std::map<std::string, CType> TypeContext::tag_table() const{
+    auto table = std::map<std::string, CType>{};
+    for(const auto& tag : tags){
+        if(tag.type){
+            table.emplace(tag.name, *tag.type);
+        }
+    }
+    return table;
+}
+void TypeContext::restore_tags(const std::map<std::string, CType>& restored){
+    tags.clear();
+    tag_ids.clear();
+    for(const auto& name_type : restored){
+        auto id = intern_tag(name_type.first);
+        tags[id].type = name_type.second;
+    }
+}
+void TypeContext::compute_layouts() const{
+    for(const auto& tag : tags){
+        if(tag.type && (is_type<StructType>(*tag.type) || is_type<UnionType>(*tag.type)) && is_complete(*tag.type)){
+            layout(*tag.type, *this);
+        }
+    }
 }
 bool is_specifier(const std::string& s){
     return is_type_specifier(s)
@@ -1,12 +1,6 @@
 #include "type.h"
-#include <sstream>
-#include <map>
 namespace type{
 ArrayType::ArrayType(CType t, std::optional<int> s) : PointerType(t), allocated_size(s){}
-
-DerivedType::DerivedType(ArrayType p) 
-    : type(std::make_unique<ArrayType>(p)){
-       }
 bool is_compatible(const ArrayType& type1, const ArrayType& type2){
     if(is_compatible(type1.underlying_type, type2.underlying_type)){
         if(!type1.is_complete() || !type2.is_complete()){
@@ -28,7 +22,7 @@ std::string ArrayType::ir_type() const{
     if(this->allocated_size.has_value()){
         size = std::to_string(this->allocated_size.value());
     }
-    return "["+size+" x "+type::ir_type(this->underlying_type)+"]";
+    return "["+size+" x "+std::string(type::ir_type(this->underlying_type))+"]";
 }
 bool ArrayType::operator ==(const ArrayType& other) const{
     return this->underlying_type == other.underlying_type;
@@ -36,27 +30,6 @@ bool ArrayType::operator ==(const ArrayType& other) const{
 bool ArrayType::operator !=(const ArrayType& other) const{
     return !this->operator==(other);
 }
-std::unique_ptr<PointerType> ArrayType::copy() const{
-    return std::make_unique<ArrayType>(*this);
-}
-std::string ir_literal(const std::string& c_literal){
-    static const std::map<char, std::string> special_chars = {{
-        {'\a',"\\07"},{'\b',"\\08"},{'\f',"\\0C"},{'\n',"\\0A"},
-        {'\r',"\\0D"},{'\t',"\\09"},{'\v',"\\0B"},{'\\',"\\5C"},
-        {'\'',"\\27"},{'\"',"\\22"},{'\?',"\\3F"},{'\0',"\\00"}
-    }};
-    auto ss = std::stringstream{};
-    ss << "c\"";
-    for(const auto& c : c_literal){
-        if(special_chars.find(c) != special_chars.end()){
-            ss << special_chars.at(c);
-        }else{
-            ss << c;
-        }
-    }
-    ss << "\"";
-    return ss.str();
-}
 void ArrayType::set_size(long long int size){
     if(size < 0){
         throw std::runtime_error("Cannot have array of negative size");
@@ -1,5 +1,6 @@
 #include "type.h"
 #include "type/type_basic.h"
+#include "conversions.h"
 #include <cassert>
 #include <map>
 #include <climits>
@@ -15,17 +16,10 @@
 #include <cstring>
 #include <sstream>
 #include <cctype>
+#include <array>
 namespace type{
 
 namespace{
-const std::map<IType,int> conversion_rank = {{
-    {IType::Bool, 0},
-    {IType::Char, 1},{IType::SChar, 1}, {IType::UChar, 1},
-    {IType::Short, 2},{IType::UShort, 2},
-    {IType::Int, 3},{IType::UInt, 3},
-    {IType::Long, 4},{IType::ULong, 4},
-    {IType::LLong, 5},{IType::ULLong, 5},
-}};
 const std::map<std::string,IType> int_types = {{
     {"_Bool", IType::Bool},
     {"char", IType::Char},{"signed char", IType::SChar}, {"unsigned char", IType::UChar},
@@ -69,78 +63,15 @@ const std::map<std::multiset<std::string>, std::string> multiset_to_type = {{
     {{"long", "double"},"long double"},
 }};
 
-unsigned long long max_value(BasicType type){
-    assert(std::holds_alternative<IType>(type) && "Can't take max value of non integer type");
-    switch(std::get<IType>(type)){
-        case IType::Bool:
-            return 1ull;
-        case IType::SChar:
-            return SCHAR_MAX;
-        case IType::Char:
-            return CHAR_MAX;
-        case IType::UChar:
-            return UCHAR_MAX;
-        case IType::Short:
-            return SHRT_MAX;
-        case IType::UShort:
-            return USHRT_MAX;
-        case IType::Int:
-            return INT_MAX;
-        case IType::UInt:
-            return UINT_MAX;
-        case IType::Long:
-            return LONG_MAX;
-        case IType::ULong:
-            return ULONG_MAX;
-        case IType::LLong:
-            return LLONG_MAX;
-        case IType::ULLong:
-            return ULLONG_MAX;
-    }
-    __builtin_unreachable();
-    assert(false);
-}
-
-
-
 int basic_bit_size(const FType& type){
-    switch(type){
-        case FType::Float:
-            return 32;
-        case FType::LDouble:
-        case FType::Double:
-            return 64;
-    }
-    __builtin_unreachable();
-    assert(false);
+    return conversions::properties(type).bits;
 }
 int basic_bit_size(const IType& type){
-    switch(type){
-        case IType::Bool:
-            return 1;
-        case IType::SChar:
-        case IType::Char:
-        case IType::UChar:
-            return std::numeric_limits<unsigned char>::digits;
-        case IType::Short:
-        case IType::UShort:
-            return std::numeric_limits<unsigned short int>::digits;
-        case IType::Int:
-        case IType::UInt:
-            return std::numeric_limits<unsigned int>::digits;
-        case IType::Long:
-        case IType::ULong:
-            return std::numeric_limits<unsigned long>::digits;
-        case IType::LLong:
-        case IType::ULLong:
-            return std::numeric_limits<unsigned long long>::digits;
-    }
-    __builtin_unreachable();
-    assert(false && "Missing case in basic type");
+    return conversions::properties(type).bits;
 }
 
 }//namespace
-std::string ir_type(FType type){
+std::string_view ir_type(FType type){
     switch(type){
         case FType::Float:
             return "float";
@@ -153,61 +84,25 @@ std::string ir_type(FType type){
     __builtin_unreachable();
     assert(false);
 }
-std::string ir_type(IType type){
-    return "i" + std::to_string(basic_bit_size(type));
+std::string_view ir_type(IType type){
+    switch(basic_bit_size(type)){
+        case 1:
+            return "i1";
+        case 8:
+            return "i8";
+        case 16:
+            return "i16";
+        case 32:
+            return "i32";
+        case 64:
+            return "i64";
+    }
+    assert(false && "No IR type for integer of this size");
+    __builtin_unreachable();
 }
 int byte_size(const BasicType& type){
     return std::visit([](const auto& t){return basic_bit_size(t)/8;},type);
 }
-std::string ir_literal(const std::string& literal_value, type::BasicType type){
-    //For now we "cheat" in two ways
-    //First, we use the C library functions
-    //Second, we make long doubles the same as doubles
-    //Together, this lets us avoid implementing arbitrary precision floats
-    //And avoids dealing with target-dependent long doubles
-    //Since llvm IR for long doubles is not target independent
-    if(is_type<IType>(type)){
-        return literal_value;
-    }
-    std::stringstream stream;
-    double value = std::stod(literal_value);
-    std::uint64_t num = 0;
-    static_assert(sizeof(value) == 8);
-    static_assert(std::numeric_limits<double>::is_iec559);
-    std::memcpy(&num, &value, 8);
-    if(std::get<type::FType>(type) == type::FType::Float){
-        std::uint64_t exp = 0;
-        std::memcpy(&exp, &value, 8);
-        //Clear out exponent from num
-        num <<= 12; 
-        num >>= 12;
-        //And clear significand from exp
-        exp >>= 52; 
-        int denormal_precision_loss = 0x381 - exp; //0x380 is equivalent to all 0s for a float
-        if(denormal_precision_loss < 0){
-            denormal_precision_loss = 0;
-        }
-        exp <<= 52; 
-        //Remove precision from num to make it as precise as a float
-        unsigned int sig_figs_lost = (52-23 + denormal_precision_loss);
-        std::uint64_t bits_lost = (num << (64-sig_figs_lost)) >> (64 - sig_figs_lost);
-        std::uint64_t rounding_mask = 1 << (sig_figs_lost - 1);
-        num >>= sig_figs_lost;
-        if((bits_lost & rounding_mask) != 0){
-            if((bits_lost & (~rounding_mask)) != 0
-                || ((num & 1u) == 1)
-                ){
-                //Either above 1/2 ULP, or we round to even
-                num++;
-            }
-        }
-        num <<= sig_figs_lost;
-        num += exp;
-    }
-    stream << "0x" << std::hex << std::uppercase<<num;
-    return stream.str();
-}
-
 BasicType make_basic(IType type){
     return std::variant<IType,FType>(type);
 }
@@ -216,51 +111,41 @@ BasicType make_basic(FType type){
 }
 
 bool can_represent(IType type, unsigned long long  value){
-    return value <= max_value(type);
+    return conversions::can_represent(type, value);
 }
 bool can_represent(IType target, IType source){
-    return can_represent(target, max_value(source));
+    return conversions::can_represent(target, source);
 }
 bool can_represent(FType target, FType source){
-    switch(target){
-        case FType::LDouble:
-            return true;
-        case FType::Double:
-            //Since LDouble and Double are the same for us
-            return true;
-        case FType::Float:
-            return (source == FType::Float);
-    }
-    __builtin_unreachable();
-    assert(false);
+    return conversions::can_represent(target, source);
 }
 
 IType to_unsigned(IType t){
-    switch(t){
-        case IType::Bool:
-            return IType::Bool;
-        case IType::SChar:
-        case IType::Char:
-        case IType::UChar:
-            return IType::UChar;
-        case IType::Short:
-        case IType::UShort:
-            return IType::UShort;
-        case IType::Int:
-        case IType::UInt:
-            return IType::UInt;
-        case IType::Long:
-        case IType::ULong:
-            return IType::ULong;
-        case IType::LLong:
-        case IType::ULLong:
-            return IType::ULLong;
-    }
-    __builtin_unreachable();
-    assert(false);
+    return conversions::properties(t).unsigned_type;
 }
 
 
+const CType& basic_ctype(IType type) noexcept{
+    static const auto types = [](){
+        auto types = std::array<CType, conversions::int_type_count>{};
+        for(std::size_t i = 0; i < types.size(); i++){
+            types[i] = CType(static_cast<IType>(i));
+        }
+        return types;
+    }();
+    return types[conversions::index(type)];
+}
+const CType& basic_ctype(FType type) noexcept{
+    static const auto types = [](){
+        auto types = std::array<CType, conversions::float_type_count>{};
+        for(std::size_t i = 0; i < types.size(); i++){
+            types[i] = CType(static_cast<FType>(i));
+        }
+        return types;
+    }();
+    return types[static_cast<std::size_t>(type)];
+}
+
 BasicType from_str(const std::string& type){
     if(int_types.find(type) != int_types.end()){
         return make_basic(int_types.at(type));
@@ -284,128 +169,31 @@ BasicType from_str_multiset(const std::multiset<std::string>& keywords){
 
 //Converting
 BasicType integer_promotions(const BasicType& type){
-    if(!std::holds_alternative<IType>(type)){
-        return type;
-    }
-    if(conversion_rank.at(std::get<IType>(type)) > conversion_rank.at(IType::Int)){
-        return type;
-    }
-    //check if int can represent
-    if(can_represent(IType::Int, std::get<IType>(type))){
-        return make_basic(IType::Int);
+    if(auto t = std::get_if<IType>(&type)){
+        return make_basic(conversions::integer_promotion(*t));
     }
-    return make_basic(IType::UInt);
+    return type;
 }
 
 BasicType usual_arithmetic_conversions(BasicType type1, BasicType type2){
-    auto ld = make_basic(FType::LDouble);
-    if(type1 == ld || type2 == ld){
-        return ld;
-    }
-    auto d = make_basic(FType::Double);
-    if(type1 == d || type2 == d){
-        return d;
-    }
-    auto f = make_basic(FType::Float);
-    if(type1 == f || type2 == f){
-        return f;
-    }
-    type1 = integer_promotions(type1);
-    type2 = integer_promotions(type2);
-    if(type1 == type2){
-        return type1;
-    }
-    bool signed1 = is_signed_int(type1);
-    bool signed2 = is_signed_int(type2);
-    int r1 = conversion_rank.at(std::get<IType>(type1));
-    int r2 = conversion_rank.at(std::get<IType>(type2));
-
-    if(signed1 == signed2){
-        if(r1<r2){
-            return type2;
-        }else{
-            return type1;
-        }
-    }
-    if(signed1 && (r1 <= r2)){
-        return type2;
-    }
-    if(signed2 && (r2 <= r1)){
-        return type1;
-    }
-    if(signed1){
-        if(can_represent(std::get<IType>(type1), std::get<IType>(type2))){
-            return type1;
-        }
-        return make_basic(to_unsigned(std::get<IType>(type1)));
-    }
-    if(signed2){
-        if(can_represent(std::get<IType>(type2), std::get<IType>(type1))){
-            return type2;
-        }
-        return make_basic(to_unsigned(std::get<IType>(type2)));
-    }
-    assert(false && "Missing case for usual arithmetic conversions");
-    __builtin_unreachable();
+    return conversions::usual_arithmetic_conversion(type1, type2);
 }
 bool promote_one_rank(IType& type){
-    IType ret_val;
-    switch(type){
-        case IType::Bool:
-            ret_val = IType::UChar;
-            break;
-        case IType::Char: //Char is signed by default
-        case IType::SChar:
-            ret_val = IType::Short;
-            break;
-        case IType::UChar:
-            ret_val = IType::UShort;
-            break;
-        case IType::Short:
-            ret_val = IType::Int;
-            break;
-        case IType::UShort:
-            ret_val = IType::UInt;
-            break;
-        case IType::Int:
-            ret_val = IType::Long;
-            break;
-        case IType::UInt:
-            ret_val = IType::ULong;
-            break;
-        case IType::Long:
-            ret_val = IType::LLong;
-            break;
-        case IType::ULong:
-            ret_val = IType::ULLong;
-            break;
-        case IType::LLong:
-            ret_val = IType::LLong;
-            break;
-        case IType::ULLong:
-            ret_val = IType::ULLong;
-            break;
-    }
-    if(ret_val != type){
-        type = ret_val;
+    auto next = conversions::properties(type).next_rank;
+    if(next != type){
+        type = next;
         return true;
     }
     return false;
 }
 
 bool promote_one_rank(FType& type){
-    switch(type){
-        case FType::Float:
-            type = FType::Double;
-            return true;
-        case FType::Double:
-            type = FType::LDouble;
-            return true;
-        case FType::LDouble:
-            return false;
+    auto next = conversions::properties(type).next_rank;
+    if(next != type){
+        type = next;
+        return true;
     }
-    __builtin_unreachable();
-    assert(false);
+    return false;
 }
 bool promote_one_rank(BasicType& type){
     return std::visit([](auto& t){return promote_one_rank(t);},type);
@@ -413,52 +201,12 @@ bool promote_one_rank(BasicType& type){
 
 //Checking
 bool is_signed_int(BasicType type){
-    if(!std::holds_alternative<IType>(type)){
-        return false;
-    }
-    switch(std::get<IType>(type)){
-        case IType::SChar:
-        case IType::Char:
-        case IType::Short:
-        case IType::Int:
-        case IType::Long:
-        case IType::LLong:
-            return true;
-        case IType::Bool:
-        case IType::UChar:
-        case IType::UShort:
-        case IType::UInt:
-        case IType::ULong:
-        case IType::ULLong:
-            return false;
-    }
-    //Annotation or g++ complains
-    __builtin_unreachable();
-    assert(false);
+    auto t = std::get_if<IType>(&type);
+    return t && conversions::properties(*t).is_signed;
 }
 bool is_unsigned_int(BasicType type){
-    if(!std::holds_alternative<IType>(type)){
-        return false;
-    }
-    switch(std::get<IType>(type)){
-        case IType::SChar:
-        case IType::Char:
-        case IType::Short:
-        case IType::Int:
-        case IType::Long:
-        case IType::LLong:
-            return false;
-        case IType::Bool:
-        case IType::UChar:
-        case IType::UShort:
-        case IType::UInt:
-        case IType::ULong:
-        case IType::ULLong:
-            return true;
-    }
-    //Annotation or g++ complains
-    __builtin_unreachable();
-    assert(false);
+    auto t = std::get_if<IType>(&type);
+    return t && !conversions::properties(*t).is_signed;
 }
 bool is_float(BasicType type){
     return std::holds_alternative<FType>(type);
@@ -1,9 +1,5 @@
 #include "type/type_func.h"
 namespace type{
-DerivedType::DerivedType(FuncType f) 
-    : type(std::make_unique<FuncType>(f)){
-       }
-
 FuncType::FuncType(CType ret, std::vector<CType> param, bool variadic)
     : ret_type(ret), prototype(std::make_optional<FuncPrototype>(param,variadic)) {
     auto void_type = type::CType{};
@@ -21,9 +17,6 @@ FuncType::FuncType(CType ret, std::vector<CType> param, bool variadic)
 FuncType::FuncType(CType ret)
     : ret_type(ret), prototype(std::nullopt) {
 };
-std::unique_ptr<FuncType> FuncType::copy() const{
-    return std::make_unique<FuncType>(*this);
-}
 bool FuncType::has_prototype() const{
     return prototype.has_value();
 }
@@ -120,7 +113,7 @@ std::string FuncType::to_string() const{
     }
 }
 std::string FuncType::ir_type() const{
-    std::string s = type::ir_type(this->ret_type)+"(";
+    std::string s = std::string(type::ir_type(this->ret_type))+"(";
     if(this->prototype.has_value()){
         auto t = this->prototype.value();
         if(t.param_types.size() > 0){
@@ -142,7 +135,7 @@ std::string FuncType::ir_type() const{
 bool FuncType::is_variadic() const{
     return has_prototype() && prototype.value().variadic;
 }
-std::vector<CType> FuncType::param_types() const{
+const std::vector<CType>& FuncType::param_types() const{
     if(has_prototype()){
         return prototype.value().param_types;
     }else{
@@ -0,0 +1,122 @@
+#include "type.h"
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+namespace type{
+namespace{
+//LLVM IR spells every floating point constant as the bits of a double, even for floats,
+//whose values are then exactly representable as doubles
+//For now long doubles are also written as doubles, since IR for long doubles is target dependent
+std::string hex_double(double value){
+    static_assert(sizeof(value) == sizeof(std::uint64_t));
+    static_assert(std::numeric_limits<double>::is_iec559);
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    char buffer[2 + 16];
+    buffer[0] = '0';
+    buffer[1] = 'x';
+    auto end = buffer + 2;
+    //Without leading zeros, so 0.0 is 0x0
+    int shift = 60;
+    while(shift > 0 && (bits >> shift) == 0){
+        shift -= 4;
+    }
+    for(; shift >= 0; shift -= 4){
+        *end++ = "0123456789ABCDEF"[(bits >> shift) & 15];
+    }
+    return std::string(buffer, end);
+}
+std::string float_literal(long double value, FType type){
+    if(type == FType::Float){
+        //Rounded once, straight to float precision
+        return hex_double(static_cast<float>(value));
+    }
+    return hex_double(static_cast<double>(value));
+}
+std::string integer_literal(long long value){
+    char buffer[std::numeric_limits<long long>::digits10 + 2];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    assert(result.ec == std::errc() && "Integer literal does not fit its buffer");
+    return std::string(buffer, result.ptr);
+}
+//Bytes of a c"..." string are written as is unless they are a quote, a backslash or not printable
+constexpr std::uint64_t repeated(unsigned char byte){
+    return 0x0101010101010101ull * byte;
+}
+//Nonzero if any byte of the word is below the (at most 0x80) bound
+constexpr std::uint64_t has_less(std::uint64_t word, unsigned char bound){
+    return (word - repeated(bound)) & ~word & repeated(0x80);
+}
+constexpr std::uint64_t has_byte(std::uint64_t word, unsigned char byte){
+    return has_less(word ^ repeated(byte), 1);
+}
+bool needs_escape(unsigned char c){
+    return c < ' ' || c > '~' || c == '"' || c == '\\';
+}
+//Whether any of the 8 bytes needs an escape, so runs of plain text are skipped a word at a time
+bool word_needs_escape(std::uint64_t word){
+    return has_less(word, ' ') || (word & repeated(0x80)) || has_byte(word, 0x7F)
+        || has_byte(word, '"') || has_byte(word, '\\');
+}
+} //namespace
+
+std::string ir_literal(long long value, BasicType type){
+    if(is_type<FType>(type)){
+        return float_literal(static_cast<long double>(value), std::get<FType>(type));
+    }
+    return integer_literal(value);
+}
+std::string ir_literal(long double value, BasicType type){
+    if(is_type<FType>(type)){
+        return float_literal(value, std::get<FType>(type));
+    }
+    //Converting a floating constant to an integer type truncates it
+    return integer_literal(static_cast<long long>(value));
+}
+std::string ir_literal(const std::string& literal_value, BasicType type){
+    if(is_type<IType>(type)){
+        return literal_value;
+    }
+    //The C library parses the literal correctly rounded, so floats are rounded once and not through a double
+    if(std::get<FType>(type) == FType::Float){
+        return hex_double(std::strtof(literal_value.c_str(), nullptr));
+    }
+    return hex_double(std::strtod(literal_value.c_str(), nullptr));
+}
+std::string ir_literal(const std::string& c_literal){
+    auto literal = std::string();
+    literal.reserve(c_literal.size() + 3);
+    literal += "c\"";
+    const char* data = c_literal.data();
+    std::size_t size = c_literal.size();
+    std::size_t plain = 0;
+    std::size_t i = 0;
+    while(i < size){
+        if(i + 8 <= size){
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, sizeof(word));
+            if(!word_needs_escape(word)){
+                i += 8;
+                continue;
+            }
+        }
+        auto c = static_cast<unsigned char>(data[i]);
+        if(needs_escape(c)){
+            literal.append(data + plain, i - plain);
+            literal += '\\';
+            literal += "0123456789ABCDEF"[c >> 4];
+            literal += "0123456789ABCDEF"[c & 15];
+            plain = i + 1;
+        }
+        i++;
+    }
+    literal.append(data + plain, size - plain);
+    literal += '"';
+    return literal;
+}
+} //namespace type
@@ -2,9 +2,6 @@
 namespace type{
 PointerType::PointerType(CType t) : underlying_type(t) {
     }
-DerivedType::DerivedType(PointerType p) 
-    : type(std::make_unique<PointerType>(p)){
-       }
 bool is_compatible(const PointerType& type1, const PointerType& type2){
     return is_compatible(type1.underlying_type, type2.underlying_type);
 }
@@ -34,9 +31,6 @@ bool PointerType::operator ==(const PointerType& other) const{
 bool PointerType::operator !=(const PointerType& other) const{
     return !this->operator==(other);
 }
-std::unique_ptr<PointerType> PointerType::copy() const{
-    return std::make_unique<PointerType>(*this);
-}
 CType PointerType::pointed_type() const{
     return this->underlying_type;
 }